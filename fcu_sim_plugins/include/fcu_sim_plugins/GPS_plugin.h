@@ -17,7 +17,6 @@
 #ifndef fcu_sim_PLUGINS_GPS_PLUGIN_H
 #define fcu_sim_PLUGINS_GPS_PLUGIN_H
 
-#include <random>
 
 #include <Eigen/Core>
 #include <gazebo/common/common.hh>
@@ -36,11 +35,15 @@
 #include <boost/bind.hpp>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/lazy_sensor_plugin.h"
+#include "fcu_sim_plugins/model_state.h"
+#include "fcu_sim_plugins/random_stream.h"
+#include "fcu_sim_plugins/sensor_scheduler.h"
 
 namespace gazebo 
 {
 
-class GPSPlugin : public ModelPlugin 
+class GPSPlugin : public LazySensorPlugin
 {
  public:
 
@@ -54,6 +57,7 @@ class GPSPlugin : public ModelPlugin
 
   void Load(physics::ModelPtr _model, sdf::ElementPtr _sdf);
   void OnUpdate(const common::UpdateInfo&);
+  void Skip(int samples);
 
  private:
   std::string namespace_;
@@ -64,16 +68,15 @@ class GPSPlugin : public ModelPlugin
   std::string frame_id_;
   std::string link_name_;
 
-  std::default_random_engine random_generator_;
-  std::normal_distribution<double> standard_normal_distribution_;
+  fcu_sim::RandomStream random_;
 
   // Gazebo connections
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
-  event::ConnectionPtr updateConnection_;
+  ModelStatePtr state_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 
-  common::Time last_time_;
 
   // Wind Connection
   struct Wind{ double N;  double E;  double D; } wind_;
@@ -90,6 +93,11 @@ class GPSPlugin : public ModelPlugin
   double alt_k_GPS_;
   double sample_time_;
 
+  // exp(-k*sample_time), the error decay per sample
+  double north_phi_;
+  double east_phi_;
+  double alt_phi_;
+
   double north_GPS_error_;
   double east_GPS_error_;
   double alt_GPS_error_;
@@ -19,6 +19,7 @@
 #define fcu_sim_PLUGINS_NAZE_HIL_MULTIROTOR_H
 
 #include <stdio.h>
+#include <atomic>
 
 #include <boost/bind.hpp>
 #include <Eigen/Eigen>
@@ -37,6 +38,12 @@
 #include <std_msgs/Float32MultiArray.h>
 #include <rosflight_msgs/Attitude.h>
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/imu_model.h"
+#include "fcu_sim_plugins/message_pool.h"
+#include "fcu_sim_plugins/model_state.h"
+#include "fcu_sim_plugins/rotor_model.h"
+#include "fcu_sim_plugins/sensor_scheduler.h"
+#include "fcu_sim_plugins/update_timer.h"
 #include <geometry_msgs/Vector3Stamped.h>
 #include <sensor_msgs/Imu.h>
 #include <std_srvs/Trigger.h>
@@ -44,9 +51,10 @@
 
 
 namespace gazebo {
-static const std::string kDefaultWindSpeedSubTopic = "gazebo/wind_speed";
 
 
+class FirmwareInstance;
+
 class ROSflightSIL : public ModelPlugin {
 public:
   ROSflightSIL();
@@ -66,7 +74,6 @@ protected:
 private:
   std::string command_topic_;
   std::string rc_topic_;
-  std::string wind_speed_topic_;
   std::string imu_topic_;
   std::string estimate_topic_;
   std::string joint_name_;
@@ -75,31 +82,34 @@ private:
   std::string signals_topic_;
   std::string motor_speed_pub_topic_;
   std::string namespace_;
+  std::string firmware_library_;
 
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
+  ModelStatePtr state_;
   physics::JointPtr joint_;
   physics::EntityPtr parent_link_;
   event::ConnectionPtr updateConnection_; // Pointer to the update event connection.
-
-  struct Rotor{
-    double max;
-    std::vector<double> F_poly;
-    std::vector<double> T_poly;
-    double tau_up; // time constants for response
-    double tau_down;
-  };
-
-  struct Motor{
-    Rotor rotor;
-    Eigen::Vector3d position;
-    Eigen::Vector3d normal;
-    int direction; // 1 for CW -1 for CCW
-  };
+  fcu_sim::UpdateTimer* update_timer_;
+  fcu_sim::UpdateTimer* command_timer_; // ROS callbacks, run on the spinner threads
+  fcu_sim::UpdateTimer* rc_timer_;
+  fcu_sim::UpdateTimer* imu_timer_;
+
+  // This vehicle's own copy of the firmware
+  boost::shared_ptr<FirmwareInstance> fw_;
+
+  // Lockstep mode: sample the IMU model on the physics thread and run the
+  // firmware loop at loop_rate_ in sim time, instead of on every IMU message
+  bool lockstep_;
+  double loop_rate_;
+  ImuModel imu_;
+  common::Time last_imu_time_;
+  SensorScheduler::ConnectionPtr firmware_connection_;
 
   int num_rotors_;
-  std::vector<Motor> motors_;
+  std::unique_ptr<fcu_sim::RotorModel> rotors_;
+  std::vector<double> motor_signals_;
 
   double linear_mu_;
   double angular_mu_;
@@ -147,37 +157,41 @@ private:
   ros::NodeHandle* nh_;
   ros::Subscriber command_sub_;
   ros::Subscriber rc_sub_;
-  ros::Subscriber wind_speed_sub_;
   ros::Subscriber imu_sub_;
   ros::Publisher estimate_pub_, euler_pub_;
   ros::Publisher signals_pub_;
   ros::Publisher alt_pub_, angle_pub_, command_pub_, passthrough_pub_;
   ros::ServiceServer calibrate_imu_srv_;
 
+  // Inbound messages are handed to the firmware and the physics update through
+  // mailboxes, so neither side sees a half-written value
+  MessagePool<rosflight_msgs::Attitude> estimate_pool_;
+  MessagePool<geometry_msgs::Vector3Stamped> euler_pool_;
+  MessagePool<rosflight_msgs::OutputRaw> signals_pool_;
+
+  Mailbox<rosflight_msgs::Command> command_mailbox_;
+  Mailbox<rosflight_msgs::OutputRaw> rc_mailbox_;
+  Mailbox<rosflight_msgs::OutputRaw> motor_mailbox_;
+
+  // Requests for the firmware, which only the thread running RunFirmware may
+  // touch: a reset carries the new start time, calibration is just a flag
+  Mailbox<uint64_t> reset_mailbox_;
+  std::atomic<bool> calibrate_imu_requested_;
+
   rosflight_msgs::Command command_;
+  rosflight_msgs::OutputRaw rc_;
+  rosflight_msgs::OutputRaw esc_signals_;
 
   boost::thread callback_queue_thread_;
-  void WindSpeedCallback(const geometry_msgs::Vector3& wind);
   void CommandCallback(const rosflight_msgs::Command& msg);
   void RCCallback(const rosflight_msgs::OutputRaw& msg);
+  void ApplyCommand(const rosflight_msgs::Command& msg);
   void imuCallback(const sensor_msgs::Imu& msg);
+  void OnFirmwareUpdate(const common::UpdateInfo& _info);
+  void RunFirmware(const ros::Time& stamp, const double accel[3], const double gyro[3]);
 
   bool calibrateImuBiasSrvCallback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res);
-  double sat(double x, double max, double min);
   double max(double x, double y);
-  math::Vector3 W_wind_speed_;
-
-  Eigen::MatrixXd rotor_position_;
-  Eigen::MatrixXd rotor_plane_normal_;
-  Eigen::VectorXd rotor_rotation_direction_;
-
-  Eigen::MatrixXd force_allocation_matrix_;
-  Eigen::MatrixXd torque_allocation_matrix_;
-  Eigen::VectorXd motor_signals_;
-  Eigen::VectorXd desired_forces_;
-  Eigen::VectorXd desired_torques_;
-  Eigen::VectorXd actual_forces_;
-  Eigen::VectorXd actual_torques_;
 };
 }
 
@@ -0,0 +1,358 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_AIRCRAFT_DYNAMICS_H
+#define fcu_sim_PLUGINS_AIRCRAFT_DYNAMICS_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace fcu_sim {
+
+/*
+ * Fixed-wing force and moment model from chapter 4 of
+ * Small Unmanned Aircraft: Theory and Practice by Randy Beard and Tim McLain,
+ * free of any Gazebo or ROS types so that the Gazebo plugin and the headless
+ * tools run exactly the same math.
+ */
+
+struct AircraftParams
+{
+  // physical parameters
+  double mass;
+  double Jx;
+  double Jy;
+  double Jz;
+  double Jxz;
+  double rho;
+
+  // aerodynamic coefficients
+  struct WingCoeff{
+    double S;
+    double b;
+    double c;
+    double M;
+    double epsilon;
+    double alpha0;
+  } wing;
+
+  // Propeller Coefficients
+  struct PropCoeff{
+    double k_motor;
+    double k_T_P;
+    double k_Omega;
+    double e;
+    double S;
+    double C;
+  } prop;
+
+  // Lift Coefficients
+  struct LiftCoeff{
+    double O;
+    double alpha;
+    double beta;
+    double p;
+    double q;
+    double r;
+    double delta_a;
+    double delta_e;
+    double delta_r;
+  };
+
+  LiftCoeff CL;
+  LiftCoeff CD;
+  LiftCoeff Cm;
+  LiftCoeff CY;
+  LiftCoeff Cell;
+  LiftCoeff Cn;
+
+  AircraftParams();
+
+  /*
+   * Fill in parameters from anything with a ros::NodeHandle-style
+   * param<double>(name, default) lookup (rosparam, yaml files, ...).
+   * Missing parameters fall back to the defaults below.
+   */
+  template <class Source>
+  void load(Source& src);
+};
+
+/*
+ * The structs below and the model functions are templated on the scalar
+ * type.  The plugins use them with double (the typedefs), tools wanting
+ * exact Jacobians instantiate them with Dual<N> from dual.h.
+ */
+
+// actuators
+template <class T>
+struct AircraftControlsT
+{
+  T e;
+  T a;
+  T r;
+  T t;
+};
+
+// Body-fixed (NED) velocities and rates, plus the wind in the same frame
+template <class T>
+struct AircraftInputT
+{
+  T u, v, w;
+  T p, q, r;
+  T wind_u, wind_v, wind_w;
+  AircraftControlsT<T> delta;
+};
+
+// container for forces
+template <class T>
+struct AircraftForcesT
+{
+  T Fx;
+  T Fy;
+  T Fz;
+  T l;
+  T m;
+  T n;
+};
+
+// Longitudinal body-axis coefficients, the parts of the model that depend only on alpha
+template <class T>
+struct AircraftAlphaCoeffsT
+{
+  T CX;
+  T CX_q;
+  T CX_delta_e;
+  T CZ;
+  T CZ_q;
+  T CZ_delta_e;
+};
+
+typedef AircraftControlsT<double> AircraftControls;
+typedef AircraftInputT<double> AircraftInput;
+typedef AircraftForcesT<double> AircraftForces;
+typedef AircraftAlphaCoeffsT<double> AircraftAlphaCoeffs;
+
+// Evaluate the alpha-dependent coefficients straight from the model
+template <class T>
+void computeAlphaCoeffs(const AircraftParams& params, const T& alpha, AircraftAlphaCoeffsT<T>& out);
+
+/*
+ * The alpha-dependent coefficients sampled on a uniform grid over
+ * [-pi, pi] and linearly interpolated.  The blending sigmoid and the flat
+ * plate terms cost several exp/sin/cos calls per step, a lookup costs two
+ * adjacent entries.  Every other term is linear in beta, the rates and the
+ * controls, so alpha is the only axis worth tabulating.
+ *
+ * The table is only valid for the parameters it was built from, build it
+ * again whenever they change.
+ */
+class AircraftAeroTable
+{
+public:
+  AircraftAeroTable();
+
+  // Sample the model every resolution radians of alpha, left empty unless resolution > 0
+  void build(const AircraftParams& params, double resolution);
+  bool empty() const { return table_.empty(); }
+  size_t size() const { return table_.size(); }
+
+  void lookup(double alpha, AircraftAlphaCoeffs& out) const;
+
+  // Largest interpolation error over all coefficients, checked halfway between grid points
+  double maxError(const AircraftParams& params) const;
+
+private:
+  double inv_step_;
+  std::vector<AircraftAlphaCoeffs> table_;
+};
+
+/*
+ * Compute the body-fixed (NED) aerodynamic and propulsive forces and moments.
+ * Returns false and leaves out untouched if the airspeed is not finite, so
+ * the caller can decide how loudly to complain.  With a non-empty table the
+ * alpha-dependent coefficients come from it, otherwise they are computed
+ * analytically.  The table only applies to double, any other scalar type
+ * always runs the analytic model so its derivatives stay exact.
+ */
+template <class T>
+bool computeAircraftForces(const AircraftParams& params, const AircraftInputT<T>& in, AircraftForcesT<T>& out,
+                           const AircraftAeroTable* table = NULL);
+
+
+template <class Source>
+void AircraftParams::load(Source& src)
+{
+  // physical parameters
+  mass = src.template param<double>("mass", mass);
+  Jx = src.template param<double>("Jx", Jx);
+  Jy = src.template param<double>("Jy", Jy);
+  Jz = src.template param<double>("Jz", Jz);
+  Jxz = src.template param<double>("Jxz", Jxz);
+  rho = src.template param<double>("rho", rho);
+
+  // Wing Geometry
+  wing.S = src.template param<double>("wing_s", wing.S);
+  wing.b = src.template param<double>("wing_b", wing.b);
+  wing.c = src.template param<double>("wing_c", wing.c);
+  wing.M = src.template param<double>("wing_M", wing.M);
+  wing.epsilon = src.template param<double>("wing_epsilon", wing.epsilon);
+  wing.alpha0 = src.template param<double>("wing_alpha0", wing.alpha0);
+
+  // Propeller Coefficients
+  prop.k_motor = src.template param<double>("k_motor", prop.k_motor);
+  prop.k_T_P = src.template param<double>("k_T_P", prop.k_T_P);
+  prop.k_Omega = src.template param<double>("k_Omega", prop.k_Omega);
+  prop.e = src.template param<double>("prop_e", prop.e);
+  prop.S = src.template param<double>("prop_S", prop.S);
+  prop.C = src.template param<double>("prop_C", prop.C);
+
+  // Stability derivatives, named C_<coefficient>_<term> on the parameter server
+  const char* names[] = {"L", "D", "m", "Y", "ell", "n"};
+  LiftCoeff* coeffs[] = {&CL, &CD, &Cm, &CY, &Cell, &Cn};
+  for (int i = 0; i < 6; i++)
+  {
+    std::string prefix = std::string("C_") + names[i] + "_";
+    LiftCoeff& C = *coeffs[i];
+    C.O = src.template param<double>(prefix + "O", C.O);
+    C.alpha = src.template param<double>(prefix + "alpha", C.alpha);
+    C.beta = src.template param<double>(prefix + "beta", C.beta);
+    C.p = src.template param<double>(prefix + "p", C.p);
+    C.q = src.template param<double>(prefix + "q", C.q);
+    C.r = src.template param<double>(prefix + "r", C.r);
+    C.delta_a = src.template param<double>(prefix + "delta_a", C.delta_a);
+    C.delta_e = src.template param<double>(prefix + "delta_e", C.delta_e);
+    C.delta_r = src.template param<double>(prefix + "delta_r", C.delta_r);
+  }
+}
+
+
+template <class T>
+void computeAlphaCoeffs(const AircraftParams& P, const T& alpha, AircraftAlphaCoeffsT<T>& out)
+{
+  using std::cos;
+  using std::exp;
+  using std::pow;
+  using std::sin;
+
+  double sign = (alpha >= 0? 1: -1);//Sigmoid function
+  T sigma_a = (1 + exp(-(P.wing.M*(alpha - P.wing.alpha0))) + exp((P.wing.M*(alpha + P.wing.alpha0))))/((1 + exp(-(P.wing.M*(alpha - P.wing.alpha0))))*(1 + exp((P.wing.M*(alpha + P.wing.alpha0)))));
+  T CL_a = (1 - sigma_a)*(P.CL.O + P.CL.alpha*alpha) + sigma_a*(2*sign*pow(sin(alpha),2.0)*cos(alpha));
+  double AR = (pow(P.wing.b, 2.0))/P.wing.S;
+  T CD_a = P.CD.p + ((pow((P.CL.O + P.CL.alpha*(alpha)),2.0))/(3.14159*0.9*AR));//the const 0.9 in this equation replaces the e (Oswald Factor) variable and may be inaccurate
+
+  out.CX = -CD_a*cos(alpha) + CL_a*sin(alpha);
+  out.CX_q = -P.CD.q*cos(alpha) + P.CL.q*sin(alpha);
+  out.CX_delta_e = -P.CD.delta_e*cos(alpha) + P.CL.delta_e*sin(alpha);
+
+  out.CZ = -CD_a*sin(alpha) - CL_a*cos(alpha);
+  out.CZ_q = -P.CD.q*sin(alpha) - P.CL.q*cos(alpha);
+  out.CZ_delta_e = -P.CD.delta_e*sin(alpha) - P.CL.delta_e*cos(alpha);
+}
+
+
+namespace detail {
+
+template <class T>
+void alphaCoeffs(const AircraftParams& P, const AircraftAeroTable* /*table*/, const T& alpha,
+                 AircraftAlphaCoeffsT<T>& out)
+{
+  computeAlphaCoeffs(P, alpha, out);
+}
+
+inline void alphaCoeffs(const AircraftParams& P, const AircraftAeroTable* table, const double& alpha,
+                        AircraftAlphaCoeffs& out)
+{
+  if (table != NULL && !table->empty())
+    table->lookup(alpha, out);
+  else
+    computeAlphaCoeffs(P, alpha, out);
+}
+
+}
+
+
+template <class T>
+bool computeAircraftForces(const AircraftParams& P, const AircraftInputT<T>& in, AircraftForcesT<T>& out,
+                           const AircraftAeroTable* table)
+{
+  using std::asin;
+  using std::atan2;
+  using std::isfinite;
+  using std::pow;
+  using std::sqrt;
+
+  const AircraftControlsT<T>& delta = in.delta;
+  T p = in.p;
+  T q = in.q;
+  T r = in.r;
+
+  T ur = in.u - in.wind_u;
+  T vr = in.v - in.wind_v;
+  T wr = in.w - in.wind_w;
+
+  T Va = sqrt(pow(ur,2.0) + pow(vr,2.0) + pow(wr,2.0));
+
+  // don't let NaN's get through (sometimes GetRelativeLinearVel returns NaNs)
+  if (!isfinite(Va))
+    return false;
+
+  // Don't divide by zero
+  if (Va <= 0.000001)
+  {
+    out.Fx = 0.5*P.rho*P.prop.S*P.prop.C*(pow((P.prop.k_motor*delta.t),2.0));
+    out.Fy = 0.0;
+    out.Fz = 0.0;
+    out.l = 0.0;
+    out.m = 0.0;
+    out.n = 0.0;
+    return true;
+  }
+
+  /*
+   * The following math follows the method described in chapter 4 of
+   * Small Unmanned Aircraft: Theory and Practice
+   * By Randy Beard and Tim McLain.
+   * Look there for a detailed explanation of each line in the rest of this function
+   */
+  T alpha = atan2(wr , ur);
+  T beta = asin(vr/Va);
+
+  AircraftAlphaCoeffsT<T> C;
+  detail::alphaCoeffs(P, table, alpha, C);
+
+  T CX_a = C.CX;
+  T CX_q_a = C.CX_q;
+  T CX_deltaE_a = C.CX_delta_e;
+
+  T CZ_a = C.CZ;
+  T CZ_q_a = C.CZ_q;
+  T CZ_deltaE_a = C.CZ_delta_e;
+
+  out.Fx = 0.5*(P.rho)*pow(Va,2.0)*P.wing.S*(CX_a + (CX_q_a*P.wing.c*q)/(2.0*Va) + CX_deltaE_a * delta.e) + 0.5*P.rho*P.prop.S*P.prop.C*(pow((P.prop.k_motor*delta.t),2.0) - pow(Va,2.0));
+  out.Fy = 0.5*(P.rho)*pow(Va,2.0)*P.wing.S*(P.CY.O + P.CY.beta*beta + ((P.CY.p*P.wing.b*p)/(2.0*Va)) + ((P.CY.r*P.wing.b*r)/(2.0*Va)) + P.CY.delta_a*delta.a + P.CY.delta_r*delta.r);
+  out.Fz = 0.5*(P.rho)*pow(Va,2.0)*P.wing.S*(CZ_a + (CZ_q_a*P.wing.c*q)/(2.0*Va) + CZ_deltaE_a * delta.e);
+
+  out.l = 0.5*(P.rho)*pow(Va,2.0)*P.wing.S*P.wing.b*(P.Cell.O + P.Cell.beta*beta + (P.Cell.p*P.wing.b*p)/(2.0*Va) + (P.Cell.r*P.wing.b*r)/(2.0*Va) + P.Cell.delta_a*delta.a + P.Cell.delta_r*delta.r) - P.prop.k_T_P*pow((P.prop.k_Omega*delta.t),2.0);
+  out.m = 0.5*(P.rho)*pow(Va,2.0)*P.wing.S*P.wing.c*(P.Cm.O + P.Cm.alpha*alpha + (P.Cm.q*P.wing.c*q)/(2.0*Va) + P.Cm.delta_e*delta.e);
+  out.n = 0.5*(P.rho)*pow(Va,2.0)*P.wing.S*P.wing.b*(P.Cn.O + P.Cn.beta*beta + (P.Cn.p*P.wing.b*p)/(2.0*Va) + (P.Cn.r*P.wing.b*r)/(2.0*Va) + P.Cn.delta_a*delta.a + P.Cn.delta_r*delta.r);
+  return true;
+}
+
+}
+
+#endif // fcu_sim_PLUGINS_AIRCRAFT_DYNAMICS_H
@@ -32,13 +32,13 @@
 
 #include <rosflight_msgs/Command.h>
 #include <std_msgs/Float32.h>
-#include <geometry_msgs/Vector3.h>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/aircraft_dynamics.h"
+#include "fcu_sim_plugins/model_state.h"
+#include "fcu_sim_plugins/update_timer.h"
 
 namespace gazebo {
-static const std::string kDefaultWindSpeedSubTopic = "gazebo/wind_speed";
-
 
 class AircraftForcesAndMoments : public ModelPlugin {
  public:
@@ -58,7 +58,6 @@ class AircraftForcesAndMoments : public ModelPlugin {
 
  private:
   std::string command_topic_;
-  std::string wind_speed_topic_;
   std::string joint_name_;
   std::string link_name_;
   std::string parent_frame_id_;
@@ -68,83 +67,26 @@ class AircraftForcesAndMoments : public ModelPlugin {
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
+  ModelStatePtr state_;
   physics::JointPtr joint_;
   physics::EntityPtr parent_link_;
   event::ConnectionPtr updateConnection_; // Pointer to the update event connection.
+  fcu_sim::UpdateTimer* update_timer_;
+  fcu_sim::UpdateTimer* command_timer_; // CommandCallback, on a ROS spinner thread
 
-  // physical parameters
-  double mass_;
-  double Jx_;
-  double Jy_;
-  double Jz_;
-  double Jxz_;
-  double rho_;
-
-  // aerodynamic coefficients
-  struct WingCoeff{
-    double S;
-    double b;
-    double c;
-    double M;
-    double epsilon;
-    double alpha0;
-  } wing_;
-
-  // Propeller Coefficients
-  struct PropCoeff{
-    double k_motor;
-    double k_T_P;
-    double k_Omega;
-    double e;
-    double S;
-    double C;
-  } prop_;
-
-  // Lift Coefficients
-  struct LiftCoeff{
-    double O;
-    double alpha;
-    double beta;
-    double p;
-    double q;
-    double r;
-    double delta_a;
-    double delta_e;
-    double delta_r;
-  };
-
-  LiftCoeff CL_;
-  LiftCoeff CD_;
-  LiftCoeff Cm_;
-  LiftCoeff CY_;
-  LiftCoeff Cell_;
-  LiftCoeff Cn_;
+  // Gazebo-free aircraft model and its parameters
+  fcu_sim::AircraftParams params_;
+  fcu_sim::AircraftAeroTable aero_table_; // empty when running the analytic model
 
   // not constants
   // actuators
-  struct Actuators{
-    double e;
-    double a;
-    double r;
-    double t;
-  } delta_;
-
-    // wind
-  struct Wind{
-    double N;
-    double E;
-    double D;
-  } wind_;
+  fcu_sim::AircraftControls delta_;
+
+  // Latest command, handed over from the ROS callback
+  Mailbox<fcu_sim::AircraftControls> delta_mailbox_;
 
   // container for forces
-  struct ForcesAndTorques{
-    double Fx;
-    double Fy;
-    double Fz;
-    double l;
-    double m;
-    double n;
-  } forces_;
+  fcu_sim::AircraftForces forces_;
 
   // Time Counters
   double sampling_time_ = 0;
@@ -155,15 +97,12 @@ class AircraftForcesAndMoments : public ModelPlugin {
 
   ros::NodeHandle* nh_;
   ros::Subscriber command_sub_;
-  ros::Subscriber wind_speed_sub_;
 
   boost::thread callback_queue_thread_;
   void QueueThread();
-  void WindSpeedCallback(const geometry_msgs::Vector3& wind);
   void CommandCallback(const rosflight_msgs::CommandConstPtr& msg);
 
   std::unique_ptr<FirstOrderFilter<double>>  rotor_velocity_filter_;
-  math::Vector3 wind_speed_W_;
 };
 }
 
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_AIRCRAFT_TRIM_H
+#define fcu_sim_PLUGINS_AIRCRAFT_TRIM_H
+
+#include <limits>
+
+#include "fcu_sim_plugins/aircraft_dynamics.h"
+#include "fcu_sim_plugins/rigid_body.h"
+
+namespace fcu_sim {
+
+/*
+ * Trim and linearization of the fixed-wing model, following chapter 5 of
+ * Small Unmanned Aircraft: Theory and Practice by Randy Beard and Tim McLain,
+ * but evaluated on computeAircraftForces() and rigidBodyDerivatives() so the
+ * result always matches what the Gazebo plugin flies.
+ *
+ * A trim point is a steady climbing turn at airspeed Va, flight path angle
+ * gamma and turn radius R (positive turns right, infinite flies straight),
+ * with the sideslip beta held at a chosen value.  The remaining unknowns,
+ * alpha, phi and the four controls, are found with Newton's method on the
+ * six dynamic equations; the kinematic ones hold by construction.  Both the
+ * Newton Jacobian and the linearization are exact, from running the model
+ * on dual numbers.
+ */
+
+enum AircraftInputIndex
+{
+  INPUT_E, INPUT_T, INPUT_A, INPUT_R,
+  NUM_AIRCRAFT_INPUTS
+};
+
+struct TrimCondition
+{
+  double Va; // m/s
+  double gamma; // rad, positive climbing
+  double R; // m, positive turning right
+  double beta; // rad
+};
+
+struct TrimOptions
+{
+  int max_iterations;
+  double tolerance; // on the largest residual state derivative
+
+  TrimOptions();
+};
+
+struct TrimResult
+{
+  bool converged;
+  int iterations;
+  double residual; // largest |xdot - xdot*| at the solution
+
+  double alpha;
+  double x[NUM_RIGID_BODY_STATES];
+  double u[NUM_AIRCRAFT_INPUTS]; // e, t, a, r, same conventions as AircraftControls
+
+  // Linearization about the trim point, row-major, xdot = A x + B u
+  double A[NUM_RIGID_BODY_STATES][NUM_RIGID_BODY_STATES];
+  double B[NUM_RIGID_BODY_STATES][NUM_AIRCRAFT_INPUTS];
+};
+
+// Full nonlinear state derivative for a zero-wind aircraft, templated on the scalar type
+template <class T>
+void aircraftDerivatives(const AircraftParams& params, const RigidBodyParams& body,
+                         const T x[NUM_RIGID_BODY_STATES], const T u[NUM_AIRCRAFT_INPUTS],
+                         T xdot[NUM_RIGID_BODY_STATES]);
+
+// Exact A = df/dx and B = df/du of aircraftDerivatives, row-major
+void linearizeAircraft(const AircraftParams& params, const RigidBodyParams& body,
+                       const double x[NUM_RIGID_BODY_STATES], const double u[NUM_AIRCRAFT_INPUTS],
+                       double A[NUM_RIGID_BODY_STATES][NUM_RIGID_BODY_STATES],
+                       double B[NUM_RIGID_BODY_STATES][NUM_AIRCRAFT_INPUTS]);
+
+// Solve for trim and linearize about it, A and B are filled in even when trim didn't converge
+TrimResult computeTrim(const AircraftParams& params, const RigidBodyParams& body,
+                       const TrimCondition& condition, const TrimOptions& options = TrimOptions());
+
+
+template <class T>
+void aircraftDerivatives(const AircraftParams& params, const RigidBodyParams& body,
+                         const T x[NUM_RIGID_BODY_STATES], const T u[NUM_AIRCRAFT_INPUTS],
+                         T xdot[NUM_RIGID_BODY_STATES])
+{
+  AircraftInputT<T> in;
+  in.u = x[STATE_U];
+  in.v = x[STATE_V];
+  in.w = x[STATE_W];
+  in.p = x[STATE_P];
+  in.q = x[STATE_Q];
+  in.r = x[STATE_R];
+  in.wind_u = 0.0;
+  in.wind_v = 0.0;
+  in.wind_w = 0.0;
+  in.delta.e = u[INPUT_E];
+  in.delta.t = u[INPUT_T];
+  in.delta.a = u[INPUT_A];
+  in.delta.r = u[INPUT_R];
+
+  AircraftForcesT<T> out;
+  if (!computeAircraftForces(params, in, out))
+  {
+    for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+      xdot[i] = std::numeric_limits<double>::quiet_NaN();
+    return;
+  }
+  T fm[6] = {out.Fx, out.Fy, out.Fz, out.l, out.m, out.n};
+  rigidBodyDerivatives(body, x, fm, xdot);
+}
+
+}
+
+#endif // fcu_sim_PLUGINS_AIRCRAFT_TRIM_H
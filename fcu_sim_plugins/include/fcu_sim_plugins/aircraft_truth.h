@@ -36,12 +36,15 @@
 #include <geometry_msgs/Vector3.h>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/lazy_sensor_plugin.h"
+#include "fcu_sim_plugins/message_pool.h"
+#include "fcu_sim_plugins/model_state.h"
+#include "fcu_sim_plugins/sensor_scheduler.h"
 
 namespace gazebo {
-static const std::string kDefaultWindSpeedSubTopic = "gazebo/wind_speed";
 
 
-class AircraftTruth : public ModelPlugin {
+class AircraftTruth : public LazySensorPlugin {
  public:
   AircraftTruth();
 
@@ -56,7 +59,6 @@ class AircraftTruth : public ModelPlugin {
 
  private:
   std::string truth_topic_;
-  std::string wind_speed_topic_;
   std::string joint_name_;
   std::string link_name_;
   std::string parent_frame_id_;
@@ -66,31 +68,24 @@ class AircraftTruth : public ModelPlugin {
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
+  ModelStatePtr state_;
   physics::JointPtr joint_;
   physics::EntityPtr parent_link_;
-  event::ConnectionPtr updateConnection_; // Pointer to the update event connection.
-
-  // wind
-  struct Wind{
-    double N;
-    double E;
-    double D;
-  } wind_;
+  SensorScheduler::ConnectionPtr updateConnection_; // Pointer to the update event connection.
 
   // Time Counters
   double sampling_time_;
   double prev_sim_time_;
+  double pub_rate_;
 
   ros::NodeHandle* node_handle_;
-  ros::Subscriber wind_speed_sub_;
   ros::Publisher true_state_pub_;
+  MessagePool<rosflight_msgs::State> true_state_pool_;
 
   boost::thread callback_queue_thread_;
   void QueueThread();
-  void WindSpeedCallback(const geometry_msgs::Vector3& wind);
 
   std::unique_ptr<FirstOrderFilter<double>>  rotor_velocity_filter_;
-  math::Vector3 wind_speed_W_;
 };
 }
 
@@ -17,7 +17,6 @@
 #ifndef fcu_sim_PLUGINS_AIRSPEED_PLUGIN_H
 #define fcu_sim_PLUGINS_AIRSPEED_PLUGIN_H
 
-#include <random>
 
 #include <Eigen/Core>
 #include <gazebo/common/common.hh>
@@ -37,10 +36,14 @@
 #include <boost/bind.hpp>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/lazy_sensor_plugin.h"
+#include "fcu_sim_plugins/model_state.h"
+#include "fcu_sim_plugins/random_stream.h"
+#include "fcu_sim_plugins/sensor_scheduler.h"
 
 namespace gazebo {
 
-class AirspeedPlugin : public ModelPlugin {
+class AirspeedPlugin : public LazySensorPlugin {
  public:
 
   AirspeedPlugin();
@@ -62,21 +65,16 @@ class AirspeedPlugin : public ModelPlugin {
   std::string frame_id_;
   std::string link_name_;
 
-  std::default_random_engine random_generator_;
-  std::normal_distribution<double> standard_normal_distribution_;
+  fcu_sim::RandomStream random_;
 
   // Gazebo connections
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
-  event::ConnectionPtr updateConnection_;
+  ModelStatePtr state_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 
-  common::Time last_time_;
-
-  // Wind Connection
-  struct Wind{ double N;  double E;  double D; } wind_;
-  ros::Subscriber wind_speed_sub_;
-  void WindSpeedCallback(const geometry_msgs::Vector3& wind);
+  double pub_rate_;
 
   rosflight_msgs::Airspeed airspeed_message_;
 
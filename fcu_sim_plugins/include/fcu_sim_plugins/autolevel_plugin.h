@@ -30,6 +30,8 @@
 #include <ros/ros.h>
 #include "geometry_msgs/Vector3Stamped.h"
 #include <fcu_sim_plugins/common.h>
+#include <fcu_sim_plugins/model_state.h>
+#include <fcu_sim_plugins/sensor_scheduler.h>
 
 #include <chrono>
 #include <cmath>
@@ -58,13 +60,14 @@ private:
   // Pointer to the gazebo items.
   physics::LinkPtr sensor_link;
   physics::LinkPtr model_link;
+  ModelStatePtr model_state;
   physics::ModelPtr model_;
   physics::WorldPtr world_;
 
   std::string namespace_;
 
   // Pointer to the update event connection
-  event::ConnectionPtr updateConnection_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 
 };
 } // namespace gazebo
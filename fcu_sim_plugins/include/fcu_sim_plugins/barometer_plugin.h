@@ -17,8 +17,6 @@
 #ifndef fcu_sim_PLUGINS_RANGE_PLUGIN_H
 #define fcu_sim_PLUGINS_RANGE_PLUGIN_H
 
-#include <random>
-
 #include <Eigen/Core>
 #include <gazebo/common/common.hh>
 #include <gazebo/common/Plugin.hh>
@@ -36,10 +34,13 @@
 #include <boost/bind.hpp>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/lazy_sensor_plugin.h"
+#include "fcu_sim_plugins/random_stream.h"
+#include "fcu_sim_plugins/sensor_scheduler.h"
 
 namespace gazebo {
 
-class AltimeterPlugin : public ModelPlugin {
+class AltimeterPlugin : public LazySensorPlugin {
  public:
 
   AltimeterPlugin();
@@ -68,8 +69,7 @@ class AltimeterPlugin : public ModelPlugin {
   bool publish_float_;
 
   // Random Engine
-  std::default_random_engine random_generator_;
-  std::normal_distribution<double> standard_normal_distribution_;
+  fcu_sim::RandomStream random_;
 
   // Gazebo Information
   std::string frame_id_;
@@ -77,8 +77,7 @@ class AltimeterPlugin : public ModelPlugin {
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
-  event::ConnectionPtr updateConnection_;
-  common::Time last_time_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 
 };
 }
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef fcu_sim_PLUGINS_CAMERA_IMAGE_OUTPUT_H
+#define fcu_sim_PLUGINS_CAMERA_IMAGE_OUTPUT_H
+
+#include <string>
+
+#include <gazebo/gazebo.hh>
+#include <image_transport/image_transport.h>
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+
+#include <fcu_sim/ShmImage.h>
+
+#include "fcu_sim_plugins/image_encoder.h"
+#include "fcu_sim_plugins/message_pool.h"
+#include "fcu_sim_plugins/shm_image_ring.h"
+
+namespace gazebo {
+
+/**
+ * \brief Where a camera plugin sends its rendered frames.
+ *
+ * GazeboRosCameraUtils::PutCameraData copies every frame into one shared
+ * message under a lock and publishes it by reference, so it is copied again
+ * for every subscriber.  Here the render buffer is copied once into a pooled
+ * message that nobody holds any more and the shared_ptr is published, which
+ * roscpp hands to nodelets in the same process without a copy.  Processes on
+ * the same machine can instead read frames from a shared-memory ring, each
+ * announced by a small fcu_sim/ShmImage on <image topic>/shm.  Compressed
+ * copies for ground-station links and bags come from an ImageEncoder pool fed
+ * the same pooled message, so the render thread never waits on an encode.
+ *
+ * SDF: pooledImages (true), imagePoolSize (4), shmSlots (0, off),
+ * encodeFormat ("" off, jpeg or png), encodeQuality, encodeThreads (1),
+ * encodeQueue (2) and encodedTopic (<image topic>/encoded).  Called from
+ * the render thread only.
+ */
+class CameraImageOutput {
+ public:
+  CameraImageOutput();
+  ~CameraImageOutput();
+
+  void load(sdf::ElementPtr sdf);
+
+  /// Once GazeboRosCameraUtils has set up ROS, which it does on its own thread after Load;
+  /// frame_size is the bytes in one frame, step times height
+  void init(ros::NodeHandle* nh, const std::string& image_topic, const std::string& shm_name, size_t frame_size);
+  bool initialized() const { return initialized_; }
+
+  /// Whether publish() sends the raw image, false to leave it to PutCameraData
+  bool pooled() const { return pooled_; }
+
+  /// Send a frame to whoever wants it, raw_subscribers as counted by GazeboRosCameraUtils
+  void publish(const unsigned char* src, const fcu_sim::ShmFrameInfo& image, const std::string& frame_id,
+               image_transport::Publisher& raw_pub, int raw_subscribers);
+
+  /// One line of counters for the plugin to log on shutdown
+  std::string stats() const;
+
+ private:
+  bool initialized_;
+
+  bool pooled_;
+  MessagePool<sensor_msgs::Image> image_pool_;
+
+  int shm_slots_;
+  fcu_sim::ShmImageWriter shm_writer_;
+  ros::Publisher shm_pub_;
+  MessagePool<fcu_sim::ShmImage> shm_pool_;
+
+  std::string encode_format_;
+  int encode_quality_;
+  int encode_threads_;
+  int encode_queue_;
+  std::string encoded_topic_;
+  ros::Publisher encoded_pub_;
+  fcu_sim::ImageEncoder encoder_; // after its publisher, so its workers stop first
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_CAMERA_IMAGE_OUTPUT_H
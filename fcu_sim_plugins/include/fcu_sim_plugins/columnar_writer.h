@@ -0,0 +1,86 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_COLUMNAR_WRITER_H
+#define fcu_sim_PLUGINS_COLUMNAR_WRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fcu_sim {
+
+/*
+ * Fixed-size table of doubles stored column by column, so every metric of a
+ * sweep is one contiguous block on disk.  The file layout (little-endian) is
+ *
+ *   char[8]   "FCUCOL01"
+ *   uint32    number of columns
+ *   uint64    number of rows
+ *   per column: uint32 name length, name bytes (no terminator)
+ *   per column: rows x float64
+ *
+ * which numpy can read with a couple of np.fromfile calls.  Rows can be
+ * filled from different threads as long as no two threads share a row.
+ */
+class ColumnarTable
+{
+public:
+  ColumnarTable(const std::vector<std::string>& columns, size_t rows) :
+    names_(columns),
+    rows_(rows),
+    data_(columns.size()*rows, 0.0)
+  {}
+
+  size_t rows() const { return rows_; }
+  size_t columns() const { return names_.size(); }
+
+  double& at(size_t row, size_t column) { return data_[column*rows_ + row]; }
+  double at(size_t row, size_t column) const { return data_[column*rows_ + row]; }
+
+  bool write(const std::string& filename) const
+  {
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    if (!file)
+      return false;
+
+    file.write("FCUCOL01", 8);
+    uint32_t num_columns = names_.size();
+    uint64_t num_rows = rows_;
+    file.write(reinterpret_cast<const char*>(&num_columns), sizeof(num_columns));
+    file.write(reinterpret_cast<const char*>(&num_rows), sizeof(num_rows));
+    for (size_t i = 0; i < names_.size(); i++)
+    {
+      uint32_t length = names_[i].size();
+      file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      file.write(names_[i].data(), length);
+    }
+    if (!data_.empty())
+      file.write(reinterpret_cast<const char*>(data_.data()), data_.size()*sizeof(double));
+    return file.good();
+  }
+
+private:
+  std::vector<std::string> names_;
+  size_t rows_;
+  std::vector<double> data_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_COLUMNAR_WRITER_H
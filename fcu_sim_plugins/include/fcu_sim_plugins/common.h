@@ -21,6 +21,11 @@
 #ifndef fcu_sim_PLUGINS_COMMON_H_
 #define fcu_sim_PLUGINS_COMMON_H_
 
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
 #include <Eigen/Dense>
 #include <gazebo/gazebo.hh>
 
@@ -53,6 +58,111 @@ bool getSdfParam(sdf::ElementPtr sdf, const std::string& name, T& param, const T
   return false;
 }
 
+/**
+ * \brief Single-producer, single-consumer mailbox for handing the latest value
+ * from a ROS callback to the physics update.
+ *
+ * This is a triple buffer: the writer and the reader each own one slot and
+ * swap it with the shared middle slot using a single atomic exchange, so
+ * neither side ever blocks or retries and the reader never sees a half-written
+ * value.  Only the newest value matters; anything the reader never picked up
+ * is counted as overwritten.
+ */
+template<class T>
+class Mailbox {
+ public:
+  Mailbox() :
+    back_(0),
+    shared_(1),
+    front_(2),
+    written_(0),
+    overwritten_(0) {}
+
+  /// Publish a new value (ROS callback thread). Wait-free.
+  void write(const T& value) {
+    buffers_[back_] = value;
+    unsigned previous = shared_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+    back_ = previous & kIndexMask;
+    written_.fetch_add(1, std::memory_order_relaxed);
+    if (previous & kFresh)
+      overwritten_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Copy the newest value into out if one arrived since the last read
+  /// (physics thread). Wait-free, leaves out untouched otherwise.
+  bool read(T& out) {
+    if (!(shared_.load(std::memory_order_relaxed) & kFresh))
+      return false;
+    front_ = shared_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    out = buffers_[front_];
+    return true;
+  }
+
+  /// Number of values written so far
+  uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+  /// Number of values replaced before the reader saw them
+  uint64_t overwritten() const { return overwritten_.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr unsigned kIndexMask = 0x3;
+  static constexpr unsigned kFresh = 0x4;
+
+  T buffers_[3];
+  unsigned back_; // owned by the writer
+  std::atomic<unsigned> shared_;
+  unsigned front_; // owned by the reader
+  std::atomic<uint64_t> written_;
+  std::atomic<uint64_t> overwritten_;
+};
+
+/**
+ * \brief Cuts a loop that runs every physics step down to a publish rate.
+ *
+ * due() is true on the first call in each 1/rate slot of sim time, so outputs
+ * at the same rate line up across plugins regardless of when they started.
+ * A rate of 0 or less publishes on every call.  The counters are kept for
+ * diagnostics.
+ */
+class PublishRate {
+ public:
+  PublishRate(double rate = 0.0) : published_(0), decimated_(0) { setRate(rate); }
+
+  void setRate(double rate) {
+    rate_ = rate;
+    last_slot_ = std::numeric_limits<int64_t>::min();
+  }
+
+  double rate() const { return rate_; }
+
+  /// Whether to publish at sim time t [s]
+  bool due(double t) {
+    if (rate_ > 0.0) {
+      // The small offset keeps a step that lands exactly on a slot boundary in the new slot
+      int64_t slot = static_cast<int64_t>(std::floor(t*rate_ + 1e-6));
+      if (slot == last_slot_) {
+        decimated_++;
+        return false;
+      }
+      last_slot_ = slot;
+    }
+    published_++;
+    return true;
+  }
+
+  /// Number of calls that published
+  uint64_t published() const { return published_; }
+
+  /// Number of calls skipped to hold the rate
+  uint64_t decimated() const { return decimated_; }
+
+ private:
+  double rate_;
+  int64_t last_slot_;
+  uint64_t published_;
+  uint64_t decimated_;
+};
+
 }
 
 template <typename T>
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_DUAL_H
+#define fcu_sim_PLUGINS_DUAL_H
+
+#include <cmath>
+
+namespace fcu_sim {
+
+/*
+ * Forward-mode dual number carrying the value and its derivatives with
+ * respect to N independent variables.  Run a model templated on its scalar
+ * type with Dual<N> inputs and every output holds its exact gradient, no
+ * step sizes involved.  Seed the inputs with Dual::variable().
+ *
+ * Only the operations the models in this package use are defined.
+ * Comparisons look at the value alone, so branches follow the same path
+ * they would with doubles.
+ */
+template <int N>
+struct Dual
+{
+  double v; // value
+  double d[N]; // derivatives
+
+  Dual() : v(0.0) { setZero(); }
+  Dual(double value) : v(value) { setZero(); }
+
+  // Independent variable i of N
+  static Dual variable(double value, int i)
+  {
+    Dual x(value);
+    x.d[i] = 1.0;
+    return x;
+  }
+
+  void setZero()
+  {
+    for (int i = 0; i < N; i++)
+      d[i] = 0.0;
+  }
+
+  Dual operator-() const
+  {
+    Dual r;
+    r.v = -v;
+    for (int i = 0; i < N; i++)
+      r.d[i] = -d[i];
+    return r;
+  }
+
+  Dual& operator+=(const Dual& b) { return *this = *this + b; }
+  Dual& operator-=(const Dual& b) { return *this = *this - b; }
+  Dual& operator*=(const Dual& b) { return *this = *this*b; }
+  Dual& operator/=(const Dual& b) { return *this = *this/b; }
+
+  // Value and derivatives scaled by the chain rule, f(v) with f'(v) = slope
+  Dual chain(double value, double slope) const
+  {
+    Dual r;
+    r.v = value;
+    for (int i = 0; i < N; i++)
+      r.d[i] = slope*d[i];
+    return r;
+  }
+
+  friend Dual operator+(const Dual& a, const Dual& b)
+  {
+    Dual r;
+    r.v = a.v + b.v;
+    for (int i = 0; i < N; i++)
+      r.d[i] = a.d[i] + b.d[i];
+    return r;
+  }
+  friend Dual operator+(const Dual& a, double b) { Dual r = a; r.v += b; return r; }
+  friend Dual operator+(double a, const Dual& b) { return b + a; }
+
+  friend Dual operator-(const Dual& a, const Dual& b)
+  {
+    Dual r;
+    r.v = a.v - b.v;
+    for (int i = 0; i < N; i++)
+      r.d[i] = a.d[i] - b.d[i];
+    return r;
+  }
+  friend Dual operator-(const Dual& a, double b) { Dual r = a; r.v -= b; return r; }
+  friend Dual operator-(double a, const Dual& b) { return -b + a; }
+
+  friend Dual operator*(const Dual& a, const Dual& b)
+  {
+    Dual r;
+    r.v = a.v*b.v;
+    for (int i = 0; i < N; i++)
+      r.d[i] = a.d[i]*b.v + a.v*b.d[i];
+    return r;
+  }
+  friend Dual operator*(const Dual& a, double b) { return a.chain(a.v*b, b); }
+  friend Dual operator*(double a, const Dual& b) { return b.chain(a*b.v, a); }
+
+  friend Dual operator/(const Dual& a, const Dual& b)
+  {
+    Dual r;
+    r.v = a.v/b.v;
+    double inv = 1.0/b.v;
+    for (int i = 0; i < N; i++)
+      r.d[i] = (a.d[i] - r.v*b.d[i])*inv;
+    return r;
+  }
+  friend Dual operator/(const Dual& a, double b) { return a.chain(a.v/b, 1.0/b); }
+  friend Dual operator/(double a, const Dual& b) { return b.chain(a/b.v, -a/(b.v*b.v)); }
+
+  friend bool operator<(const Dual& a, const Dual& b) { return a.v < b.v; }
+  friend bool operator>(const Dual& a, const Dual& b) { return a.v > b.v; }
+  friend bool operator<=(const Dual& a, const Dual& b) { return a.v <= b.v; }
+  friend bool operator>=(const Dual& a, const Dual& b) { return a.v >= b.v; }
+
+  friend Dual sqrt(const Dual& x) { double s = std::sqrt(x.v); return x.chain(s, 0.5/s); }
+  friend Dual exp(const Dual& x) { double e = std::exp(x.v); return x.chain(e, e); }
+  friend Dual sin(const Dual& x) { return x.chain(std::sin(x.v), std::cos(x.v)); }
+  friend Dual cos(const Dual& x) { return x.chain(std::cos(x.v), -std::sin(x.v)); }
+  friend Dual tan(const Dual& x) { double t = std::tan(x.v); return x.chain(t, 1.0 + t*t); }
+  friend Dual atan(const Dual& x) { return x.chain(std::atan(x.v), 1.0/(1.0 + x.v*x.v)); }
+  friend Dual asin(const Dual& x) { return x.chain(std::asin(x.v), 1.0/std::sqrt(1.0 - x.v*x.v)); }
+  friend Dual fabs(const Dual& x) { return x.v < 0.0 ? -x : x; }
+  friend Dual pow(const Dual& x, double n) { return x.chain(std::pow(x.v, n), n*std::pow(x.v, n - 1.0)); }
+  friend bool isfinite(const Dual& x) { return std::isfinite(x.v); }
+
+  friend Dual atan2(const Dual& y, const Dual& x)
+  {
+    Dual r;
+    r.v = std::atan2(y.v, x.v);
+    double inv = 1.0/(x.v*x.v + y.v*y.v);
+    for (int i = 0; i < N; i++)
+      r.d[i] = (x.v*y.d[i] - y.v*x.d[i])*inv;
+    return r;
+  }
+};
+
+// The plain value, so the same template code can branch or print with either scalar
+inline double value(double x) { return x; }
+template <int N>
+double value(const Dual<N>& x) { return x.v; }
+
+}
+
+#endif // fcu_sim_PLUGINS_DUAL_H
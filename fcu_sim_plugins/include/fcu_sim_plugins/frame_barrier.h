@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_FRAME_BARRIER_H
+#define fcu_sim_PLUGINS_FRAME_BARRIER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace fcu_sim {
+
+/*
+ * Keeps the physics thread at most depth frames ahead of a renderer.  The
+ * physics thread calls request() each time a frame falls due, which returns
+ * once no more than depth requested frames are still unrendered; the render
+ * thread calls rendered() with the scene time of each frame it finishes.
+ * Depth 0 is strict lockstep, every frame is rendered before physics moves
+ * on.  A frame reported twice (the new-frame and sensor-updated callbacks
+ * both report) counts once.
+ *
+ * If the renderer doesn't catch up within the timeout, the outstanding frames
+ * are written off and physics carries on, so a stalled renderer slows the
+ * simulation down but never stops it.
+ */
+class FrameBarrier
+{
+public:
+  struct Stats
+  {
+    uint64_t requested;
+    uint64_t rendered;
+    uint64_t waits; // requests that had to block
+    uint64_t timeouts;
+    uint64_t dropped; // frames written off after a timeout
+    int max_lag; // most frames outstanding after a request
+  };
+
+  explicit FrameBarrier(int depth = 0);
+
+  void setDepth(int depth);
+
+  // Forget outstanding frames and release a waiting request, after a world reset
+  void reset();
+
+  // A frame is due, wait up to timeout s for the pipeline to drain to depth; false on timeout
+  bool request(double timeout);
+
+  // The renderer finished the frame of the scene at sim time t
+  void rendered(double t);
+
+  Stats stats() const;
+
+private:
+  FrameBarrier(const FrameBarrier&);
+  FrameBarrier& operator=(const FrameBarrier&);
+
+  // Frames requested but not rendered, -1 when a frame was rendered ahead of its request
+  int lag() const { return static_cast<int>(static_cast<int64_t>(stats_.requested - stats_.rendered)); }
+
+  mutable std::mutex mutex_;
+  std::condition_variable frame_done_;
+  int depth_;
+  double last_rendered_time_;
+  Stats stats_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_FRAME_BARRIER_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_GAUSS_MARKOV_H
+#define fcu_sim_PLUGINS_GAUSS_MARKOV_H
+
+#include <cmath>
+
+namespace fcu_sim {
+
+/*
+ * First-order Gauss-Markov process b' = -b/tau + w, w white with density
+ * sigma, discretized exactly over a step of dt [Maybeck 4-114]:
+ *
+ *   b[k+1] = phi*b[k] + sigma_d*n,  phi = exp(-dt/tau),
+ *   sigma_d = sigma*sqrt(tau/2*(1 - phi^2)),  n ~ N(0, 1)
+ *
+ * Sensors sample at a fixed rate, so phi and sigma_d are kept for the last dt
+ * and only recomputed when it changes.  The discretization is exact for any
+ * dt, so a sensor that stopped sampling for a while can catch up with one
+ * call to skip() instead of a step() per missed sample.
+ */
+class GaussMarkov
+{
+public:
+  GaussMarkov(double tau = 1.0, double sigma = 0.0) { setParameters(tau, sigma); }
+
+  void setParameters(double tau, double sigma)
+  {
+    tau_ = tau;
+    sigma_ = sigma;
+    dt_ = -1.0;
+  }
+
+  // Next value of the process from b, dt later, given a standard normal n
+  double step(double b, double dt, double n)
+  {
+    if (dt != dt_)
+    {
+      dt_ = dt;
+      phi_ = std::exp(-dt/tau_);
+      sigma_d_ = sigma_*std::sqrt(tau_/2.0*(1.0 - phi_*phi_));
+    }
+    return phi_*b + sigma_d_*n;
+  }
+
+  // Same as step() but for a one-off dt, keeps the cached coefficients
+  double skip(double b, double dt, double n) const
+  {
+    double phi = std::exp(-dt/tau_);
+    return phi*b + sigma_*std::sqrt(tau_/2.0*(1.0 - phi*phi))*n;
+  }
+
+private:
+  double tau_;
+  double sigma_;
+
+  double dt_; // step phi_ and sigma_d_ were computed for
+  double phi_;
+  double sigma_d_;
+};
+
+/*
+ * steps samples of a discrete first-order process e = phi*e + sigma*n taken
+ * at once, for sensors whose noise is specified per sample rather than in
+ * continuous time:
+ *
+ *   e = phi^m*e + sigma*sqrt(1 + phi^2 + ... + phi^(2m-2))*n
+ */
+inline double skipSamples(double e, double phi, double sigma, int steps, double n)
+{
+  if (steps <= 0)
+    return e;
+  double phi_m = std::pow(phi, steps);
+  double gain = phi < 1.0 ? std::sqrt((1.0 - phi_m*phi_m)/(1.0 - phi*phi)) : std::sqrt(static_cast<double>(steps));
+  return phi_m*e + sigma*gain*n;
+}
+
+}
+
+#endif // fcu_sim_PLUGINS_GAUSS_MARKOV_H
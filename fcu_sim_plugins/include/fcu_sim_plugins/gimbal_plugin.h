@@ -30,6 +30,8 @@
 #include <ros/ros.h>
 #include "geometry_msgs/Vector3Stamped.h"
 #include <fcu_sim_plugins/common.h>
+#include <fcu_sim_plugins/model_state.h>
+#include <fcu_sim_plugins/sensor_scheduler.h>
 
 #include <chrono>
 #include <cmath>
@@ -61,9 +63,11 @@ private:
   ros::NodeHandle* nh_;
   ros::Subscriber command_sub_;
   ros::Publisher pose_pub_;
+  PublishRate pose_rate_;
 
   // Pointer to the gazebo items.
   physics::LinkPtr link_;
+  ModelStatePtr state_;
   physics::JointControllerPtr joint_controller_;
   physics::JointPtr yaw_joint_;
   physics::JointPtr roll_joint_;
@@ -75,7 +79,7 @@ private:
 
 
   // Pointer to the update event connection
-  event::ConnectionPtr updateConnection_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 
   // Time
   double previous_time_;
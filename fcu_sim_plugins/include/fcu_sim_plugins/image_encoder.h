@@ -0,0 +1,104 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_IMAGE_ENCODER_H
+#define fcu_sim_PLUGINS_IMAGE_ENCODER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sensor_msgs/CompressedImage.h>
+#include <sensor_msgs/Image.h>
+
+namespace fcu_sim {
+
+/*
+ * Compresses images on a small pool of worker threads so the thread that
+ * hands them over (a camera's render callback) never waits for an encode.
+ * submit() only takes a reference to the image and queues it.  When the
+ * queue is full the oldest waiting frame is dropped for the new one, because
+ * a late frame is worth less than a current one.  A frame that finishes
+ * after a newer one has already gone out is dropped too, so with several
+ * workers the output is still in order.
+ *
+ * Formats are "jpeg" (quality 1-100) and "png" (lossless, quality is the
+ * zlib level 0-9).  Output follows compressed_image_transport, "<encoding>;
+ * jpeg compressed bgr8", so its subscribers can decode it.  done is called
+ * on a worker thread, one frame at a time.
+ */
+class ImageEncoder
+{
+public:
+  typedef std::function<void(const sensor_msgs::CompressedImagePtr&)> Callback;
+
+  struct Stats
+  {
+    uint64_t submitted;
+    uint64_t encoded;
+    uint64_t dropped_queued; // overtaken while waiting in the queue
+    uint64_t dropped_stale; // finished after a newer frame
+    uint64_t failed; // encodings the format can't take, or encoder errors
+  };
+
+  ImageEncoder();
+  ~ImageEncoder();
+
+  // quality < 0 takes the format's default (90, 3); false with error filled in for an unknown format
+  bool start(const std::string& format, int quality, int threads, int queue_size, const Callback& done,
+             std::string* error);
+  void stop();
+  bool running() const { return !workers_.empty(); }
+
+  void submit(const sensor_msgs::ImageConstPtr& image);
+
+  Stats stats() const;
+
+private:
+  ImageEncoder(const ImageEncoder&);
+  ImageEncoder& operator=(const ImageEncoder&);
+
+  void work();
+  bool encode(const sensor_msgs::Image& image, sensor_msgs::CompressedImage* out) const;
+
+  std::string format_;
+  std::vector<int> params_; // for cv::imencode
+  Callback done_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable queued_;
+  std::deque<std::pair<uint64_t, sensor_msgs::ImageConstPtr> > queue_; // frame number, image
+  size_t queue_size_;
+  bool stopping_;
+  uint64_t next_frame_;
+  Stats stats_;
+
+  std::mutex output_mutex_; // keeps done calls one at a time and in order
+  uint64_t last_output_;
+
+  std::vector<std::thread> workers_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_IMAGE_ENCODER_H
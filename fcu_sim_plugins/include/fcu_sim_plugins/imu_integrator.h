@@ -0,0 +1,93 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_IMU_INTEGRATOR_H
+#define fcu_sim_PLUGINS_IMU_INTEGRATOR_H
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace fcu_sim {
+
+/*
+ * Delta angle and delta velocity over a run of IMU samples, the quantities a
+ * strapdown navigator integrates (Savage, "Strapdown Inertial Navigation
+ * Integration Algorithm Design", JGCD 1998, eqs. 15 and 24).  Each sample is
+ * taken as constant over the dt leading up to it, giving increments
+ * da = w*dt and dv = a*dt, and across samples
+ *
+ *   alpha += da                   beta  += 1/2 (alpha' + da'/6) x da
+ *   nu    += dv                   gamma += 1/2 [(alpha' + da'/6) x dv + (nu' + dv'/6) x da]
+ *
+ * where primes are the values before this sample.  The delta angle is
+ * alpha + beta (coning) and the delta velocity nu + 1/2 alpha x nu + gamma
+ * (rotation and sculling), both in the body frame at the start of the run.
+ * restart() begins a new run but keeps the last increments, which the
+ * corrections use, so consecutive runs chain without losing accuracy.
+ */
+class ImuIntegrator
+{
+public:
+  ImuIntegrator() { reset(); }
+
+  // Forget everything, including the previous increments
+  void reset()
+  {
+    restart();
+    last_da_.setZero();
+    last_dv_.setZero();
+  }
+
+  // Start a new run at the current sample
+  void restart()
+  {
+    alpha_.setZero();
+    beta_.setZero();
+    nu_.setZero();
+    gamma_.setZero();
+    time_ = 0.0;
+  }
+
+  void add(const Eigen::Vector3d& acceleration, const Eigen::Vector3d& angular_velocity, double dt)
+  {
+    Eigen::Vector3d da = angular_velocity*dt;
+    Eigen::Vector3d dv = acceleration*dt;
+    Eigen::Vector3d a = alpha_ + last_da_/6.0;
+    Eigen::Vector3d v = nu_ + last_dv_/6.0;
+    beta_ += 0.5*a.cross(da);
+    gamma_ += 0.5*(a.cross(dv) + v.cross(da));
+    alpha_ += da;
+    nu_ += dv;
+    last_da_ = da;
+    last_dv_ = dv;
+    time_ += dt;
+  }
+
+  Eigen::Vector3d deltaAngle() const { return alpha_ + beta_; }
+  Eigen::Vector3d deltaVelocity() const { return nu_ + 0.5*alpha_.cross(nu_) + gamma_; }
+  double time() const { return time_; }
+
+private:
+  Eigen::Vector3d alpha_, beta_; // angle sum and coning
+  Eigen::Vector3d nu_, gamma_; // velocity sum and sculling
+  Eigen::Vector3d last_da_, last_dv_;
+  double time_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_IMU_INTEGRATOR_H
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2015 Fadri Furrer, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Michael Burri, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Mina Kamel, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Janosch Nikolic, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Markus Achtelik, ASL, ETH Zurich, Switzerland
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef fcu_sim_PLUGINS_IMU_MODEL_H
+#define fcu_sim_PLUGINS_IMU_MODEL_H
+
+#include <Eigen/Core>
+#include <gazebo/common/common.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/gauss_markov.h"
+#include "fcu_sim_plugins/random_stream.h"
+
+namespace gazebo {
+// Default values for use with ADIS16448 IMU
+static constexpr double kDefaultAdisGyroscopeNoiseDensity =
+    2.0 * 35.0 / 3600.0 / 180.0 * M_PI;
+static constexpr double kDefaultAdisGyroscopeRandomWalk =
+    2.0 * 4.0 / 3600.0 / 180.0 * M_PI;
+static constexpr double kDefaultAdisGyroscopeBiasCorrelationTime =
+    1.0e+3;
+static constexpr double kDefaultAdisGyroscopeTurnOnBiasSigma =
+    0.5 / 180.0 * M_PI;
+static constexpr double kDefaultAdisAccelerometerNoiseDensity =
+    2.0 * 2.0e-3;
+static constexpr double kDefaultAdisAccelerometerRandomWalk =
+    2.0 * 3.0e-3;
+static constexpr double kDefaultAdisAccelerometerBiasCorrelationTime =
+    300.0;
+static constexpr double kDefaultAdisAccelerometerTurnOnBiasSigma =
+    20.0e-3 * 9.8;
+// Earth's gravity in Zurich (lat=+47.3667degN, lon=+8.5500degE, h=+500m, WGS84)
+static constexpr double kDefaultGravityMagnitude = 9.8068;
+
+// A description of the parameters:
+// https://github.com/ethz-asl/kalibr/wiki/IMU-Noise-Model-and-Intrinsics
+// TODO(burrimi): Should I have a minimalistic description of the params here?
+struct ImuParameters {
+  /// Gyroscope and accelerometer update rate (Hz)
+  double update_rate_;
+  /// Gyroscope noise density (two-sided spectrum) [rad/s/sqrt(Hz)]
+  double gyroscope_noise_density;
+  /// Gyroscope bias random walk [rad/s/s/sqrt(Hz)]
+  double gyroscope_random_walk;
+  /// Gyroscope bias correlation time constant [s]
+  double gyroscope_bias_correlation_time;
+  /// Gyroscope turn on bias standard deviation [rad/s]
+  double gyroscope_turn_on_bias_sigma;
+  /// Accelerometer noise density (two-sided spectrum) [m/s^2/sqrt(Hz)]
+  double accelerometer_noise_density;
+  /// Accelerometer bias random walk. [m/s^2/s/sqrt(Hz)]
+  double accelerometer_random_walk;
+  /// Accelerometer bias correlation time constant [s]
+  double accelerometer_bias_correlation_time;
+  /// Accelerometer turn on bias standard deviation [m/s^2]
+  double accelerometer_turn_on_bias_sigma;
+  /// Norm of the gravitational acceleration [m/s^2]
+  double gravity_magnitude;
+
+  ImuParameters()
+      : gyroscope_noise_density(kDefaultAdisGyroscopeNoiseDensity),
+        gyroscope_random_walk(kDefaultAdisGyroscopeRandomWalk),
+        gyroscope_bias_correlation_time(
+            kDefaultAdisGyroscopeBiasCorrelationTime),
+        gyroscope_turn_on_bias_sigma(kDefaultAdisGyroscopeTurnOnBiasSigma),
+        accelerometer_noise_density(kDefaultAdisAccelerometerNoiseDensity),
+        accelerometer_random_walk(kDefaultAdisAccelerometerRandomWalk),
+        accelerometer_bias_correlation_time(
+            kDefaultAdisAccelerometerBiasCorrelationTime),
+        accelerometer_turn_on_bias_sigma(
+            kDefaultAdisAccelerometerTurnOnBiasSigma),
+        gravity_magnitude(kDefaultGravityMagnitude) {}
+};
+
+/// \brief Accelerometer and gyroscope noise model of a link.
+///
+/// Shared by the IMU plugin, which publishes the samples, and the SIL plugin,
+/// which hands them straight to the firmware when it runs in lockstep.
+class ImuModel {
+ public:
+  ImuModel();
+
+  /// Read the noise parameters (same SDF elements as the IMU plugin), seed
+  /// the noise and draw the turn-on biases.
+  void Load(sdf::ElementPtr sdf, physics::LinkPtr link);
+
+  /// Measure the link's specific force and angular rate, including noise.
+  /// \param[in] dt Time since the previous sample [s].
+  /// \param[out] linear_acceleration Specific force, as published (y and z flipped from Gazebo) [m/s^2].
+  /// \param[out] angular_velocity Angular rate, as published [rad/s].
+  /// \param[out] orientation Gazebo world orientation of the link, optional.
+  void Sample(double dt,
+              Eigen::Vector3d* linear_acceleration,
+              Eigen::Vector3d* angular_velocity,
+              math::Quaternion* orientation = NULL);
+
+  /// Move the bias processes forward over samples that were never taken.
+  /// \param[in] dt Time skipped [s].
+  void Skip(double dt);
+
+  const ImuParameters& parameters() const { return imu_parameters_; }
+
+ private:
+  void addNoise(
+      Eigen::Vector3d* linear_acceleration,
+      Eigen::Vector3d* angular_velocity,
+      const double dt);
+
+  physics::LinkPtr link_;
+
+  /// Turn off noise
+  bool perfect_imu_;
+
+  fcu_sim::RandomStream random_;
+
+  /// Bias processes, and the white noise standard deviations for noise_dt_,
+  /// only recomputed when the sample interval changes.
+  fcu_sim::GaussMarkov gyroscope_bias_process_;
+  fcu_sim::GaussMarkov accelerometer_bias_process_;
+  double noise_dt_;
+  double gyroscope_sigma_d_;
+  double accelerometer_sigma_d_;
+
+  math::Vector3 gravity_W_;
+  math::Vector3 velocity_prev_W_;
+
+  Eigen::Vector3d gyroscope_bias_;
+  Eigen::Vector3d accelerometer_bias_;
+
+  Eigen::Vector3d gyroscope_turn_on_bias_;
+  Eigen::Vector3d accelerometer_turn_on_bias_;
+
+  ImuParameters imu_parameters_;
+};
+}
+
+#endif // fcu_sim_PLUGINS_IMU_MODEL_H
@@ -31,6 +31,7 @@
 #include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <sensor_msgs/Imu.h>
+#include <fcu_sim/ImuBatch.h>
 
 #include <chrono>
 #include <cmath>
@@ -40,69 +41,13 @@
 #include <boost/bind.hpp>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/imu_integrator.h"
+#include "fcu_sim_plugins/imu_model.h"
+#include "fcu_sim_plugins/lazy_sensor_plugin.h"
+#include "fcu_sim_plugins/sensor_scheduler.h"
 
 namespace gazebo {
-// Default values for use with ADIS16448 IMU
-static constexpr double kDefaultAdisGyroscopeNoiseDensity =
-    2.0 * 35.0 / 3600.0 / 180.0 * M_PI;
-static constexpr double kDefaultAdisGyroscopeRandomWalk =
-    2.0 * 4.0 / 3600.0 / 180.0 * M_PI;
-static constexpr double kDefaultAdisGyroscopeBiasCorrelationTime =
-    1.0e+3;
-static constexpr double kDefaultAdisGyroscopeTurnOnBiasSigma =
-    0.5 / 180.0 * M_PI;
-static constexpr double kDefaultAdisAccelerometerNoiseDensity =
-    2.0 * 2.0e-3;
-static constexpr double kDefaultAdisAccelerometerRandomWalk =
-    2.0 * 3.0e-3;
-static constexpr double kDefaultAdisAccelerometerBiasCorrelationTime =
-    300.0;
-static constexpr double kDefaultAdisAccelerometerTurnOnBiasSigma =
-    20.0e-3 * 9.8;
-// Earth's gravity in Zurich (lat=+47.3667degN, lon=+8.5500degE, h=+500m, WGS84)
-static constexpr double kDefaultGravityMagnitude = 9.8068;
-
-// A description of the parameters:
-// https://github.com/ethz-asl/kalibr/wiki/IMU-Noise-Model-and-Intrinsics
-// TODO(burrimi): Should I have a minimalistic description of the params here?
-struct ImuParameters {
-  /// Gyroscope and accelerometer update rate (Hz)
-  double update_rate_;
-  /// Gyroscope noise density (two-sided spectrum) [rad/s/sqrt(Hz)]
-  double gyroscope_noise_density;
-  /// Gyroscope bias random walk [rad/s/s/sqrt(Hz)]
-  double gyroscope_random_walk;
-  /// Gyroscope bias correlation time constant [s]
-  double gyroscope_bias_correlation_time;
-  /// Gyroscope turn on bias standard deviation [rad/s]
-  double gyroscope_turn_on_bias_sigma;
-  /// Accelerometer noise density (two-sided spectrum) [m/s^2/sqrt(Hz)]
-  double accelerometer_noise_density;
-  /// Accelerometer bias random walk. [m/s^2/s/sqrt(Hz)]
-  double accelerometer_random_walk;
-  /// Accelerometer bias correlation time constant [s]
-  double accelerometer_bias_correlation_time;
-  /// Accelerometer turn on bias standard deviation [m/s^2]
-  double accelerometer_turn_on_bias_sigma;
-  /// Norm of the gravitational acceleration [m/s^2]
-  double gravity_magnitude;
-
-  ImuParameters()
-      : gyroscope_noise_density(kDefaultAdisGyroscopeNoiseDensity),
-        gyroscope_random_walk(kDefaultAdisGyroscopeRandomWalk),
-        gyroscope_bias_correlation_time(
-            kDefaultAdisGyroscopeBiasCorrelationTime),
-        gyroscope_turn_on_bias_sigma(kDefaultAdisGyroscopeTurnOnBiasSigma),
-        accelerometer_noise_density(kDefaultAdisAccelerometerNoiseDensity),
-        accelerometer_random_walk(kDefaultAdisAccelerometerRandomWalk),
-        accelerometer_bias_correlation_time(
-            kDefaultAdisAccelerometerBiasCorrelationTime),
-        accelerometer_turn_on_bias_sigma(
-            kDefaultAdisAccelerometerTurnOnBiasSigma),
-        gravity_magnitude(kDefaultGravityMagnitude) {}
-};
-
-class ImuPlugin : public ModelPlugin {
+class ImuPlugin : public LazySensorPlugin {
  public:
 
   ImuPlugin();
@@ -116,27 +61,20 @@ class ImuPlugin : public ModelPlugin {
 
   void Reset();
 
-  void addNoise(
-      Eigen::Vector3d* linear_acceleration,
-      Eigen::Vector3d* angular_velocity,
-      const double dt);
-
   void OnUpdate(const common::UpdateInfo&);
+  void AddToBatch(const common::Time& time, const Eigen::Vector3d& linear_acceleration,
+                  const Eigen::Vector3d& angular_velocity, double dt);
 
  private:
   std::string namespace_;
   std::string imu_topic_;
   ros::NodeHandle* node_handle_;
+  std::string batch_topic_;
   ros::Publisher imu_pub_;
+  ros::Publisher batch_pub_;
   std::string frame_id_;
   std::string link_name_;
 
-  /// Turn off noise
-  bool perfect_imu_;
-
-  std::default_random_engine random_generator_;
-  std::normal_distribution<double> standard_normal_distribution_;
-
   // Pointer to the world
   physics::WorldPtr world_;
   // Pointer to the model
@@ -144,22 +82,19 @@ class ImuPlugin : public ModelPlugin {
   // Pointer to the link
   physics::LinkPtr link_;
   // Pointer to the update event connection
-  event::ConnectionPtr updateConnection_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 
   common::Time last_time_;
 
   sensor_msgs::Imu imu_message_;
 
-  math::Vector3 gravity_W_;
-  math::Vector3 velocity_prev_W_;
-
-  Eigen::Vector3d gyroscope_bias_;
-  Eigen::Vector3d accelerometer_bias_;
-
-  Eigen::Vector3d gyroscope_turn_on_bias_;
-  Eigen::Vector3d accelerometer_turn_on_bias_;
+  // Samples per batch message, 1 publishes every sample as a sensor_msgs/Imu instead
+  int batch_size_;
+  int batch_count_;
+  fcu_sim::ImuBatch batch_message_;
+  fcu_sim::ImuIntegrator integrator_;
 
-  ImuParameters imu_parameters_;
+  ImuModel imu_;
 };
 }
 
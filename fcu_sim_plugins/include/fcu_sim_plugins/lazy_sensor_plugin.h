@@ -0,0 +1,97 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_LAZY_SENSOR_PLUGIN_H
+#define fcu_sim_PLUGINS_LAZY_SENSOR_PLUGIN_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <gazebo/common/common.hh>
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/gazebo.hh>
+#include <ros/ros.h>
+
+#include "fcu_sim_plugins/common.h"
+
+namespace gazebo {
+
+/*
+ * Base for sensor plugins that only need to run while someone listens.
+ *
+ * A sensor hands over the publishers its output goes out on, then asks
+ * SampleNeeded() each time the scheduler calls it.  With no subscriber on any
+ * of them the sample is skipped before the model or the noise is evaluated.
+ * When a subscriber shows up again, SampleNeeded() reports how many samples
+ * were passed over so the sensor can move its correlated noise (biases,
+ * Gauss-Markov errors) forward by that much in one exact step, and the output
+ * has the same statistics as if it had run all along.  White noise needs no
+ * catching up.
+ *
+ * <lazy>false</lazy> in the SDF makes the sensor always run, which also keeps
+ * its noise sequence independent of who was subscribed when.
+ */
+class LazySensorPlugin : public ModelPlugin
+{
+protected:
+  LazySensorPlugin() : lazy_(true), period_(0.0) {}
+
+  // Read <lazy> and remember the sample period [s] of the sensor (0 for every
+  // step).  start is the sim time the sensor's state is valid at, so a gap
+  // before the first subscriber counts as skipped samples like any other.
+  void LoadLazySensor(sdf::ElementPtr sdf, double period, const common::Time& start)
+  {
+    getSdfParam<bool>(sdf, "lazy", lazy_, true);
+    period_ = period;
+    last_sample_ = start;
+  }
+
+  // A sample is needed while this publisher has subscribers
+  void AddConsumer(const ros::Publisher& publisher)
+  {
+    consumers_.push_back(publisher);
+  }
+
+  // False if nobody would see the sample due at time.  Otherwise skipped is
+  // set to the number of samples passed over since the last one computed.
+  bool SampleNeeded(const common::Time& time, int* skipped)
+  {
+    bool needed = !lazy_;
+    for (size_t i = 0; !needed && i < consumers_.size(); i++)
+      needed = consumers_[i].getNumSubscribers() > 0;
+    if (!needed)
+      return false;
+
+    *skipped = 0;
+    if (period_ > 0.0 && time > last_sample_)
+      *skipped = std::max(0L, lround((time - last_sample_).Double()/period_) - 1);
+    last_sample_ = time;
+    return true;
+  }
+
+private:
+  bool lazy_;
+  double period_;
+  std::vector<ros::Publisher> consumers_;
+
+  common::Time last_sample_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_LAZY_SENSOR_PLUGIN_H
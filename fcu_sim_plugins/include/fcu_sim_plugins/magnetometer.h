@@ -25,15 +25,18 @@
 #include <gazebo/physics/physics.hh>
 #include <sensor_msgs/MagneticField.h>
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/lazy_sensor_plugin.h"
+#include "fcu_sim_plugins/model_state.h"
+#include "fcu_sim_plugins/random_stream.h"
+#include "fcu_sim_plugins/sensor_scheduler.h"
 
-#include <random>
 #include <tf/tf.h>
 
 
 
 namespace gazebo {
 
-class MagnetometerPlugin : public ModelPlugin {
+class MagnetometerPlugin : public LazySensorPlugin {
  public:
 
   MagnetometerPlugin();
@@ -58,7 +61,6 @@ class MagnetometerPlugin : public ModelPlugin {
   std::string frame_id_;
   std::string link_name_;
   double pub_rate_;
-  double next_pub_time_;
 
   // True Values
   double inclination_;
@@ -74,15 +76,14 @@ class MagnetometerPlugin : public ModelPlugin {
   double bias_range_;
 
   // Random Number stuff for noise
-  std::default_random_engine random_gen_;
-  std::normal_distribution<double> normal_dist_;
-  std::uniform_real_distribution<double> uniform_dist_;
+  fcu_sim::RandomStream random_;
 
   // Gazebo connections
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
-  event::ConnectionPtr updateConnection_;
+  ModelStatePtr state_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 };
 }
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_MESSAGE_POOL_H
+#define fcu_sim_PLUGINS_MESSAGE_POOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <gazebo/common/Console.hh>
+
+namespace gazebo {
+
+/**
+ * \brief Recycles the messages one publisher sends out every tick.
+ *
+ * Publishing a shared_ptr lets roscpp hand the message to nodelets in the
+ * same process without a copy, but a new message per tick is a heap
+ * allocation per tick (and more for any strings or arrays inside).  The pool
+ * keeps up to capacity messages and hands out one that nobody holds any more,
+ * which is the case once every subscriber has released it, so a pooled
+ * message is never changed under a reader.  Only while all of them are still
+ * in use is a new one allocated, so in steady state allocations() stops
+ * growing.
+ *
+ * Messages come back with whatever they held last time, set every field you
+ * publish.  One pool per publisher, used from one thread.
+ */
+template<class M>
+class MessagePool {
+ public:
+  typedef boost::shared_ptr<M> Ptr;
+
+  explicit MessagePool(size_t capacity = 4) :
+    capacity_(capacity),
+    next_(0),
+    acquired_(0),
+    allocations_(0) {
+    pool_.reserve(capacity);
+  }
+
+  /// A message nobody else holds, from the pool if one is free
+  Ptr acquire() {
+    acquired_++;
+    for (size_t i = 0; i < pool_.size(); i++) {
+      size_t j = (next_ + i) % pool_.size();
+      if (pool_[j].unique()) {
+        next_ = (j + 1) % pool_.size();
+        return pool_[j];
+      }
+    }
+
+    allocations_++;
+    Ptr message = boost::make_shared<M>();
+    if (pool_.size() < capacity_)
+      pool_.push_back(message);
+    return message;
+  }
+
+  /// Number of messages handed out
+  uint64_t acquired() const { return acquired_; }
+
+  /// Number of messages that had to be allocated
+  uint64_t allocations() const { return allocations_; }
+
+  /// Log the counters for the owning plugin's shutdown, as a warning if the
+  /// pool kept allocating after filling up (a subscriber holding on to
+  /// messages, or too small a capacity)
+  void report(const std::string& name) const {
+    if (acquired_ == 0)
+      return;
+    if (allocations_ > capacity_)
+      gzwarn << "[MessagePool] " << name << ": " << acquired_ << " messages needed " << allocations_
+             << " allocations, " << allocations_ - capacity_ << " past the pool of " << capacity_ << "\n";
+    else
+      gzmsg << "[MessagePool] " << name << ": " << acquired_ << " messages from " << allocations_
+            << " allocations\n";
+  }
+
+ private:
+  std::vector<Ptr> pool_;
+  size_t capacity_;
+  size_t next_; // where to start looking, the oldest message is the likeliest to be free
+  uint64_t acquired_;
+  uint64_t allocations_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_MESSAGE_POOL_H
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_MODEL_STATE_H
+#define fcu_sim_PLUGINS_MODEL_STATE_H
+
+#include <cstdint>
+
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Dense>
+#include <gazebo/common/common.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include "fcu_sim_plugins/wind_source.h"
+
+namespace gazebo {
+
+/*
+ * State of a vehicle link in the aeronautical NED frame, taken once per
+ * physics step.
+ *
+ * Every plugin on a vehicle used to query Gazebo for the CoG pose and body
+ * rates and flip them from NWU to NED on its own.  ModelState is shared by all
+ * plugins attached to the same link, and fills in the snapshot the first time
+ * someone asks for it on a given step.  Everyone after that gets the same
+ * numbers for free.
+ *
+ * The wind comes from the model's WindSource, queried at the link's NED
+ * position as part of the snapshot.
+ *
+ * Snapshot() must only be called from the physics thread (the WorldUpdateBegin
+ * and sensor scheduler callbacks).
+ */
+class ModelState
+{
+public:
+  struct NEDState
+  {
+    common::Time time;
+    uint64_t iteration;
+
+    // As reported by Gazebo (NWU), for plugins that publish poses
+    math::Pose W_pose_W_C;
+    math::Vector3 C_linear_velocity_W_C;
+    math::Vector3 C_angular_velocity_W_C;
+
+    double pn, pe, pd; // m
+    double phi, theta, psi; // rad
+    double u, v, w; // body velocity, m/s
+    double p, q, r; // body rates, rad/s
+    math::Quaternion attitude; // body to NED
+    Eigen::Matrix3d R; // body to NED
+
+    math::Vector3 wind; // inertial NED, m/s
+    math::Vector3 wind_body; // the same wind in the body frame, m/s
+    double ur, vr, wr; // body velocity relative to the air, m/s
+    double Va; // m/s
+  };
+
+  // The state shared by every plugin attached to link
+  static boost::shared_ptr<ModelState> Get(physics::LinkPtr link);
+
+  // Current step's snapshot, computed on first use
+  const NEDState& Snapshot();
+
+private:
+  explicit ModelState(physics::LinkPtr link);
+
+  void Compute();
+
+  physics::LinkPtr link_;
+  physics::WorldPtr world_;
+
+  NEDState state_;
+  bool valid_;
+
+  WindSourcePtr wind_source_;
+};
+
+typedef boost::shared_ptr<ModelState> ModelStatePtr;
+
+}
+
+#endif // fcu_sim_PLUGINS_MODEL_STATE_H
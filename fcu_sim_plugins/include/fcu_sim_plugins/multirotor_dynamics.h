@@ -0,0 +1,216 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_MULTIROTOR_DYNAMICS_H
+#define fcu_sim_PLUGINS_MULTIROTOR_DYNAMICS_H
+
+#include <cstddef>
+#include <vector>
+
+namespace fcu_sim {
+
+/*
+ * Simplified multirotor force and moment model, free of any Gazebo or ROS
+ * types.  This is the model that used to live inside
+ * MultiRotorForcesAndMoments::UpdateForcesAndMoments: PID attitude/altitude
+ * control, first-order actuator response, a ground-effect polynomial and
+ * linear/angular drag (Leishman et al.).
+ *
+ * State is kept as a structure of arrays, one entry per vehicle, so a single
+ * call to step() advances N vehicles with tight loops over contiguous
+ * buffers that the compiler can vectorize.  The Gazebo plugin runs a batch of
+ * size one; headless tools can run thousands.
+ *
+ * Everything is in NED.  The caller writes state and command buffers, calls
+ * step(), and reads the body-fixed forces and torques back out.
+ */
+
+// Command modes understood by the model.  These mirror the subset of
+// rosflight_msgs::Command modes the plugin has always supported.
+enum MultirotorCommandMode
+{
+  MODE_NONE = -1, // no command yet, hold the previous desired forces
+  MODE_RATE_THROTTLE = 0, // roll rate, pitch rate, yaw rate, throttle
+  MODE_ANGLE_THROTTLE = 1, // roll, pitch, yaw rate, throttle
+  MODE_ANGLE_ALTITUDE = 2 // roll, pitch, yaw rate, altitude
+};
+
+struct MultirotorParams
+{
+  struct Actuator{
+    double max;
+    double tau_up;
+    double tau_down;
+  };
+
+  struct Gains{
+    double P;
+    double I;
+    double D;
+  };
+
+  double mass; // for static thrust offset when in altitude mode (kg)
+  double linear_mu;
+  double angular_mu;
+  double ground_effect[5]; // 4th order polynomial in height, highest order first
+
+  Actuator l;
+  Actuator m;
+  Actuator n;
+  Actuator F;
+
+  Gains roll;
+  Gains pitch;
+  Gains yaw;
+  Gains alt;
+
+  MultirotorParams();
+
+  /*
+   * Fill in parameters from anything with a ros::NodeHandle-style
+   * param<double>(name, default) and getParam(name, list) lookup
+   * (rosparam, yaml files, ...).  Missing parameters keep their defaults.
+   */
+  template <class Source>
+  void load(Source& src);
+};
+
+class MultirotorDynamics
+{
+public:
+  explicit MultirotorDynamics(size_t num_vehicles = 0);
+
+  void resize(size_t num_vehicles);
+  size_t size() const { return size_; }
+
+  void setParams(size_t i, const MultirotorParams& params);
+  void setParams(const MultirotorParams& params); // same params for every vehicle
+
+  // Clear filter and controller memory
+  void reset(size_t i);
+  void reset();
+
+  // Advance every vehicle by dt seconds
+  void step(double dt);
+
+  // Inputs - written by the caller before every step
+  struct StateBuffers{
+    std::vector<double> pd;
+    std::vector<double> phi, theta;
+    std::vector<double> u, v, w;
+    std::vector<double> p, q, r;
+    std::vector<double> wind_u, wind_v, wind_w; // wind, body frame
+  } state;
+
+  struct CommandBuffers{
+    std::vector<int> mode;
+    std::vector<double> x, y, z, F;
+  } command;
+
+  // Outputs - body-fixed forces and torques
+  struct ForceBuffers{
+    std::vector<double> Fx, Fy, Fz;
+    std::vector<double> l, m, n;
+  } forces;
+
+private:
+  // Structure-of-arrays PID bank, follows rosflight_utils::SimplePID
+  struct PIDBank{
+    std::vector<double> kp, ki, kd;
+    std::vector<double> integrator;
+    std::vector<double> differentiator;
+    std::vector<double> last_error;
+    std::vector<double> last_state;
+    void resize(size_t n);
+    void reset(size_t i);
+  };
+
+  struct ActuatorBank{
+    std::vector<double> max, tau_up, tau_down;
+    std::vector<double> desired, applied;
+    void resize(size_t n);
+  };
+
+  static void computePID(PIDBank& pid, const double* desired, const double* current, const double* x_dot,
+                         const char* has_x_dot, const char* active, double dt, double* out);
+  static void filterActuator(ActuatorBank& act, double min_scale, double dt);
+
+  size_t size_;
+
+  std::vector<double> mass_;
+  std::vector<double> linear_mu_;
+  std::vector<double> angular_mu_;
+  std::vector<double> ge_a_, ge_b_, ge_c_, ge_d_, ge_e_;
+
+  ActuatorBank l_, m_, n_, F_;
+  PIDBank roll_, pitch_, yaw_, alt_;
+
+  // scratch space, kept around so step() never allocates
+  std::vector<double> current_, x_dot_, out_;
+  std::vector<char> has_x_dot_, active_;
+};
+
+
+template <class Source>
+void MultirotorParams::load(Source& src)
+{
+  mass = src.template param<double>("mass", mass);
+
+  // Drag Constant
+  linear_mu = src.template param<double>("linear_mu", linear_mu);
+  angular_mu = src.template param<double>("angular_mu", angular_mu);
+
+  /* Ground Effect Coefficients */
+  std::vector<double> ground_effect_list;
+  if (src.getParam("ground_effect", ground_effect_list) && ground_effect_list.size() == 5)
+  {
+    for (int i = 0; i < 5; i++)
+      ground_effect[i] = ground_effect_list[i];
+  }
+
+  // Build Actuators Container
+  l.max = src.template param<double>("max_l", l.max); // N-m
+  m.max = src.template param<double>("max_m", m.max); // N-m
+  n.max = src.template param<double>("max_n", n.max); // N-m
+  F.max = src.template param<double>("max_F", F.max); // N
+  l.tau_up = src.template param<double>("tau_up_l", l.tau_up);
+  m.tau_up = src.template param<double>("tau_up_m", m.tau_up);
+  n.tau_up = src.template param<double>("tau_up_n", n.tau_up);
+  F.tau_up = src.template param<double>("tau_up_F", F.tau_up);
+  l.tau_down = src.template param<double>("tau_down_l", l.tau_down);
+  m.tau_down = src.template param<double>("tau_down_m", m.tau_down);
+  n.tau_down = src.template param<double>("tau_down_n", n.tau_down);
+  F.tau_down = src.template param<double>("tau_down_F", F.tau_down);
+
+  // Get PID Gains
+  roll.P = src.template param<double>("roll_P", roll.P);
+  roll.I = src.template param<double>("roll_I", roll.I);
+  roll.D = src.template param<double>("roll_D", roll.D);
+  pitch.P = src.template param<double>("pitch_P", pitch.P);
+  pitch.I = src.template param<double>("pitch_I", pitch.I);
+  pitch.D = src.template param<double>("pitch_D", pitch.D);
+  yaw.P = src.template param<double>("yaw_P", yaw.P);
+  yaw.I = src.template param<double>("yaw_I", yaw.I);
+  yaw.D = src.template param<double>("yaw_D", yaw.D);
+  alt.P = src.template param<double>("alt_P", alt.P);
+  alt.I = src.template param<double>("alt_I", alt.I);
+  alt.D = src.template param<double>("alt_D", alt.D);
+}
+
+}
+
+#endif // fcu_sim_PLUGINS_MULTIROTOR_DYNAMICS_H
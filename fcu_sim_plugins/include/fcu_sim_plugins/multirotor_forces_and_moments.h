@@ -33,11 +33,13 @@
 
 #include <rosflight_msgs/Command.h>
 #include <rosflight_msgs/Attitude.h>
-#include <rosflight_utils/simple_pid.h>
 #include <std_msgs/Float32.h>
-#include <geometry_msgs/Vector3.h>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/message_pool.h"
+#include "fcu_sim_plugins/multirotor_dynamics.h"
+#include "fcu_sim_plugins/model_state.h"
+#include "fcu_sim_plugins/update_timer.h"
 
 namespace gazebo {
 
@@ -59,7 +61,6 @@ protected:
 
 private:
   std::string command_topic_;
-  std::string wind_speed_topic_;
   std::string attitude_topic_;
   std::string joint_name_;
   std::string link_name_;
@@ -70,54 +71,19 @@ private:
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
+  ModelStatePtr state_;
   physics::JointPtr joint_;
   physics::EntityPtr parent_link_;
   event::ConnectionPtr updateConnection_; // Pointer to the update event connection.
+  fcu_sim::UpdateTimer* update_timer_;
+  fcu_sim::UpdateTimer* command_timer_; // CommandCallback, on a ROS spinner thread
 
-  // physical parameters
-  double linear_mu_;
-  double angular_mu_;
-  struct GE_constants{
-    double a;
-    double b;
-    double c;
-    double d;
-    double e;
-  } ground_effect_;
-  double mass_; // for static thrust offset when in altitude mode (kg)
-
-  // Container for an Actuator
-  struct Actuator{
-    double max;
-    double tau_up;
-    double tau_down;
-  };
-
-  // Struct of Actuators
-  // This organizes the physical limitations of the abstract torques and Force
-  struct Actuators{
-    Actuator l;
-    Actuator m;
-    Actuator n;
-    Actuator F;
-  } actuators_;
-
-  // container for forces
-  struct ForcesAndTorques{
-    double Fx;
-    double Fy;
-    double Fz;
-    double l;
-    double m;
-    double n;
-  } applied_forces_, actual_forces_, desired_forces_;
-
-  // container for PID controller
-  rosflight_utils::SimplePID roll_controller_;
-  rosflight_utils::SimplePID pitch_controller_;
-  rosflight_utils::SimplePID yaw_controller_;
-  rosflight_utils::SimplePID alt_controller_;
+  // Gazebo-free force and moment model, run as a batch of one vehicle
+  fcu_sim::MultirotorParams params_;
+  fcu_sim::MultirotorDynamics dynamics_;
 
+  // Latest command, handed over from the ROS callback
+  Mailbox<rosflight_msgs::Command> command_mailbox_;
   rosflight_msgs::Command command_;
 
   // Time Counters
@@ -126,19 +92,14 @@ private:
 
   ros::NodeHandle* nh_;
   ros::Subscriber command_sub_;
-  ros::Subscriber wind_speed_sub_;
   ros::Publisher attitude_pub_;
+  PublishRate attitude_rate_;
+  MessagePool<rosflight_msgs::Attitude> attitude_pool_;
 
   boost::thread callback_queue_thread_;
   void QueueThread();
-  void WindSpeedCallback(const geometry_msgs::Vector3& wind);
   void CommandCallback(const rosflight_msgs::Command msg);
-  void ComputeControl(void);
-  double sat(double x, double max, double min);
-  double max(double x, double y);
-
-  std::unique_ptr<FirstOrderFilter<double>>  rotor_velocity_filter_;
-  math::Vector3 W_wind_speed_;
+  int ModelMode(int command_mode) const;
 };
 }
 
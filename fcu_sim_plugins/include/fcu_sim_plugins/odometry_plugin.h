@@ -49,6 +49,9 @@
 #include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <fcu_sim_plugins/common.h>
+#include <fcu_sim_plugins/message_pool.h>
+#include <fcu_sim_plugins/model_state.h>
+#include <fcu_sim_plugins/sensor_scheduler.h>
 #include <tf/transform_broadcaster.h>
 #include <tf/tf.h>
 #include <chrono>
@@ -119,16 +122,22 @@ class OdometryPlugin : public ModelPlugin {
   ros::Publisher odometry_pub_;
   ros::Publisher euler_pub_;
 
+  MessagePool<geometry_msgs::PoseStamped> pose_pool_;
+  MessagePool<geometry_msgs::TransformStamped> transform_pool_;
+  MessagePool<nav_msgs::Odometry> odometry_pool_;
+  MessagePool<geometry_msgs::Vector3Stamped> euler_pool_;
+
   tf::Transform tf_;
   tf::TransformBroadcaster transform_broadcaster_;
 
   physics::WorldPtr world_;
   physics::ModelPtr model_;
   physics::LinkPtr link_;
+  ModelStatePtr state_;
   physics::EntityPtr parent_link_;
 
   /// \brief Pointer to the update event connection.
-  event::ConnectionPtr updateConnection_;
+  SensorScheduler::ConnectionPtr updateConnection_;
 
   boost::thread callback_queue_thread_;
   void QueueThread();
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_RANDOM_STREAM_H
+#define fcu_sim_PLUGINS_RANDOM_STREAM_H
+
+#include <cstdint>
+#include <string>
+
+namespace fcu_sim {
+
+/*
+ * Counter-based random number stream (Philox4x32-10, Salmon et al., SC11).
+ * Block n of a stream is a pure function of (key, n), so a stream needs no
+ * warm-up, costs nothing to create, and any number of them can be cut from
+ * one seed without overlapping: the key mixes the seed with a substream name,
+ * typically the vehicle namespace plus what the noise is for.
+ *
+ * Philox runs on a whole block of counters at once, written lane by lane so
+ * the compiler turns the rounds into SIMD multiplies.  Normals come from a
+ * 256-layer ziggurat (Marsaglia and Tsang, in Doornik's form) fed by that
+ * block, which accepts about 99% of draws with one word, a multiply and a
+ * compare, and are also produced a block at a time.  The per-sample cost is
+ * mostly a load and a compare.  The same seed and substream always give the
+ * same sequence, on any machine.
+ */
+class RandomStream
+{
+public:
+  RandomStream(uint64_t seed = 0, const std::string& substream = "");
+
+  // Restart the stream at block 0 of (seed, substream)
+  void seed(uint64_t seed, const std::string& substream = "");
+
+  // Restart the stream at block 0 of a raw Philox key
+  void setKey(const uint32_t key[2]);
+
+  // The next 64 random bits.  Philox of counter {n, n >> 32, 0, 0} gives
+  // words 2n (out[0] in the high half, out[1] low) and 2n + 1 (out[2], out[3])
+  uint64_t nextWord()
+  {
+    if (word_index_ == kBlockSize)
+      refillWords();
+    return words_[word_index_++];
+  }
+
+  // uniform on [0, 1), the top 53 bits of the next word
+  double uniform() { return (nextWord() >> 11)*(1.0/9007199254740992.0); }
+
+  double uniform(double min, double max) { return min + (max - min)*uniform(); }
+
+  // standard normal
+  double normal()
+  {
+    if (normal_index_ == kBlockSize)
+      refillNormal();
+    return normal_[normal_index_++];
+  }
+
+  double normal(double mean, double stddev) { return mean + stddev*normal(); }
+
+  // n standard normals, the same values n calls to normal() would give
+  void normals(double* out, int n);
+
+  // FNV-1a, stable across platforms and runs unlike std::hash
+  static uint64_t hash(const std::string& name);
+
+  // One Philox4x32-10 block in place, the reference the stream's lane-parallel
+  // version must match
+  static void philox4x32_10(const uint32_t key[2], uint32_t ctr[4]);
+
+private:
+  static const int kBlockSize = 64; // words or normals per buffer, 32 Philox calls
+
+  void refillWords();
+  void refillNormal();
+  double normalTail(bool negative);
+
+  uint32_t key_[2];
+  uint64_t counter_;
+
+  uint64_t words_[kBlockSize];
+  double normal_[kBlockSize];
+  int word_index_;
+  int normal_index_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_RANDOM_STREAM_H
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_RIGID_BODY_H
+#define fcu_sim_PLUGINS_RIGID_BODY_H
+
+#include <cmath>
+
+namespace fcu_sim {
+
+/*
+ * 12-state rigid body equations of motion in NED with 3-2-1 Euler angles,
+ * following chapter 3 of Small Unmanned Aircraft: Theory and Practice by
+ * Randy Beard and Tim McLain.  This stands in for the Gazebo physics engine
+ * when running the force models headless.
+ */
+
+enum RigidBodyStateIndex
+{
+  STATE_PN, STATE_PE, STATE_PD,
+  STATE_U, STATE_V, STATE_W,
+  STATE_PHI, STATE_THETA, STATE_PSI,
+  STATE_P, STATE_Q, STATE_R,
+  NUM_RIGID_BODY_STATES
+};
+
+struct RigidBodyParams
+{
+  double mass;
+  double Jx;
+  double Jy;
+  double Jz;
+  double Jxz;
+  double gravity;
+
+  RigidBodyParams();
+};
+
+// Forces and moments are body-fixed [Fx Fy Fz l m n] and do not include gravity.
+// Templated on the scalar type like computeAircraftForces()
+template <class T>
+void rigidBodyDerivatives(const RigidBodyParams& params, const T x[NUM_RIGID_BODY_STATES],
+                          const T fm[6], T xdot[NUM_RIGID_BODY_STATES]);
+
+// Fixed-step RK4, holding the forces and moments constant across the step like Gazebo does
+void rigidBodyStep(const RigidBodyParams& params, double x[NUM_RIGID_BODY_STATES], const double fm[6], double dt);
+
+
+template <class T>
+void rigidBodyDerivatives(const RigidBodyParams& P, const T x[NUM_RIGID_BODY_STATES],
+                          const T fm[6], T xdot[NUM_RIGID_BODY_STATES])
+{
+  using std::cos;
+  using std::sin;
+
+  T u = x[STATE_U];
+  T v = x[STATE_V];
+  T w = x[STATE_W];
+  T p = x[STATE_P];
+  T q = x[STATE_Q];
+  T r = x[STATE_R];
+
+  T cphi = cos(x[STATE_PHI]);
+  T sphi = sin(x[STATE_PHI]);
+  T cth = cos(x[STATE_THETA]);
+  T sth = sin(x[STATE_THETA]);
+  T tth = sth/cth;
+  T cpsi = cos(x[STATE_PSI]);
+  T spsi = sin(x[STATE_PSI]);
+
+  // Position kinematics, body velocities rotated into the inertial frame (eq 3.14)
+  xdot[STATE_PN] = cth*cpsi*u + (sphi*sth*cpsi - cphi*spsi)*v + (cphi*sth*cpsi + sphi*spsi)*w;
+  xdot[STATE_PE] = cth*spsi*u + (sphi*sth*spsi + cphi*cpsi)*v + (cphi*sth*spsi - sphi*cpsi)*w;
+  xdot[STATE_PD] = -sth*u + sphi*cth*v + cphi*cth*w;
+
+  // Translational dynamics with gravity expressed in the body frame (eq 3.15)
+  double g = P.gravity;
+  xdot[STATE_U] = r*v - q*w - g*sth + fm[0]/P.mass;
+  xdot[STATE_V] = p*w - r*u + g*cth*sphi + fm[1]/P.mass;
+  xdot[STATE_W] = q*u - p*v + g*cth*cphi + fm[2]/P.mass;
+
+  // Rotational kinematics (eq 3.16)
+  xdot[STATE_PHI] = p + (sphi*q + cphi*r)*tth;
+  xdot[STATE_THETA] = cphi*q - sphi*r;
+  xdot[STATE_PSI] = (sphi*q + cphi*r)/cth;
+
+  // Rotational dynamics (eq 3.17)
+  double Gamma = P.Jx*P.Jz - P.Jxz*P.Jxz;
+  double G1 = P.Jxz*(P.Jx - P.Jy + P.Jz)/Gamma;
+  double G2 = (P.Jz*(P.Jz - P.Jy) + P.Jxz*P.Jxz)/Gamma;
+  double G3 = P.Jz/Gamma;
+  double G4 = P.Jxz/Gamma;
+  double G5 = (P.Jz - P.Jx)/P.Jy;
+  double G6 = P.Jxz/P.Jy;
+  double G7 = ((P.Jx - P.Jy)*P.Jx + P.Jxz*P.Jxz)/Gamma;
+  double G8 = P.Jx/Gamma;
+  xdot[STATE_P] = G1*p*q - G2*q*r + G3*fm[3] + G4*fm[5];
+  xdot[STATE_Q] = G5*p*r - G6*(p*p - r*r) + fm[4]/P.Jy;
+  xdot[STATE_R] = G7*p*q - G1*q*r + G4*fm[3] + G8*fm[5];
+}
+
+}
+
+#endif // fcu_sim_PLUGINS_RIGID_BODY_H
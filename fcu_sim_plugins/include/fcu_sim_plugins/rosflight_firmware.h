@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_ROSFLIGHT_FIRMWARE_H
+#define fcu_sim_PLUGINS_ROSFLIGHT_FIRMWARE_H
+
+#include <string>
+
+// include the ROSflight headers
+extern "C"
+{
+#include "ROSflight_SIL.h"
+#include "board.h"
+#include "rosflight.h"
+#include "estimator.h"
+#include "mixer.h"
+#include "mode.h"
+#include "controller.h"
+#include "sensors.h"
+}
+
+namespace gazebo {
+
+/*
+ * A private copy of the ROSflight firmware.
+ *
+ * The firmware and the SIL board keep all of their state in globals, so
+ * linking them into the plugin allows one simulated flight controller per
+ * Gazebo server.  Instead, the firmware is built as its own shared library and
+ * every instance loads it into a fresh dynamic linker namespace (dlmopen), which
+ * gives each one its own copy of every global.  The members below point into
+ * that copy.  Arrays are pointers to the whole array, so index them as
+ * (*fw.outputs)[i].
+ *
+ * Each copy also loads its own libc and libm, whose TLS comes out of a small
+ * static TLS reserve.  With the default reserve a bare test process runs out
+ * at the 12th copy ("cannot allocate memory in static TLS block"), and
+ * gzserver's own libraries use part of the same reserve, so expect fewer,
+ * about 10.  Raising the reserve with
+ *   GLIBC_TUNABLES=glibc.rtld.optional_static_tls=4096
+ * (glibc 2.32 and later, set in the launch files) lifts that to glibc's hard
+ * limit of 16 linker namespaces, 15 copies.
+ */
+class FirmwareInstance
+{
+public:
+  FirmwareInstance();
+  ~FirmwareInstance();
+
+  // Load a copy of library (searched like dlopen does), false with error filled in on failure
+  bool Load(const std::string& library, std::string* error);
+
+  // Functions
+  decltype(&::rosflight_init) init;
+  decltype(&::rosflight_run) run;
+  decltype(&::SIL_call_IMU_ISR) call_imu_isr;
+  decltype(&::start_imu_calibration) start_imu_calibration;
+
+  // SIL board
+  decltype(&::SIL_now_us) now_us;
+  decltype(&::accel_read_raw) accel_read_raw;
+  decltype(&::gyro_read_raw) gyro_read_raw;
+  decltype(&::temp_read_raw) temp_read_raw;
+  decltype(&::_rc_signals) rc_signals;
+
+  // Firmware state
+  decltype(&::_armed_state) armed_state;
+  decltype(&::_combined_control) combined_control;
+  decltype(&::_command) command;
+  decltype(&::_current_state) current_state;
+  decltype(&::_outputs) outputs;
+
+private:
+  template<class T>
+  bool Bind(T& member, const char* name, std::string* error);
+
+  void* handle_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_ROSFLIGHT_FIRMWARE_H
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_ROTOR_MODEL_H
+#define fcu_sim_PLUGINS_ROTOR_MODEL_H
+
+#include <memory>
+
+#include <Eigen/Dense>
+
+namespace fcu_sim {
+
+struct RotorParams
+{
+  double max; // thrust limit (N)
+  double F_poly[3]; // thrust as a quadratic in the ESC signal, highest order first
+  double T_poly[3]; // torque, same
+  double tau_up; // time constants for response (s)
+  double tau_down;
+};
+
+/*
+ * Motor and mixer model of the SIL multirotor: ESC signals go through the
+ * quadratic thrust and torque curves and a first-order response, then the
+ * allocation matrices turn per-rotor forces into body forces and torques.
+ *
+ * Made to be built through makeRotorModel(), which picks a specialization
+ * with fixed-size matrices for the common rotor counts.  All per-rotor
+ * quantities are kept as packed arrays, so Eigen evaluates each step across
+ * all rotors with SIMD instead of one motor at a time.
+ */
+class RotorModel
+{
+public:
+  virtual ~RotorModel() {}
+
+  virtual int size() const = 0;
+
+  /*
+   * Configure rotor i.  position is in the body frame (m), normal is the
+   * thrust direction (normalized here), direction is 1 for CW and -1 for CCW.
+   */
+  virtual void setRotor(int i, const Eigen::Vector3d& position, const Eigen::Vector3d& normal,
+                        int direction, const RotorParams& params) = 0;
+
+  // Spin every rotor down
+  virtual void reset() = 0;
+
+  /*
+   * Advance the rotors by dt with ESC signals (one per rotor) and return the
+   * body torques and thrust as (l, m, n, F)
+   */
+  virtual Eigen::Vector4d step(const double* signals, double dt) = 0;
+
+  virtual Eigen::MatrixXd forceAllocation() const = 0;
+  virtual Eigen::MatrixXd torqueAllocation() const = 0;
+};
+
+// Rotor model for num_rotors rotors, fixed-size for 4, 6 and 8
+std::unique_ptr<RotorModel> makeRotorModel(int num_rotors);
+
+
+template<int N>
+class FixedRotorModel : public RotorModel
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef Eigen::Array<double, N, 1> RotorArray;
+
+  explicit FixedRotorModel(int num_rotors = N)
+  {
+    force_allocation_.setZero(4, num_rotors);
+    torque_allocation_.setZero(4, num_rotors);
+    RotorArray* arrays[] = {&F2_, &F1_, &F0_, &T2_, &T1_, &T0_, &max_, &tau_up_, &tau_down_,
+                            &actual_forces_, &actual_torques_};
+    for (RotorArray* array : arrays)
+      array->setZero(num_rotors);
+  }
+
+  int size() const { return static_cast<int>(max_.size()); }
+
+  void setRotor(int i, const Eigen::Vector3d& position, const Eigen::Vector3d& normal,
+                int direction, const RotorParams& params)
+  {
+    Eigen::Vector3d n = normal.normalized();
+    Eigen::Vector3d moment_from_thrust = position.cross(n);
+    Eigen::Vector3d moment_from_torque = direction * n;
+
+    force_allocation_.col(i) << moment_from_thrust, n(2);
+    torque_allocation_.col(i) << moment_from_torque, 0.0;
+
+    F2_(i) = params.F_poly[0];
+    F1_(i) = params.F_poly[1];
+    F0_(i) = params.F_poly[2];
+    T2_(i) = params.T_poly[0];
+    T1_(i) = params.T_poly[1];
+    T0_(i) = params.T_poly[2];
+    max_(i) = params.max;
+    tau_up_(i) = params.tau_up;
+    tau_down_(i) = params.tau_down;
+  }
+
+  void reset()
+  {
+    actual_forces_.setZero();
+    actual_torques_.setZero();
+  }
+
+  Eigen::Vector4d step(const double* signals, double dt)
+  {
+    Eigen::Map<const RotorArray> signal(signals, size());
+
+    // Desired force and torque from the quadratic approximation
+    RotorArray desired_forces = (F2_*signal + F1_)*signal + F0_;
+    RotorArray desired_torques = (T2_*signal + T1_)*signal + T0_;
+
+    // First-order response, faster spinning up than down
+    RotorArray tau = (desired_forces > actual_forces_).select(tau_up_, tau_down_);
+    RotorArray alpha = dt/(tau + dt);
+    actual_forces_ = ((1.0 - alpha)*actual_forces_ + alpha*desired_forces).min(max_).max(0.0);
+    actual_torques_ = ((1.0 - alpha)*actual_torques_ + alpha*desired_torques).min(max_).max(0.0);
+
+    return force_allocation_*actual_forces_.matrix() + torque_allocation_*actual_torques_.matrix();
+  }
+
+  Eigen::MatrixXd forceAllocation() const { return force_allocation_; }
+  Eigen::MatrixXd torqueAllocation() const { return torque_allocation_; }
+
+private:
+  Eigen::Matrix<double, 4, N> force_allocation_;
+  Eigen::Matrix<double, 4, N> torque_allocation_;
+
+  RotorArray F2_, F1_, F0_;
+  RotorArray T2_, T1_, T0_;
+  RotorArray max_;
+  RotorArray tau_up_, tau_down_;
+
+  RotorArray actual_forces_;
+  RotorArray actual_torques_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_ROTOR_MODEL_H
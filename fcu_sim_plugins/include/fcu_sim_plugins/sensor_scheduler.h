@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_SENSOR_SCHEDULER_H
+#define fcu_sim_PLUGINS_SENSOR_SCHEDULER_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <gazebo/common/common.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include "fcu_sim_plugins/update_timer.h"
+
+namespace gazebo {
+
+/*
+ * One WorldUpdateBegin connection per world that drives every sensor plugin.
+ *
+ * Sensors register a callback with a rate and get called only on the physics
+ * steps they are due, instead of every plugin waking up every step to compare
+ * sim times.  Due times live in a hashed timing wheel indexed by physics step,
+ * so a step only touches the sensors that fire on it.  Sensors that don't ask
+ * for a particular phase are offset to spread the load evenly across steps.
+ *
+ * The scheduler also keeps track of how far each call lands from the nominal
+ * period (the jitter caused by rounding the period to whole physics steps), and
+ * reports it when the sensor goes away.  Every call is also timed into the
+ * sensor's fcu_sim::UpdateTimer, under the name it registered with.
+ */
+class SensorScheduler
+{
+public:
+  typedef boost::function<void(const common::UpdateInfo&)> Callback;
+
+  // Unregisters the sensor when the last copy goes away
+  class Connection
+  {
+  public:
+    Connection(SensorScheduler* scheduler, unsigned id) : scheduler_(scheduler), id_(id) {}
+    ~Connection() { scheduler_->Unregister(id_); }
+    unsigned Id() const { return id_; }
+  private:
+    SensorScheduler* scheduler_;
+    unsigned id_;
+  };
+  typedef boost::shared_ptr<Connection> ConnectionPtr;
+
+  struct Stats
+  {
+    std::string name;
+    double rate; // requested, Hz
+    double effective_rate; // after rounding to physics steps, Hz
+    int64_t decimation; // physics steps per call
+    uint64_t calls;
+    double mean_jitter; // mean |actual - nominal period|, s
+    double max_jitter; // s
+  };
+
+  // The scheduler shared by every plugin in this world
+  static SensorScheduler& Get(physics::WorldPtr world);
+
+  /*
+   * Call callback at rate Hz.  rate <= 0 runs every physics step.  phase is
+   * the fraction of a period [0, 1) to offset the first call by, or negative
+   * to let the scheduler pick the least loaded offset.
+   */
+  ConnectionPtr Register(const std::string& name, double rate, const Callback& callback, double phase = -1.0);
+
+  std::vector<Stats> GetStats() const;
+
+private:
+  struct Entry
+  {
+    std::string name;
+    double rate;
+    Callback callback;
+    fcu_sim::UpdateTimer* timer;
+    double phase;
+    int64_t period; // physics steps
+    int64_t offset; // fires on steps where step % period == offset
+    int64_t next_tick;
+    bool timed; // last_call_time is valid
+    bool removed; // unregistered during a tick, erased once it is over
+    double last_call_time;
+    uint64_t calls;
+    double sum_jitter;
+    double max_jitter;
+  };
+
+  explicit SensorScheduler(physics::WorldPtr world);
+
+  void Unregister(unsigned id);
+  void OnUpdate(const common::UpdateInfo& info);
+
+  void Configure(unsigned id, Entry& entry) const;
+  int64_t PickOffset(int64_t period, unsigned ignore) const;
+  void Schedule(unsigned id, Entry& entry, int64_t after_tick);
+  void Rebuild(int64_t tick);
+  Stats MakeStats(const Entry& entry) const;
+
+  static const int64_t kWheelSize = 1024;
+
+  physics::WorldPtr world_;
+  event::ConnectionPtr updateConnection_;
+
+  // Held for a whole tick so plugins can't unregister mid-call from another
+  // thread; recursive so a callback may register or unregister sensors
+  mutable std::recursive_mutex mutex_;
+
+  std::map<unsigned, Entry> entries_;
+  std::vector<std::vector<unsigned> > wheel_;
+  std::vector<unsigned> due_;
+  std::vector<unsigned> removed_;
+  bool updating_;
+  unsigned next_id_;
+  double step_size_;
+  int64_t last_tick_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_SENSOR_SCHEDULER_H
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_SHM_IMAGE_RING_H
+#define fcu_sim_PLUGINS_SHM_IMAGE_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fcu_sim {
+
+struct ShmFrameInfo
+{
+  uint32_t width;
+  uint32_t height;
+  uint32_t step; // bytes per row
+  std::string encoding; // sensor_msgs/image_encodings name
+  uint32_t sec; // stamp
+  uint32_t nsec;
+};
+
+/*
+ * Images handed to other processes through a POSIX shared-memory segment
+ * instead of a socket: the writer copies each frame into the next of a ring
+ * of fixed-size slots and announces it with a small message (fcu_sim/ShmImage)
+ * that says which segment and sequence number to read.  Nothing is serialized
+ * and a reader copies only the frames it wants.
+ *
+ * The writer never waits for readers.  Each slot carries a version that is
+ * odd while the slot is being written and 2*sequence after, so a reader
+ * checks it before and after copying and gets false if the frame was
+ * overwritten in between (it fell more than slots frames behind) rather
+ * than a torn image.
+ */
+class ShmImageWriter
+{
+public:
+  ShmImageWriter();
+  ~ShmImageWriter(); // unmaps and removes the segment
+
+  // Create segment name (e.g. "/fcu_sim_uav1_camera") with room for slots frames of up to slot_size bytes
+  bool open(const std::string& name, int slots, size_t slot_size, std::string* error);
+
+  // Copy a frame into the next slot, its sequence number (slot sequence % slots) or 0 if it doesn't fit
+  uint64_t write(const ShmFrameInfo& image, const uint8_t* data);
+
+  bool isOpen() const { return base_ != NULL; }
+  const std::string& name() const { return name_; }
+  int slots() const;
+
+private:
+  ShmImageWriter(const ShmImageWriter&);
+  ShmImageWriter& operator=(const ShmImageWriter&);
+
+  void close();
+
+  std::string name_;
+  uint8_t* base_;
+  size_t length_;
+};
+
+class ShmImageReader
+{
+public:
+  ShmImageReader();
+  ~ShmImageReader();
+
+  bool open(const std::string& name, std::string* error);
+
+  // Copy frame sequence out of the ring, false if it was never written or has been overwritten
+  bool read(uint64_t sequence, ShmFrameInfo* image, std::vector<uint8_t>* data) const;
+
+  bool isOpen() const { return base_ != NULL; }
+
+private:
+  ShmImageReader(const ShmImageReader&);
+  ShmImageReader& operator=(const ShmImageReader&);
+
+  const uint8_t* base_;
+  size_t length_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_SHM_IMAGE_RING_H
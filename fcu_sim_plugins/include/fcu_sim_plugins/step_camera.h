@@ -21,6 +21,10 @@
 #include <gazebo/plugins/CameraPlugin.hh>
 #include <gazebo_plugins/gazebo_ros_camera_utils.h>
 
+#include "fcu_sim_plugins/camera_image_output.h"
+#include "fcu_sim_plugins/frame_barrier.h"
+#include "fcu_sim_plugins/update_timer.h"
+
 namespace gazebo
 {
   class StepCamera : public CameraPlugin, GazeboRosCameraUtils
@@ -29,8 +33,17 @@ namespace gazebo
     event::ConnectionPtr _sensorUpdateConnection;
     event::ConnectionPtr _resetConnection;
     float _updateRate;
+    std::string _name; // <robotNamespace>/<cameraName>
+
+    // Physics runs at most _pipelineDepth frames ahead of the renderer, 0 for lockstep
+    fcu_sim::FrameBarrier _frameBarrier;
+    int _pipelineDepth;
+    double _frameTimeout;
+    common::Time _lastRequestTime;
+    fcu_sim::UpdateTimer* _waitTimer;
 
-    boost::timed_mutex _updateLock;
+    // Pooled and shared-memory publication in place of PutCameraData
+    CameraImageOutput _output;
 
     public: StepCamera();
     public: ~StepCamera();
@@ -38,6 +51,9 @@ namespace gazebo
     public: void OnUpdateParentSensor();
     public: void OnRender();
 
+    private: common::Time SceneTime() const;
+    private: void PublishImage(const unsigned char *_src);
+
     protected: void Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf);
     protected: void Reset();
     protected: virtual void OnNewFrame(const unsigned char *_image,
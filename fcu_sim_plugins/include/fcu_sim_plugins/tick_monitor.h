@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_TICK_MONITOR_H
+#define fcu_sim_PLUGINS_TICK_MONITOR_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fcu_sim {
+
+// Simulation health over one reporting period
+struct TickStats
+{
+  double period; // s of wall time the stats cover
+  double real_time_factor; // sim time over wall time during the period
+  uint64_t steps;
+  uint64_t overruns; // steps that took longer than the target period
+  double mean_step; // s of wall time from the start to the end of a step
+  double max_step;
+
+  // The slowest step of the period and the timed updates inside it
+  double worst_sim_time;
+  std::vector<std::pair<std::string, double> > worst_breakdown; // name, s
+
+  TickStats();
+};
+
+/*
+ * Watches the physics loop from outside: beginTick() and endTick() bracket
+ * every step (wall times in ns from UpdateTimer::now()), and collect() closes
+ * a reporting period.  A step overruns when it takes longer than the wall
+ * time real_time_update_rate allows for it; with no target nothing overruns.
+ * The slowest step of each period is broken down by the UpdateTimers whose
+ * latest span falls inside it, so the breakdown only names code that is
+ * timed and ran in that step.
+ */
+class TickMonitor
+{
+public:
+  TickMonitor();
+
+  // s of wall time a step may take, 0 for none
+  void setTargetPeriod(double seconds) { target_period_ = seconds; }
+
+  void beginTick(double sim_time, uint64_t wall);
+  void endTick(uint64_t wall);
+
+  // s of wall time since the period began
+  double elapsed(uint64_t wall) const { return period_begin_wall_ == 0 ? 0.0 : (wall - period_begin_wall_)*1e-9; }
+
+  // Stats for the period up to now, and start the next one
+  TickStats collect(double sim_time, uint64_t wall);
+
+  uint64_t stepsTotal() const { return steps_total_; }
+  uint64_t overrunsTotal() const { return overruns_total_; }
+
+  // Prometheus text exposition of the stats, the running totals and every UpdateTimer
+  std::string prometheus(const TickStats& stats, int models) const;
+
+private:
+  double target_period_;
+
+  uint64_t period_begin_wall_;
+  double period_begin_sim_;
+  uint64_t steps_;
+  uint64_t overruns_;
+  uint64_t step_sum_; // ns
+  uint64_t step_max_;
+  double worst_sim_time_;
+  std::vector<std::pair<std::string, uint64_t> > worst_breakdown_;
+
+  uint64_t steps_total_;
+  uint64_t overruns_total_;
+
+  uint64_t tick_begin_wall_; // 0 outside a step
+  double tick_begin_sim_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_TICK_MONITOR_H
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_TRACE_H
+#define fcu_sim_PLUGINS_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace fcu_sim {
+
+/*
+ * Opt-in timeline of what ran when, for looking inside a single tick.
+ *
+ * While a capture is on, record() appends a begin/end event to a ring buffer
+ * owned by the calling thread (the physics thread, ROS spinner threads, the
+ * renderer), so recording takes no lock and threads never share a cache
+ * line.  Each ring keeps the newest kBufferSize events.  Between captures
+ * record() is never reached: callers check enabled(), one relaxed load.
+ *
+ * writeChromeTrace() dumps everything since start() as Chrome trace-event
+ * JSON, which chrome://tracing and ui.perfetto.dev both open.  Call it after
+ * stop(); a thread that was in the middle of recording when the capture
+ * stopped may still finish that one event.
+ *
+ * Names must outlive the capture, string literals or UpdateTimer names.
+ */
+class Trace
+{
+public:
+  static const int kBufferSize = 1 << 15; // events per thread
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Drop what was recorded before and start recording
+  static void start();
+  static void stop();
+
+  // An event that ran from begin to end, nanoseconds on UpdateTimer::now()
+  static void record(const char* name, uint64_t begin, uint64_t end);
+
+  // Label the calling thread in the trace
+  static void nameThread(const char* name);
+
+  // Events since start() as Chrome trace JSON, the number written or -1 on failure
+  static long writeChromeTrace(const std::string& filename);
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_TRACE_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_TURBULENCE_FIELD_H
+#define fcu_sim_PLUGINS_TURBULENCE_FIELD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fcu_sim {
+
+struct TurbulenceParams
+{
+  int size[3]; // grid points per axis, powers of two
+  double spacing; // m between grid points
+  double intensity; // m/s, rms of each velocity component
+  double length_scale; // m, von Karman integral length scale
+
+  TurbulenceParams();
+};
+
+/*
+ * Frozen 3D turbulence: a periodic box of wind velocities, synthesized once
+ * from an isotropic von Karman spectrum (random divergence-free Fourier
+ * modes, inverse FFT, scaled to the requested intensity) or mapped straight
+ * from a file written by save().  Taylor's hypothesis turns it into a time
+ * series: the box is carried along by the mean wind, so sample() is a
+ * trilinear lookup at position - mean_wind*t.  Every vehicle in a world reads
+ * the same box, so the gusts they see are correlated by their separation.
+ *
+ * Velocities are stored as float, xyz interleaved per grid point with x
+ * varying fastest.  File layout (little-endian):
+ *
+ *   char[8]   "FCUTRB01"
+ *   uint32    points along x, y, z
+ *   uint32    reserved, 0
+ *   float64   spacing (m)
+ *   float32   3 x number of points
+ *
+ * The mean wind is not part of the file.
+ */
+class TurbulenceField
+{
+public:
+  TurbulenceField();
+  ~TurbulenceField();
+
+  // Synthesize a new box, false if a size isn't a power of two or a parameter isn't positive
+  bool generate(const TurbulenceParams& params, uint64_t seed);
+
+  // Memory-map a box from a file, false with error filled in on failure
+  bool load(const std::string& filename, std::string* error);
+  bool save(const std::string& filename) const;
+
+  bool empty() const { return data_ == NULL; }
+  const int* size() const { return size_; }
+  double spacing() const { return spacing_; }
+
+  // Mean wind, in the same frame and units as sample()
+  void setMeanWind(const double mean[3]);
+
+  // Wind velocity (mean plus turbulence) at position (m) and time (s)
+  void sample(const double position[3], double t, double wind[3]) const;
+
+private:
+  TurbulenceField(const TurbulenceField&);
+  TurbulenceField& operator=(const TurbulenceField&);
+
+  void unmap();
+
+  int size_[3];
+  double spacing_;
+  double mean_[3];
+
+  const float* data_; // into storage_ or the mapping
+  std::vector<float> storage_;
+  void* mapping_;
+  size_t mapping_size_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_TURBULENCE_FIELD_H
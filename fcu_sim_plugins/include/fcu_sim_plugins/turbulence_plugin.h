@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_TURBULENCE_PLUGIN_H
+#define fcu_sim_PLUGINS_TURBULENCE_PLUGIN_H
+
+#include <memory>
+
+#include <gazebo/common/common.hh>
+#include <gazebo/common/Plugin.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+#include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/turbulence_field.h"
+#include "fcu_sim_plugins/wind_source.h"
+
+namespace gazebo {
+
+/// \brief Builds (or maps from disk) one turbulence field for the whole
+/// world at load time and provides it as the world's WindSource.  Every
+/// vehicle samples it instead of drawing its own wind, so nothing is computed
+/// per vehicle per step beyond an interpolation.  The field is laid out and
+/// sampled in NED, so meanWind is north, east, down.
+class TurbulencePlugin : public WorldPlugin {
+ public:
+  TurbulencePlugin() : WorldPlugin() {}
+  virtual ~TurbulencePlugin();
+
+ protected:
+  void Load(physics::WorldPtr _world, sdf::ElementPtr _sdf);
+
+ private:
+  math::Vector3 Wind(const math::Vector3& position, const common::Time& time) const;
+
+  std::unique_ptr<fcu_sim::TurbulenceField> field_;
+  WindSourcePtr wind_source_;
+};
+}
+
+#endif // fcu_sim_PLUGINS_TURBULENCE_PLUGIN_H
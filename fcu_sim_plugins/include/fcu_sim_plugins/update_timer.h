@@ -0,0 +1,158 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_UPDATE_TIMER_H
+#define fcu_sim_PLUGINS_UPDATE_TIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fcu_sim_plugins/trace.h"
+
+namespace fcu_sim {
+
+/*
+ * Latency histogram in the style of HdrHistogram: buckets are linear within
+ * each power of two, kSubBuckets to an octave, so every value is kept to
+ * about 3% however large it is, in a fixed array and with no allocation.
+ * Values are nanoseconds and anything past 2^40 ns (18 minutes) lands in the
+ * last bucket.  Each histogram has one writer, the thread that runs the code
+ * it times, which only does relaxed loads and stores: nothing is locked or
+ * contended on the hot path, and any other thread can read a summary at any
+ * time (approximate while recording continues, but never torn).
+ */
+class LatencyHistogram
+{
+public:
+  static const int kSubBuckets = 32;
+  static const int kMaxShift = 40 - 5; // 5 = log2(kSubBuckets)
+  static const int kBuckets = 2*kSubBuckets + kMaxShift*kSubBuckets;
+
+  struct Summary
+  {
+    uint64_t count;
+    double mean; // ns
+    uint64_t p50, p90, p99, p999, max; // ns
+  };
+
+  LatencyHistogram() { reset(); }
+
+  // Single writer: plain relaxed loads and stores, no locked instructions
+  void record(uint64_t ns)
+  {
+    std::atomic<uint64_t>& count = counts_[bucket(ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if (ns > max_.load(std::memory_order_relaxed))
+      max_.store(ns, std::memory_order_relaxed);
+  }
+
+  void reset();
+  Summary summary() const;
+
+  static int bucket(uint64_t ns);
+  static uint64_t upperBound(int bucket); // largest value that lands in bucket
+
+private:
+  std::atomic<uint64_t> counts_[kBuckets];
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+};
+
+/*
+ * A named latency histogram in a process-wide registry, so every plugin
+ * library records into the same set and one place can report them all.
+ * Names are "<vehicle namespace>/<what>", the same names the sensor
+ * scheduler uses.  Timers live until the process exits, get() returns the
+ * same pointer for the same name, and only get() takes a lock.
+ */
+class UpdateTimer
+{
+public:
+  static UpdateTimer* get(const std::string& name);
+
+  // Every timer that has recorded, sorted by name
+  static std::vector<std::pair<std::string, LatencyHistogram::Summary> > summaries();
+
+  // One line per timer, sorted by name: count, mean and percentiles in microseconds
+  static std::string report();
+
+  // Write report() to filename, through a temporary file so readers never see half of it
+  static bool writeReport(const std::string& filename);
+
+  static void resetAll();
+
+  // Timers whose latest span lies inside [begin, end] with its length in ns,
+  // longest first: which updates made up one slow tick
+  static std::vector<std::pair<std::string, uint64_t> > spansWithin(uint64_t begin, uint64_t end);
+
+  void record(uint64_t ns) { histogram_.record(ns); }
+
+  // Also remembers the span for spansWithin()
+  void record(uint64_t begin, uint64_t end)
+  {
+    histogram_.record(end - begin);
+    last_begin_.store(begin, std::memory_order_relaxed);
+    last_end_.store(end, std::memory_order_relaxed);
+  }
+
+  const std::string& name() const { return name_; }
+  const LatencyHistogram& histogram() const { return histogram_; }
+
+  static uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+private:
+  explicit UpdateTimer(const std::string& name) : name_(name), last_begin_(0), last_end_(0) {}
+  UpdateTimer(const UpdateTimer&);
+  UpdateTimer& operator=(const UpdateTimer&);
+
+  std::string name_;
+  LatencyHistogram histogram_;
+  std::atomic<uint64_t> last_begin_;
+  std::atomic<uint64_t> last_end_;
+};
+
+// Records the time from construction to the end of the scope, and puts it
+// on the trace timeline under the timer's name while a capture is on
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(UpdateTimer* timer) : timer_(timer), start_(UpdateTimer::now()) {}
+  ~ScopedTimer()
+  {
+    uint64_t end = UpdateTimer::now();
+    timer_->record(start_, end);
+    if (Trace::enabled())
+      Trace::record(timer_->name().c_str(), start_, end);
+  }
+
+private:
+  UpdateTimer* timer_;
+  uint64_t start_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_UPDATE_TIMER_H
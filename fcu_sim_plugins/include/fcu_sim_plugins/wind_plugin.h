@@ -19,21 +19,27 @@
 #ifndef fcu_sim_PLUGINS_GAZEBO_WIND_PLUGIN_H
 #define fcu_sim_PLUGINS_GAZEBO_WIND_PLUGIN_H
 
+#include <cstdint>
 #include <string>
 #include <ros/ros.h>
 
 #include <gazebo/common/common.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/gazebo.hh>
+#include <gazebo/math/Rand.hh>
 #include <gazebo/physics/physics.hh>
 #include <geometry_msgs/Vector3.h>
-#include <chrono>
 
 #include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/random_stream.h"
+#include "fcu_sim_plugins/update_timer.h"
+#include "fcu_sim_plugins/wind_source.h"
 
 namespace gazebo {
 
-/// \brief This gazebo plugin simulates wind acting on a model.
+/// \brief This gazebo plugin simulates wind acting on a model.  The other
+/// plugins on the model read it through the model's WindSource; the ROS topic
+/// is only a decimated copy (NED) for logging.
 class WindPlugin : public ModelPlugin {
  public:
   WindPlugin() : ModelPlugin(){}
@@ -51,8 +57,15 @@ class WindPlugin : public ModelPlugin {
   void OnUpdate(const common::UpdateInfo& /*_info*/);
 
  private:
+  /// \brief WindSource provider, the NED wind at an NED position and time.
+  math::Vector3 Wind(const math::Vector3& position, const common::Time& time);
+
+  /// \brief Advance the random wind to the current physics step, once per step.
+  void Draw();
+
     /// \brief Pointer to the update event connection.
   event::ConnectionPtr update_connection_;
+  fcu_sim::UpdateTimer* update_timer_;
 
   physics::WorldPtr world_;
   physics::ModelPtr model_;
@@ -78,6 +91,21 @@ class WindPlugin : public ModelPlugin {
   int wind_change_delay;
   int wind_change_value;
 
+  // Seeded once at Load, substream from the namespace so every vehicle gets its own wind
+  fcu_sim::RandomStream random_;
+
+  // This step's draw, whoever asks first (OnUpdate or a WindSource query) makes it
+  math::Vector3 wind_;
+  math::Vector3 wind_gust_;
+  uint64_t drawn_iteration_;
+
+  // A provider on the world (turbulence field) takes over from the random wind
+  WindSourcePtr wind_source_;
+  WindSourcePtr world_wind_source_;
+
+  double wind_pub_rate_;
+  common::Time last_pub_time_;
+
   math::Vector3 xyz_offset_;
   math::Vector3 wind_direction;
   math::Vector3 wind_gust_direction_;
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef fcu_sim_PLUGINS_WIND_SOURCE_H
+#define fcu_sim_PLUGINS_WIND_SOURCE_H
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <gazebo/common/common.hh>
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+
+namespace gazebo {
+
+/*
+ * In-process wind query, one per vehicle model plus one per world.
+ *
+ * The wind plugin used to publish on a ROS topic that every force and sensor
+ * plugin subscribed to, so each of them serialized, waited on a spinner and
+ * used the value from a step or more ago.  Now whoever computes the wind
+ * installs a provider here, and ModelState asks for it while it builds the
+ * step's snapshot, so everyone on the vehicle reads the same value for the
+ * current step.  A model with no provider of its own falls through to the
+ * world's (the shared turbulence field); with neither the wind is zero.
+ *
+ * Providers work in inertial NED, position and wind alike, whatever frame they
+ * keep internally.  ModelState hands out the result in NED and in the body
+ * frame, so plugins never see Gazebo's NWU wind.
+ *
+ * Only use from the physics thread (Load, WorldUpdateBegin and sensor
+ * scheduler callbacks).
+ */
+class WindSource
+{
+public:
+  // Wind velocity (m/s, NED) at an NED position (m) and sim time
+  typedef boost::function<math::Vector3(const math::Vector3& position, const common::Time& time)> Provider;
+
+  // The source shared by every plugin on model
+  static boost::shared_ptr<WindSource> Get(physics::ModelPtr model);
+
+  // The world-wide source the model sources fall back on
+  static boost::shared_ptr<WindSource> Get(physics::WorldPtr world);
+
+  void SetProvider(const Provider& provider) { provider_ = provider; }
+  void ClearProvider() { provider_.clear(); }
+
+  // Whether this source has a provider of its own, ignoring the world's
+  bool HasProvider() const { return !provider_.empty(); }
+
+  math::Vector3 Wind(const math::Vector3& position, const common::Time& time) const;
+
+  // Gazebo world (NWU) to NED, and back, it is its own inverse
+  static math::Vector3 NWUToNED(const math::Vector3& v) { return math::Vector3(v.x, -v.y, -v.z); }
+
+private:
+  WindSource(physics::ModelPtr model, physics::WorldPtr world, boost::shared_ptr<WindSource> fallback);
+
+  // Held so a live entry can't be confused with a new model reusing the address
+  physics::ModelPtr model_;
+  physics::WorldPtr world_;
+
+  boost::shared_ptr<WindSource> fallback_;
+  Provider provider_;
+};
+
+typedef boost::shared_ptr<WindSource> WindSourcePtr;
+
+}
+
+#endif // fcu_sim_PLUGINS_WIND_SOURCE_H
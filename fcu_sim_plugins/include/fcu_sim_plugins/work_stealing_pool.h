@@ -0,0 +1,173 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_WORK_STEALING_POOL_H
+#define fcu_sim_PLUGINS_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fcu_sim {
+
+/*
+ * Small fixed-size thread pool for the headless tools.  Every worker owns a
+ * deque; it pops its own work from the back and, when that runs dry, steals
+ * from the front of its neighbours.  Runs that crash early finish quickly, so
+ * stealing keeps every core busy until the whole batch is done.
+ */
+class WorkStealingPool
+{
+public:
+  typedef std::function<void()> Task;
+
+  // num_threads == 0 uses one thread per hardware core
+  explicit WorkStealingPool(unsigned num_threads = 0) :
+    next_queue_(0),
+    queued_(0),
+    pending_(0),
+    stop_(false)
+  {
+    if (num_threads == 0)
+      num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0)
+      num_threads = 1;
+
+    for (unsigned i = 0; i < num_threads; i++)
+      queues_.emplace_back(new Queue);
+    for (unsigned i = 0; i < num_threads; i++)
+      threads_.emplace_back(&WorkStealingPool::worker, this, i);
+  }
+
+  ~WorkStealingPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex_);
+      stop_ = true;
+    }
+    idle_cv_.notify_all();
+    for (size_t i = 0; i < threads_.size(); i++)
+      threads_[i].join();
+  }
+
+  unsigned size() const { return threads_.size(); }
+
+  // Queue a task, spreading submissions round-robin across the workers
+  void submit(Task task)
+  {
+    unsigned index = next_queue_++ % queues_.size();
+    pending_++;
+    {
+      std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+      queues_[index]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex_);
+      queued_++;
+    }
+    idle_cv_.notify_one();
+  }
+
+  // Block until every submitted task has finished
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    done_cv_.wait(lock, [this]{ return pending_ == 0; });
+  }
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool pop(unsigned self, Task& task)
+  {
+    // own work first, newest first so it is still warm in cache
+    {
+      Queue& q = *queues_[self];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.tasks.empty())
+      {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+      }
+    }
+
+    // then steal the oldest work from everyone else
+    for (size_t i = 1; i < queues_.size(); i++)
+    {
+      Queue& q = *queues_[(self + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.tasks.empty())
+      {
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void worker(unsigned self)
+  {
+    Task task;
+    while (true)
+    {
+      if (pop(self, task))
+      {
+        queued_--;
+        task();
+        task = Task();
+        if (--pending_ == 0)
+        {
+          std::lock_guard<std::mutex> lock(idle_mutex_);
+          done_cv_.notify_all();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(idle_mutex_);
+      idle_cv_.wait(lock, [this]{ return stop_ || queued_ > 0; });
+      if (stop_ && queued_ == 0)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue> > queues_;
+  std::vector<std::thread> threads_;
+
+  std::atomic<unsigned> next_queue_;
+  std::atomic<long> queued_; // tasks sitting in a deque
+  std::atomic<long> pending_; // tasks submitted but not yet finished
+  bool stop_;
+
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+  std::condition_variable done_cv_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_WORK_STEALING_POOL_H
@@ -24,16 +24,22 @@
 #include <ros/callback_queue.h>
 #include <ros/ros.h>
 
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <iostream>
+#include <mutex>
 #include <stdio.h>
 
 #include <std_msgs/Int16.h>
 #include <std_msgs/String.h>
 #include <std_srvs/Empty.h>
+#include <std_srvs/Trigger.h>
 #include <boost/bind.hpp>
 
+#include <fcu_sim/SimHealth.h>
+#include "fcu_sim_plugins/tick_monitor.h"
+
 
 namespace gazebo {
 
@@ -44,11 +50,15 @@ public:
   ~WorldUtilities();
   void stepCommandCallback(const std_msgs::Int16 &msg);
   bool randomizeObstaclesCommandCallback(std_srvs::EmptyRequest& request, std_srvs::EmptyResponse& response);
+  bool timingCallback(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response);
+  bool startTraceCallback(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response);
+  bool stopTraceCallback(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response);
 
 protected:
 
   virtual void Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf);
   void OnUpdate(const common::UpdateInfo & _info);
+  void OnUpdateEnd();
 
 private:
   physics::WorldPtr world_;
@@ -57,9 +67,35 @@ private:
   ros::NodeHandle* nh_;
   ros::Subscriber step_command_sub_;
   ros::ServiceServer randomize_obstacles_service_sub_;
+  ros::ServiceServer timing_service_;
+  ros::ServiceServer start_trace_service_;
+  ros::ServiceServer stop_trace_service_;
   ros::Publisher pose_pub_;
+  ros::Publisher health_pub_;
 
   std::string namespace_;
+
+  // Periodic dump of the plugin update timings
+  event::ConnectionPtr updateConnection_;
+  std::string timing_file_;
+  double timing_period_;
+  common::Time last_timing_dump_;
+
+  // Real-time factor and step overruns, published and written every metrics_period_ s of wall time
+  void reportHealth(uint64_t now);
+  fcu_sim::TickMonitor monitor_;
+  std::string metrics_file_;
+  double metrics_period_;
+
+  // Trace capture, started and stopped from the services or after trace_ticks_ ticks
+  bool finishTrace(std::string* message);
+  event::ConnectionPtr updateEndConnection_;
+  std::string trace_file_;
+  int trace_ticks_;
+  std::mutex trace_mutex_;
+  bool tracing_; // under trace_mutex_
+  std::atomic<int> trace_ticks_left_; // 0 runs until stop_trace
+  uint64_t tick_begin_; // physics thread only, 0 if the tick started before the capture
 };
 } // namespace gazebo
 #endif //fcu_sim_PLUGINS_STEPWORLD_PLUGIN_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef fcu_sim_PLUGINS_YAML_PARAMS_H
+#define fcu_sim_PLUGINS_YAML_PARAMS_H
+
+#include <string>
+
+#include <yaml-cpp/yaml.h>
+
+namespace fcu_sim {
+
+// ros::NodeHandle-style lookups over a yaml node, so the param structs load
+// from agent files exactly like they do from the parameter server
+class YamlParams
+{
+public:
+  explicit YamlParams(const YAML::Node& node) : node_(node) {}
+
+  template <class T>
+  T param(const std::string& name, const T& default_value) const
+  {
+    const YAML::Node value = node_[name];
+    return value ? value.as<T>() : default_value;
+  }
+
+  template <class T>
+  bool getParam(const std::string& name, T& value) const
+  {
+    const YAML::Node node = node_[name];
+    if (!node)
+      return false;
+    value = node.as<T>();
+    return true;
+  }
+
+private:
+  YAML::Node node_;
+};
+
+}
+
+#endif // fcu_sim_PLUGINS_YAML_PARAMS_H
@@ -16,17 +16,21 @@
 
 #include "fcu_sim_plugins/GPS_plugin.h"
 
+#include <gazebo/math/Rand.hh>
+
+#include "fcu_sim_plugins/gauss_markov.h"
+
 
 namespace gazebo 
 {
 
 
-GPSPlugin::GPSPlugin() : ModelPlugin() {}
+GPSPlugin::GPSPlugin() : LazySensorPlugin() {}
 
 
 GPSPlugin::~GPSPlugin() 
 {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
   if (nh_) {
     nh_->shutdown();
     delete nh_;
@@ -56,6 +60,7 @@ void GPSPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[gazebo_imu_plugin] Couldn't find specified link \"" << link_name_ << "\".");
+  state_ = ModelState::Get(link_);
 
   frame_id_ = link_name_;
 
@@ -73,82 +78,99 @@ void GPSPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   getSdfParam<double>(_sdf, "initialAltitude", initial_altitude_, 1.0);
   getSdfParam<int>(_sdf, "numSat", numSat, 7);
 
-  last_time_ = world_->GetSimTime();
-
-  // Listen to the update event. This event is broadcast every simulation iteration.
-  this->updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&GPSPlugin::OnUpdate, this, _1));
-
   GPS_pub_ = nh_->advertise<rosflight_msgs::GPS>(GPS_topic_, 1);
   pub_rate_ = 1.0/sample_time_;
+  AddConsumer(GPS_pub_);
+  LoadLazySensor(_sdf, sample_time_, world_->GetSimTime());
 
   // Fill static members of airspeed message.
   GPS_message_.header.frame_id = frame_id_;
   GPS_message_.fix = true;
   GPS_message_.NumSat = numSat;
 
-  standard_normal_distribution_ = std::normal_distribution<double>(0.0, 1.0);
+  // Without a seed, follow the world seed (gzserver --seed) so a run can still be reproduced
+  unsigned int seed;
+  getSdfParam<unsigned int>(_sdf, "seed", seed, math::Rand::GetSeed());
+  random_.seed(seed, namespace_ + "/gps");
+
+  // The sample time is fixed, so is the decay of the position error
+  north_phi_ = exp(-1.0*north_k_GPS_*sample_time_);
+  east_phi_ = exp(-1.0*east_k_GPS_*sample_time_);
+  alt_phi_ = exp(-1.0*alt_k_GPS_*sample_time_);
 
   north_GPS_error_ = 0.0;
   east_GPS_error_ = 0.0;
   alt_GPS_error_ = 0.0;
+
+  // Ask the world's sensor scheduler to call us once every sample time
+  this->updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/" + GPS_topic_, pub_rate_,
+                                                                  boost::bind(&GPSPlugin::OnUpdate, this, _1));
 //  gzerr << " finished GPS initializaiton \n" ;
 }
 
-// This gets called by the world update start event.
-void GPSPlugin::OnUpdate(const common::UpdateInfo& _info) 
+// This gets called by the sensor scheduler whenever a sample is due.
+void GPSPlugin::OnUpdate(const common::UpdateInfo& _info)
 {
+  int skipped;
+  if (!SampleNeeded(_info.simTime, &skipped))
+    return;
+  Skip(skipped);
+
+  // Every normal this sample needs
+  double n[5];
+  random_.normals(n, 5);
+
+  // Add noise per Gauss-Markov Process (p. 139 UAV Book)
+  north_GPS_error_ = north_phi_*north_GPS_error_ + north_stdev_*n[0];
+  east_GPS_error_ = east_phi_*east_GPS_error_ + east_stdev_*n[1];
+  alt_GPS_error_ = alt_phi_*alt_GPS_error_ + alt_stdev_*n[2];
+
+  // Find NED position in meters
+  const ModelState::NEDState& x = state_->Snapshot();
+  double pn = x.pn + north_GPS_error_;
+  double pe = x.pe + east_GPS_error_;
+  double h  = -x.pd + alt_GPS_error_;
+
+  // Convert meters to GPS angle
+  double dlat, dlon;
+  measure(pn, pe, dlat, dlon);
+  GPS_message_.latitude = initial_latitude_ + dlat * 180.0/M_PI;
+  GPS_message_.longitude = initial_longitude_ + dlon * 180.0/M_PI;
+
+  // Altitude
+  GPS_message_.altitude = initial_altitude_ + h;
+
+  // Get Ground Speed
+  double u = x.u;
+  double v = x.v;
+  double Vg = pow(u*u+v*v,0.5);
+  double sigma_vg = pow((u*u*north_stdev_*north_stdev_ + v*v*east_stdev_*east_stdev_)/(u*u+v*v),0.5);
+  double ground_speed_error = sigma_vg*n[3];
+  GPS_message_.speed = Vg + ground_speed_error;
+
+  // Get Course Angle
+  double chi = atan2(v,u);
+  double sigma_chi = pow((u*u*north_stdev_*north_stdev_ + v*v*east_stdev_*east_stdev_)/((u*u+v*v)*(u*u+v*v)),0.5);
+  double chi_error = sigma_chi*n[4];
+  GPS_message_.ground_course = chi + chi_error;
+
+  // Publish
+  GPS_message_.header.stamp.fromSec(_info.simTime.Double());
+  GPS_pub_.publish(GPS_message_);
+}
 
-  // check if time to publish
-  common::Time current_time  = world_->GetSimTime();
-  if((current_time - last_time_).Double() > 1.0/pub_rate_){
-
-      // Add noise per Gauss-Markov Process (p. 139 UAV Book)
-      double noise = north_stdev_*standard_normal_distribution_(random_generator_);
-      north_GPS_error_ = exp(-1.0*north_k_GPS_*sample_time_)*north_GPS_error_ + noise;
-
-      noise = east_stdev_*standard_normal_distribution_(random_generator_);
-      east_GPS_error_ = exp(-1.0*east_k_GPS_*sample_time_)*east_GPS_error_ + noise;
-
-      noise = alt_stdev_*standard_normal_distribution_(random_generator_);
-      alt_GPS_error_ = exp(-1.0*alt_k_GPS_*sample_time_)*alt_GPS_error_ + noise;
-
-      // Find NED position in meters
-      math::Pose W_pose_W_C = link_->GetWorldCoGPose();
-      double pn =  W_pose_W_C.pos.x + north_GPS_error_;
-      double pe = -W_pose_W_C.pos.y + east_GPS_error_;
-      double h  =  W_pose_W_C.pos.z + alt_GPS_error_;
-
-      // Convert meters to GPS angle
-      double dlat, dlon;
-      measure(pn, pe, dlat, dlon);
-      GPS_message_.latitude = initial_latitude_ + dlat * 180.0/M_PI;
-      GPS_message_.longitude = initial_longitude_ + dlon * 180.0/M_PI;
-
-      // Altitude
-      GPS_message_.altitude = initial_altitude_ + h;
-
-      // Get Ground Speed
-      math::Vector3 C_linear_velocity_W_C = link_->GetRelativeLinearVel();
-      double u = C_linear_velocity_W_C.x;
-      double v = -C_linear_velocity_W_C.y;
-      double Vg = pow(u*u+v*v,0.5);
-      double sigma_vg = pow((u*u*north_stdev_*north_stdev_ + v*v*east_stdev_*east_stdev_)/(u*u+v*v),0.5);
-      double ground_speed_error = sigma_vg*standard_normal_distribution_(random_generator_);
-      GPS_message_.speed = Vg + ground_speed_error;
-
-      // Get Course Angle
-      double chi = atan2(v,u);
-      double sigma_chi = pow((u*u*north_stdev_*north_stdev_ + v*v*east_stdev_*east_stdev_)/((u*u+v*v)*(u*u+v*v)),0.5);
-      double chi_error = sigma_chi*standard_normal_distribution_(random_generator_);
-      GPS_message_.ground_course = chi + chi_error;
-
-      // Publish
-      GPS_message_.header.stamp.fromSec(world_->GetSimTime().Double());
-      GPS_pub_.publish(GPS_message_);
-
-      last_time_ = current_time;
-  }
 
+// Advance the position errors over samples that were never taken, all at once
+void GPSPlugin::Skip(int samples)
+{
+  if (samples <= 0)
+    return;
+
+  double n[3];
+  random_.normals(n, 3);
+  north_GPS_error_ = fcu_sim::skipSamples(north_GPS_error_, north_phi_, north_stdev_, samples, n[0]);
+  east_GPS_error_ = fcu_sim::skipSamples(east_GPS_error_, east_phi_, east_stdev_, samples, n[1]);
+  alt_GPS_error_ = fcu_sim::skipSamples(alt_GPS_error_, alt_phi_, alt_stdev_, samples, n[2]);
 }
 
 
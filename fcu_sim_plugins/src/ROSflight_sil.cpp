@@ -17,37 +17,29 @@
 #pragma GCC diagnostic ignored "-Wwrite-strings"
 
 #include "fcu_sim_plugins/ROSflight_sil.h"
+#include "fcu_sim_plugins/rosflight_firmware.h"
+#include <algorithm>
 #include <sstream>
 #include <stdint.h>
 
 #include <stdio.h>
 
 
-// includde the ROSflight headers
-extern "C"
-{
-#include "ROSflight_SIL.h"
-#include "board.h"
-#include "rosflight.h"
-#include "estimator.h"
-#include "mixer.h"
-#include "mode.h"
-#include "controller.h"
-#include "sensors.h"
-}
-
-
 namespace gazebo
 {
 
 ROSflightSIL::ROSflightSIL() :
-  ModelPlugin(), nh_(nullptr), prev_sim_time_(0)  {
+  ModelPlugin(), nh_(nullptr), prev_sim_time_(0), lockstep_(false), calibrate_imu_requested_(false)  {
 }
 
 
 ROSflightSIL::~ROSflightSIL()
 {
   event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  firmware_connection_.reset();
+  estimate_pool_.report(namespace_ + "/" + estimate_topic_);
+  euler_pool_.report(namespace_ + "/" + estimate_topic_ + "/euler");
+  signals_pool_.report(namespace_ + "/" + signals_topic_);
   if (nh_) {
     nh_->shutdown();
     delete nh_;
@@ -77,14 +69,29 @@ void ROSflightSIL::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[ROSflight_SIL] Couldn't find specified link \"" << link_name_ << "\".");
+  state_ = ModelState::Get(link_);
 
   /* Load Params from Gazebo Server */
-  getSdfParam<std::string>(_sdf, "windSpeedTopic", wind_speed_topic_, "wind");
   getSdfParam<std::string>(_sdf, "commandTopic", command_topic_, "command");
   getSdfParam<std::string>(_sdf, "rcTopic", rc_topic_, "rc");
   getSdfParam<std::string>(_sdf, "imuTopic", imu_topic_, "imu/data");
   getSdfParam<std::string>(_sdf, "estimateTopic", estimate_topic_, "attitude");
   getSdfParam<std::string>(_sdf, "signalsTopic", signals_topic_, "motor_signals");
+  getSdfParam<bool>(_sdf, "lockstep", lockstep_, false);
+  getSdfParam<double>(_sdf, "loopRate", loop_rate_, 1000.0);
+  getSdfParam<std::string>(_sdf, "firmwareLibrary", firmware_library_, "librosflight_firmware.so");
+
+  // Every vehicle gets a private copy of the firmware globals
+  fw_.reset(new FirmwareInstance);
+  std::string error;
+  if (!fw_->Load(firmware_library_, &error))
+  {
+    if (error.find("static TLS") != std::string::npos)
+      gzthrow("[ROSflight_SIL] Couldn't load another copy of " << firmware_library_ << ": " << error
+              << "\nThe default static TLS reserve holds about 10 firmware copies per gzserver, start it with"
+              << " GLIBC_TUNABLES=glibc.rtld.optional_static_tls=4096 for up to 15.");
+    gzthrow("[ROSflight_SIL] Couldn't load " << firmware_library_ << ": " << error);
+  }
 
   gzmsg << "loading parameters from " << namespace_ << " ns\n";
 
@@ -101,76 +108,46 @@ void ROSflightSIL::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   std::vector<int> rotor_rotation_directions(num_rotors_);
 
   // For now, just assume all rotors are the same
-  Rotor rotor;
+  std::vector<double> rotor_F, rotor_T;
+  fcu_sim::RotorParams rotor;
 
   ROS_ASSERT(nh_->getParam("rotor_positions", rotor_positions));
   ROS_ASSERT(nh_->getParam("rotor_vector_normal", rotor_vector_normal));
   ROS_ASSERT(nh_->getParam("rotor_rotation_directions", rotor_rotation_directions));
   ROS_ASSERT(nh_->getParam("rotor_max_thrust", rotor.max));
-  ROS_ASSERT(nh_->getParam("rotor_F", rotor.F_poly));
-  ROS_ASSERT(nh_->getParam("rotor_T", rotor.T_poly));
+  ROS_ASSERT(nh_->getParam("rotor_F", rotor_F));
+  ROS_ASSERT(nh_->getParam("rotor_T", rotor_T));
   ROS_ASSERT(nh_->getParam("rotor_tau_up", rotor.tau_up));
   ROS_ASSERT(nh_->getParam("rotor_tau_down", rotor.tau_down));
+  ROS_ASSERT(rotor_F.size() == 3 && rotor_T.size() == 3);
+  std::copy(rotor_F.begin(), rotor_F.end(), rotor.F_poly);
+  std::copy(rotor_T.begin(), rotor_T.end(), rotor.T_poly);
 
   /* Load Rotor Configuration */
-  motors_.resize(num_rotors_);
-
-  force_allocation_matrix_.resize(4,num_rotors_);
-  torque_allocation_matrix_.resize(4,num_rotors_);
+  rotors_ = fcu_sim::makeRotorModel(num_rotors_);
   for(int i = 0; i < num_rotors_; i++)
   {
-    motors_[i].rotor = rotor;
-    motors_[i].position.resize(3);
-    motors_[i].normal.resize(3);
-    for (int j = 0; j < 3; j++)
-    {
-      motors_[i].position(j) = rotor_positions[3*i + j];
-      motors_[i].normal(j) = rotor_vector_normal[3*i + j];
-    }
-    motors_[i].normal.normalize();
-    motors_[i].direction = rotor_rotation_directions[i];
-
-    Eigen::Vector3d moment_from_thrust = motors_[i].position.cross(motors_[i].normal);
-    Eigen::Vector3d moment_from_torque = motors_[i].direction * motors_[i].normal;
-
-    // build allocation_matrices
-    force_allocation_matrix_(0,i) = moment_from_thrust(0); // l
-    force_allocation_matrix_(1,i) = moment_from_thrust(1); // m
-    force_allocation_matrix_(2,i) = moment_from_thrust(2); // n
-    force_allocation_matrix_(3,i) = motors_[i].normal(2); // F
-
-    torque_allocation_matrix_(0,i) = moment_from_torque(0); // l
-    torque_allocation_matrix_(1,i) = moment_from_torque(1); // m
-    torque_allocation_matrix_(2,i) = moment_from_torque(2); // n
-    torque_allocation_matrix_(3,i) = 0.0; // F
+    Eigen::Vector3d position(rotor_positions[3*i], rotor_positions[3*i + 1], rotor_positions[3*i + 2]);
+    Eigen::Vector3d normal(rotor_vector_normal[3*i], rotor_vector_normal[3*i + 1], rotor_vector_normal[3*i + 2]);
+    rotors_->setRotor(i, position, normal, rotor_rotation_directions[i], rotor);
   }
 
-  gzmsg << "allocation matrices:\nFORCE \n" << force_allocation_matrix_ << "\nTORQUE\n" << torque_allocation_matrix_ << "\n";
+  gzmsg << "allocation matrices:\nFORCE \n" << rotors_->forceAllocation() << "\nTORQUE\n" << rotors_->torqueAllocation() << "\n";
 
-  // Initialize size of dynamic force and torque matrices
-  desired_forces_.resize(num_rotors_);
-  desired_torques_.resize(num_rotors_);
-  actual_forces_.resize(num_rotors_);
-  actual_torques_.resize(num_rotors_);
-  motor_signals_.resize(num_rotors_);
-
-  for (int i = 0; i < num_rotors_; i++)
-  {
-    desired_forces_(i)=0.0;
-    desired_torques_(i)=0.0;
-    actual_forces_(i)=0.0;
-    actual_torques_(i)=0.0;
-    motor_signals_(i)=1000;
-  }
+  motor_signals_.assign(num_rotors_, 1000);
 
   // Connect the update function to the simulation
   updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&ROSflightSIL::OnUpdate, this, _1));
+  update_timer_ = fcu_sim::UpdateTimer::get(namespace_ + "/rosflight_sil");
+  command_timer_ = fcu_sim::UpdateTimer::get(namespace_ + "/rosflight_sil/command_callback");
+  rc_timer_ = fcu_sim::UpdateTimer::get(namespace_ + "/rosflight_sil/rc_callback");
+  imu_timer_ = fcu_sim::UpdateTimer::get(namespace_ + "/rosflight_sil/imu_callback");
 
   // Connect Subscribers
   command_sub_ = nh_->subscribe(command_topic_, 1, &ROSflightSIL::CommandCallback, this);
   rc_sub_ = nh_->subscribe(rc_topic_, 1, &ROSflightSIL::RCCallback, this);
-  wind_speed_sub_ = nh_->subscribe(wind_speed_topic_, 1, &ROSflightSIL::WindSpeedCallback, this);
-  imu_sub_ = nh_->subscribe(imu_topic_, 1, &ROSflightSIL::imuCallback, this);
+  if (!lockstep_)
+    imu_sub_ = nh_->subscribe(imu_topic_, 1, &ROSflightSIL::imuCallback, this);
 
   // Connect Publishers
   estimate_pub_ = nh_->advertise<rosflight_msgs::Attitude>(estimate_topic_, 1);
@@ -182,41 +159,45 @@ void ROSflightSIL::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   calibrate_imu_srv_ = nh_->advertiseService("calibrate_imu_bias", &ROSflightSIL::calibrateImuBiasSrvCallback, this);
 
   // Initialize ROSflight code
-  start_time_us_ = (uint64_t)(world_->GetSimTime().Double() * 1e3);
+  start_time_us_ = (uint64_t)(world_->GetSimTime().Double() * 1e6);
   gzmsg << "initializing rosflight\n";
-  rosflight_init();
+  fw_->init();
   gzmsg << "initialized rosflight\n";
+
+  // In lockstep, the firmware reads the IMU model directly and runs off the sim clock
+  if (lockstep_)
+  {
+    imu_.Load(_sdf, link_);
+    last_imu_time_ = world_->GetSimTime();
+    firmware_connection_ = SensorScheduler::Get(world_).Register(namespace_ + "/rosflight", loop_rate_,
+                                                                 boost::bind(&ROSflightSIL::OnFirmwareUpdate, this, _1));
+    gzmsg << "running rosflight in lockstep at " << loop_rate_ << " Hz\n";
+  }
 }
 
 
 // This gets called by the world update event.
 void ROSflightSIL::OnUpdate(const common::UpdateInfo& _info)
 {
+  fcu_sim::ScopedTimer timing(update_timer_);
   sampling_time_ = _info.simTime.Double() - prev_sim_time_;
   prev_sim_time_ = _info.simTime.Double();
   UpdateForcesAndMoments();
   SendForces();
 }
 
-void ROSflightSIL::WindSpeedCallback(const geometry_msgs::Vector3 &wind)
-{
-  W_wind_speed_.x = wind.x;
-  W_wind_speed_.y = wind.y;
-  W_wind_speed_.z = wind.z;
-}
-
 void ROSflightSIL::Reset()
 {
-  start_time_us_ = (uint64_t)(world_->GetSimTime().Double() * 1e3);
-  rosflight_init();
+  last_imu_time_ = world_->GetSimTime();
+  rotors_->reset();
+  // The firmware may be mid-loop on the IMU callback thread, so it restarts on its next tick
+  reset_mailbox_.write((uint64_t)(world_->GetSimTime().Double() * 1e6));
 }
 
 void ROSflightSIL::RCCallback(const rosflight_msgs::OutputRaw &msg)
 {
-  for (int i = 0; i < 8; i++)
-  {
-    _rc_signals[i] = msg.values[i];
-  }
+  fcu_sim::ScopedTimer timing(rc_timer_);
+  rc_mailbox_.write(msg);
 }
 
 void ROSflightSIL::SendForces()
@@ -228,98 +209,140 @@ void ROSflightSIL::SendForces()
 
 
 void ROSflightSIL::CommandCallback(const rosflight_msgs::Command &msg)
+{
+  fcu_sim::ScopedTimer timing(command_timer_);
+  command_mailbox_.write(msg);
+}
+
+
+// Called from the firmware loop with the newest command
+void ROSflightSIL::ApplyCommand(const rosflight_msgs::Command &msg)
 {
   // For now, just arm whenever we get our first command message
-  _armed_state = ARMED;
+  *fw_->armed_state = ARMED;
 
   // Also, notice that we are manually specifying _combined_control
   /// TODO: populate _offboard_control, and use mux_inputs to combine RC and offboard
-  _combined_control.F.active = true;
-  _combined_control.x.active = true;
-  _combined_control.y.active = true;
-  _combined_control.z.active = true;
+  fw_->combined_control->F.active = true;
+  fw_->combined_control->x.active = true;
+  fw_->combined_control->y.active = true;
+  fw_->combined_control->z.active = true;
 
   if (msg.mode == rosflight_msgs::Command::MODE_PASS_THROUGH)
   {
-    _combined_control.x.type = PASSTHROUGH;
-    _combined_control.y.type = PASSTHROUGH;
-    _combined_control.z.type = PASSTHROUGH;
-    _combined_control.F.type = PASSTHROUGH;
-    _combined_control.x.value = msg.x;
-    _combined_control.y.value = msg.y;
-    _combined_control.z.value = msg.z;
+    fw_->combined_control->x.type = PASSTHROUGH;
+    fw_->combined_control->y.type = PASSTHROUGH;
+    fw_->combined_control->z.type = PASSTHROUGH;
+    fw_->combined_control->F.type = PASSTHROUGH;
+    fw_->combined_control->x.value = msg.x;
+    fw_->combined_control->y.value = msg.y;
+    fw_->combined_control->z.value = msg.z;
   }
   else if (msg.mode == rosflight_msgs::Command::MODE_ROLLRATE_PITCHRATE_YAWRATE_THROTTLE)
   {
-    _combined_control.x.type = RATE;
-    _combined_control.y.type = RATE;
-    _combined_control.z.type = RATE;
-    _combined_control.F.type = THROTTLE;
-    _combined_control.x.value = msg.x;
-    _combined_control.y.value = msg.y;
-    _combined_control.z.value = msg.z;
+    fw_->combined_control->x.type = RATE;
+    fw_->combined_control->y.type = RATE;
+    fw_->combined_control->z.type = RATE;
+    fw_->combined_control->F.type = THROTTLE;
+    fw_->combined_control->x.value = msg.x;
+    fw_->combined_control->y.value = msg.y;
+    fw_->combined_control->z.value = msg.z;
 
   }
   else if (msg.mode == rosflight_msgs::Command::MODE_ROLL_PITCH_YAWRATE_THROTTLE)
   {
-    _combined_control.x.type = ANGLE;
-    _combined_control.y.type = ANGLE;
-    _combined_control.z.type = RATE;
-    _combined_control.F.type = THROTTLE;
-    _combined_control.x.value = msg.x;
-    _combined_control.y.value = msg.y;
-    _combined_control.z.value = msg.z;
+    fw_->combined_control->x.type = ANGLE;
+    fw_->combined_control->y.type = ANGLE;
+    fw_->combined_control->z.type = RATE;
+    fw_->combined_control->F.type = THROTTLE;
+    fw_->combined_control->x.value = msg.x;
+    fw_->combined_control->y.value = msg.y;
+    fw_->combined_control->z.value = msg.z;
   }
   else if (msg.mode == rosflight_msgs::Command::MODE_ROLL_PITCH_YAWRATE_ALTITUDE)
   {
-    _combined_control.x.type = ANGLE;
-    _combined_control.y.type = ANGLE;
-    _combined_control.z.type = RATE;
-    _combined_control.F.type = ALTITUDE;
+    fw_->combined_control->x.type = ANGLE;
+    fw_->combined_control->y.type = ANGLE;
+    fw_->combined_control->z.type = RATE;
+    fw_->combined_control->F.type = ALTITUDE;
   }
-  _combined_control.F.value = msg.F;
+  fw_->combined_control->F.value = msg.F;
 }
 
 void ROSflightSIL::imuCallback(const sensor_msgs::Imu &msg)
 {
+  fcu_sim::ScopedTimer timing(imu_timer_);
+  double accel[3] = {msg.linear_acceleration.x, msg.linear_acceleration.y, msg.linear_acceleration.z};
+  double gyro[3] = {msg.angular_velocity.x, msg.angular_velocity.y, msg.angular_velocity.z};
+  RunFirmware(msg.header.stamp, accel, gyro);
+}
+
+
+// Called by the sensor scheduler at the firmware loop rate in lockstep mode
+void ROSflightSIL::OnFirmwareUpdate(const common::UpdateInfo& _info)
+{
+  Eigen::Vector3d accel, gyro;
+  imu_.Sample((_info.simTime - last_imu_time_).Double(), &accel, &gyro);
+  last_imu_time_ = _info.simTime;
+
+  RunFirmware(ros::Time(_info.simTime.sec, _info.simTime.nsec), accel.data(), gyro.data());
+}
+
+
+void ROSflightSIL::RunFirmware(const ros::Time& stamp, const double accel[3], const double gyro[3])
+{
+  if (reset_mailbox_.read(start_time_us_))
+    fw_->init();
+  if (calibrate_imu_requested_.exchange(false))
+    fw_->start_imu_calibration();
+
   // Update the micros Timer in ROSflight
-  SIL_now_us = (uint64_t)(msg.header.stamp.toNSec()*1e-3) - start_time_us_;
+  *fw_->now_us = (uint64_t)(stamp.toNSec()/1000) - start_time_us_;
 
   // Load IMU measurements into the read_raw variables to simulate I2C communication
   // Make sure to put measurements in the NWU (the way the IMU is actually mounted)
-  accel_read_raw[0] = msg.linear_acceleration.x;
-  accel_read_raw[1] = msg.linear_acceleration.y;
-  accel_read_raw[2] = msg.linear_acceleration.z;
+  for (int i = 0; i < 3; i++)
+  {
+    (*fw_->accel_read_raw)[i] = accel[i];
+    (*fw_->gyro_read_raw)[i] = gyro[i];
+  }
 
-  gyro_read_raw[0] = msg.angular_velocity.x;
-  gyro_read_raw[1] = msg.angular_velocity.y;
-  gyro_read_raw[2] = msg.angular_velocity.z;
+  *fw_->temp_read_raw = 25.0;
 
-  temp_read_raw = 25.0;
+  // Pick up the newest RC and offboard commands
+  if (rc_mailbox_.read(rc_))
+  {
+    for (int i = 0; i < 8; i++)
+    {
+      (*fw_->rc_signals)[i] = rc_.values[i];
+    }
+  }
+  if (command_mailbox_.read(command_))
+    ApplyCommand(command_);
 
   // Simulate a read on the IMU
-  SIL_call_IMU_ISR();
+  fw_->call_imu_isr();
 
   // Run the main rosflight loop
-  rosflight_run();
+  fw_->run();
 
   // publish estimate
-  rosflight_msgs::Attitude attitude_msg;
-  geometry_msgs::Vector3Stamped euler_msg;
-  attitude_msg.header.stamp = msg.header.stamp;
-  attitude_msg.attitude.w = _current_state.q.w;
-  attitude_msg.attitude.x = _current_state.q.x;
-  attitude_msg.attitude.y = _current_state.q.y;
-  attitude_msg.attitude.z = _current_state.q.z;
-
-  attitude_msg.angular_velocity.x = _current_state.omega.x;
-  attitude_msg.angular_velocity.y = _current_state.omega.y;
-  attitude_msg.angular_velocity.z = _current_state.omega.z;
-
-  euler_msg.header.stamp = msg.header.stamp;
-  euler_msg.vector.x = _current_state.roll;
-  euler_msg.vector.y = _current_state.pitch;
-  euler_msg.vector.z = _current_state.yaw;
+  rosflight_msgs::AttitudePtr attitude_msg = estimate_pool_.acquire();
+  geometry_msgs::Vector3StampedPtr euler_msg = euler_pool_.acquire();
+  attitude_msg->header.stamp = stamp;
+  attitude_msg->attitude.w = fw_->current_state->q.w;
+  attitude_msg->attitude.x = fw_->current_state->q.x;
+  attitude_msg->attitude.y = fw_->current_state->q.y;
+  attitude_msg->attitude.z = fw_->current_state->q.z;
+
+  attitude_msg->angular_velocity.x = fw_->current_state->omega.x;
+  attitude_msg->angular_velocity.y = fw_->current_state->omega.y;
+  attitude_msg->angular_velocity.z = fw_->current_state->omega.z;
+
+  euler_msg->header.stamp = stamp;
+  euler_msg->vector.x = fw_->current_state->roll;
+  euler_msg->vector.y = fw_->current_state->pitch;
+  euler_msg->vector.z = fw_->current_state->yaw;
 
   estimate_pub_.publish(attitude_msg);
   euler_pub_.publish(euler_msg);
@@ -328,79 +351,49 @@ void ROSflightSIL::imuCallback(const sensor_msgs::Imu &msg)
   // Run Controller
   rosflight_msgs::Command rate_msg, pt_msg;
 
-  pt_msg.x = _command.x;
-  pt_msg.y = _command.y;
-  pt_msg.z = _command.z;
-  pt_msg.F = _command.F;
+  pt_msg.x = fw_->command->x;
+  pt_msg.y = fw_->command->y;
+  pt_msg.z = fw_->command->z;
+  pt_msg.F = fw_->command->F;
   command_pub_.publish(rate_msg);
 
 
-  rosflight_msgs::OutputRaw ESC_signals;
-  ESC_signals.header.stamp.fromSec(world_->GetSimTime().Double());
+  rosflight_msgs::OutputRawPtr ESC_signals = signals_pool_.acquire();
+  ESC_signals->header.stamp = stamp;
   for (int i = 0; i < 8 ; i++)
   {
     // Put signal into message for debug
-    ESC_signals.values[i] = _outputs[i];
-
-    // Put outputs into vector to calculate forces and torques
-    if( i < num_rotors_)
-      motor_signals_(i) = _outputs[i];
+    ESC_signals->values[i] = (*fw_->outputs)[i];
   }
   signals_pub_.publish(ESC_signals);
+
+  // Hand the outputs to the physics update to calculate forces and torques
+  motor_mailbox_.write(*ESC_signals);
 }
 
 
 void ROSflightSIL::UpdateForcesAndMoments()
 {
-  /* Get state information from Gazebo                          *
-     * C denotes child frame, P parent frame, and W world frame.  *
-     * Further C_pose_W_P denotes pose of P wrt. W expressed in C.*/
-  math::Pose W_pose_W_C = link_->GetWorldCoGPose();
-  double pn = W_pose_W_C.pos.x; // We should check to make sure that this is right
-  double pe = -W_pose_W_C.pos.y;
-  double pd = -W_pose_W_C.pos.z;
-  math::Vector3 euler_angles = W_pose_W_C.rot.GetAsEuler();
-  double phi = euler_angles.x;
-  double theta = -euler_angles.y;
-  double psi = -euler_angles.z;
-  math::Vector3 C_linear_velocity_W_C = link_->GetRelativeLinearVel();
-  double u = C_linear_velocity_W_C.x;
-  double v = -C_linear_velocity_W_C.y;
-  double w = -C_linear_velocity_W_C.z;
-  math::Vector3 C_angular_velocity_W_C = link_->GetRelativeAngularVel();
-  double p = C_angular_velocity_W_C.x;
-  double q = -C_angular_velocity_W_C.y;
-  double r = -C_angular_velocity_W_C.z;
-
-  // wind info is available in the wind_ struct
-  // Rotate into body frame and relative velocity
-  math::Vector3 C_wind_speed = W_pose_W_C.rot.RotateVector(W_wind_speed_);
-  double ur = u - C_wind_speed.x;
-  double vr = v - C_wind_speed.y;
-  double wr = w - C_wind_speed.z;
-
-  // Calculate Forces
-  for (int i = 0; i<num_rotors_; i++)
+  /* Get state information from the shared snapshot (in NED) */
+  const ModelState::NEDState& x = state_->Snapshot();
+
+  // Body velocity relative to this step's wind
+  double ur = x.ur;
+  double vr = x.vr;
+  double wr = x.wr;
+
+  // Newest motor outputs from the firmware
+  if (motor_mailbox_.read(esc_signals_))
   {
-    // First, figure out the desired force output from passing the signal into the quadratic approximation
-    double signal = motor_signals_(i);
-    desired_forces_(i,0) = motors_[i].rotor.F_poly[0]*signal*signal + motors_[i].rotor.F_poly[1]*signal + motors_[i].rotor.F_poly[2];
-    desired_torques_(i,0) = motors_[i].rotor.T_poly[0]*signal*signal + motors_[i].rotor.T_poly[1]*signal + motors_[i].rotor.T_poly[2];
-
-    // Then, Calculate Actual force and torque for each rotor using first-order dynamics
-    double tau = (desired_forces_(i,0) > actual_forces_(i,0)) ? motors_[i].rotor.tau_up : motors_[i].rotor.tau_down;
-    double alpha = sampling_time_/(tau + sampling_time_);
-    actual_forces_(i,0) = sat((1-alpha)*actual_forces_(i) + alpha*desired_forces_(i), motors_[i].rotor.max, 0.0);
-    actual_torques_(i,0) = sat((1-alpha)*actual_torques_(i) + alpha*desired_torques_(i), motors_[i].rotor.max, 0.0);
+    for (int i = 0; i < num_rotors_ && i < 8; i++)
+      motor_signals_[i] = esc_signals_.values[i];
   }
 
-  // Use the allocation matrix to calculate the body-fixed force and torques
-  Eigen::Vector4d output_forces = force_allocation_matrix_*actual_forces_;
-  Eigen::Vector4d output_torques = torque_allocation_matrix_*actual_torques_;
-  Eigen::Vector4d output_forces_and_torques = output_forces + output_torques;
+  // Rotor dynamics and allocation, evaluated for all rotors at once
+  Eigen::Vector4d output_forces_and_torques = rotors_->step(motor_signals_.data(), sampling_time_);
 
   // Calculate Ground Effect
-  double z = -pd;
+  double z = -x.pd;
   double ground_effect = max(ground_effect_[0]*z*z*z*z + ground_effect_[1]*z*z*z + ground_effect_[2]*z*z + ground_effect_[3]*z + ground_effect_[4], 0);
 
   //  // Apply other forces (wind) <- follows "Quadrotors and Accelerometers - State Estimation With an Improved Dynamic Model"
@@ -408,25 +401,19 @@ void ROSflightSIL::UpdateForcesAndMoments()
   forces_.Fx = -linear_mu_*ur;
   forces_.Fy = -linear_mu_*vr;
   forces_.Fz = -linear_mu_*wr - ground_effect + output_forces_and_torques(3);
-  forces_.l = -angular_mu_*p + output_forces_and_torques(0);
-  forces_.m = -angular_mu_*q + output_forces_and_torques(1);
-  forces_.n = -angular_mu_*r + output_forces_and_torques(2);
+  forces_.l = -angular_mu_*x.p + output_forces_and_torques(0);
+  forces_.m = -angular_mu_*x.q + output_forces_and_torques(1);
+  forces_.n = -angular_mu_*x.r + output_forces_and_torques(2);
 }
 
 
 bool ROSflightSIL::calibrateImuBiasSrvCallback(std_srvs::Trigger::Request &req, std_srvs::Trigger::Response &res)
 {
-  return start_imu_calibration();
-}
-
-double ROSflightSIL::sat(double x, double max, double min)
-{
-  if(x > max)
-    return max;
-  else if(x < min)
-    return min;
-  else
-    return x;
+  // Picked up by the next firmware tick rather than calling into the firmware from this thread
+  calibrate_imu_requested_ = true;
+  res.success = true;
+  res.message = "IMU calibration starts on the next firmware loop";
+  return true;
 }
 
 double ROSflightSIL::max(double x, double y)
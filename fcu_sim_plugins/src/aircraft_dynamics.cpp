@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/aircraft_dynamics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fcu_sim
+{
+
+// The following parameters are aircraft-specific, most of these can be found using AVL
+// The rest are more geometry-based and can be found in conventional methods
+// For the moments of inertia, look into using the BiFilar pendulum method
+AircraftParams::AircraftParams() :
+  mass(13.5),
+  Jx(0.8244),
+  Jy(1.135),
+  Jz(1.759),
+  Jxz(.1204),
+  rho(1.2682),
+  wing{0.55, 2.8956, 0.18994, 0.55, 2.8956, 0.18994},
+  prop{80.0, 0.0, 0.0, 0.9, 0.202, 1.0},
+  //   O         alpha  beta   p       q     r      delta_a delta_e delta_r
+  CL{  0.28,     3.45,  0.0,   0.0,    0.0,  0.0,   0.0,    -0.36,  0.0},
+  CD{  0.03,     0.30,  0.0,   0.0437, 0.0,  0.0,   0.0,    0.0,    0.0},
+  Cm{  -0.02338, -0.38, 0.0,   0.0,    -3.6, 0.0,   0.0,    -0.5,   0.0},
+  CY{  0.0,      0.00,  -0.98, 0.0,    0.0,  0.0,   0.0,    0.0,    -0.017},
+  Cell{0.0,      0.00,  -0.12, -0.26,  0.0,  0.14,  0.08,   0.0,    0.105},
+  Cn{  0.0,      0.0,   0.25,  0.022,  0.0,  -0.35, 0.06,   0.0,    -0.032}
+{}
+
+
+AircraftAeroTable::AircraftAeroTable() :
+  inv_step_(0.0)
+{}
+
+
+void AircraftAeroTable::build(const AircraftParams& params, double resolution)
+{
+  // Left empty, so callers fall back to the analytic model, rather than sizing from a bad step
+  table_.clear();
+  if (!(std::isfinite(resolution) && resolution > 0.0))
+    return;
+
+  // Whole number of intervals across [-pi, pi], so both ends land on grid points
+  size_t intervals = static_cast<size_t>(std::ceil(2.0*M_PI/resolution));
+  if (intervals < 1)
+    intervals = 1;
+  double step = 2.0*M_PI/intervals;
+  inv_step_ = 1.0/step;
+
+  table_.resize(intervals + 1);
+  for (size_t i = 0; i <= intervals; i++)
+    computeAlphaCoeffs(params, -M_PI + i*step, table_[i]);
+}
+
+
+void AircraftAeroTable::lookup(double alpha, AircraftAlphaCoeffs& out) const
+{
+  // atan2 keeps alpha in [-pi, pi], clamp anyway so rounding can't index past the ends
+  double x = (alpha + M_PI)*inv_step_;
+  size_t last = table_.size() - 2;
+  size_t i = x > 0.0 ? static_cast<size_t>(x) : 0;
+  if (i > last)
+    i = last;
+  double f = x - i;
+  if (f < 0.0)
+    f = 0.0;
+  else if (f > 1.0)
+    f = 1.0;
+
+  const AircraftAlphaCoeffs& a = table_[i];
+  const AircraftAlphaCoeffs& b = table_[i + 1];
+  out.CX = a.CX + f*(b.CX - a.CX);
+  out.CX_q = a.CX_q + f*(b.CX_q - a.CX_q);
+  out.CX_delta_e = a.CX_delta_e + f*(b.CX_delta_e - a.CX_delta_e);
+  out.CZ = a.CZ + f*(b.CZ - a.CZ);
+  out.CZ_q = a.CZ_q + f*(b.CZ_q - a.CZ_q);
+  out.CZ_delta_e = a.CZ_delta_e + f*(b.CZ_delta_e - a.CZ_delta_e);
+}
+
+
+double AircraftAeroTable::maxError(const AircraftParams& params) const
+{
+  double max_error = 0.0;
+  double step = 1.0/inv_step_;
+  for (size_t i = 0; i + 1 < table_.size(); i++)
+  {
+    double alpha = -M_PI + (i + 0.5)*step;
+    AircraftAlphaCoeffs exact, interpolated;
+    computeAlphaCoeffs(params, alpha, exact);
+    lookup(alpha, interpolated);
+    double errors[] = {exact.CX - interpolated.CX, exact.CX_q - interpolated.CX_q,
+                       exact.CX_delta_e - interpolated.CX_delta_e, exact.CZ - interpolated.CZ,
+                       exact.CZ_q - interpolated.CZ_q, exact.CZ_delta_e - interpolated.CZ_delta_e};
+    for (double error : errors)
+      max_error = std::max(max_error, std::fabs(error));
+  }
+  return max_error;
+}
+
+}
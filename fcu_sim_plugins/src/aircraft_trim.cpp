@@ -0,0 +1,219 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/aircraft_trim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Dense>
+
+#include "fcu_sim_plugins/dual.h"
+
+namespace fcu_sim
+{
+
+namespace
+{
+
+// Newton unknowns
+enum TrimUnknown
+{
+  TRIM_ALPHA, TRIM_PHI, TRIM_E, TRIM_T, TRIM_A, TRIM_R,
+  NUM_TRIM_UNKNOWNS
+};
+
+// The dynamic equations driven to zero, the kinematic ones hold by construction
+const int dynamic_states[NUM_TRIM_UNKNOWNS] = {STATE_U, STATE_V, STATE_W, STATE_P, STATE_Q, STATE_R};
+
+typedef Eigen::Matrix<double, NUM_TRIM_UNKNOWNS, 1> TrimVector;
+typedef Eigen::Matrix<double, NUM_TRIM_UNKNOWNS, NUM_TRIM_UNKNOWNS> TrimJacobian;
+typedef Dual<NUM_TRIM_UNKNOWNS> TrimDual;
+typedef Dual<NUM_RIGID_BODY_STATES + NUM_AIRCRAFT_INPUTS> StateInputDual;
+
+
+double turnRate(const TrimCondition& c)
+{
+  return std::isinf(c.R) ? 0.0 : c.Va*cos(c.gamma)/c.R;
+}
+
+
+// Trim state for a given alpha and phi (eq 5.21 - 5.23, with theta solved from the climb rate)
+template <class T>
+void trimState(const TrimCondition& c, const T& alpha, const T& phi, T x[NUM_RIGID_BODY_STATES])
+{
+  using std::asin;
+  using std::atan2;
+  using std::cos;
+  using std::sin;
+  using std::sqrt;
+
+  T u = c.Va*cos(alpha)*cos(c.beta);
+  T v = c.Va*sin(c.beta);
+  T w = c.Va*sin(alpha)*cos(c.beta);
+
+  // theta = alpha + gamma only holds wings level with no sideslip, so solve
+  // pd_dot = -Va sin(gamma) for theta instead: u sin(theta) - b cos(theta) = Va sin(gamma)
+  T b = sin(phi)*v + cos(phi)*w;
+  T ratio = c.Va*sin(c.gamma)/sqrt(u*u + b*b);
+  if (ratio > 1.0)
+    ratio = 1.0;
+  else if (ratio < -1.0)
+    ratio = -1.0;
+  T theta = atan2(b, u) + asin(ratio);
+
+  double psi_dot = turnRate(c);
+  x[STATE_PN] = 0.0;
+  x[STATE_PE] = 0.0;
+  x[STATE_PD] = 0.0;
+  x[STATE_U] = u;
+  x[STATE_V] = v;
+  x[STATE_W] = w;
+  x[STATE_PHI] = phi;
+  x[STATE_THETA] = theta;
+  x[STATE_PSI] = 0.0;
+  x[STATE_P] = -psi_dot*sin(theta);
+  x[STATE_Q] = psi_dot*sin(phi)*cos(theta);
+  x[STATE_R] = psi_dot*cos(phi)*cos(theta);
+}
+
+
+template <class T>
+void unpack(const TrimCondition& c, const T z[NUM_TRIM_UNKNOWNS], T x[NUM_RIGID_BODY_STATES],
+            T u[NUM_AIRCRAFT_INPUTS])
+{
+  trimState(c, z[TRIM_ALPHA], z[TRIM_PHI], x);
+  u[INPUT_E] = z[TRIM_E];
+  u[INPUT_T] = z[TRIM_T];
+  u[INPUT_A] = z[TRIM_A];
+  u[INPUT_R] = z[TRIM_R];
+}
+
+
+// Dynamic residuals and their exact Jacobian with respect to the unknowns
+void residual(const AircraftParams& params, const RigidBodyParams& body, const TrimCondition& c,
+              const TrimVector& z, TrimVector& f, TrimJacobian* J)
+{
+  TrimDual zd[NUM_TRIM_UNKNOWNS];
+  for (int i = 0; i < NUM_TRIM_UNKNOWNS; i++)
+    zd[i] = TrimDual::variable(z(i), i);
+
+  TrimDual x[NUM_RIGID_BODY_STATES], u[NUM_AIRCRAFT_INPUTS], xdot[NUM_RIGID_BODY_STATES];
+  unpack(c, zd, x, u);
+  aircraftDerivatives(params, body, x, u, xdot);
+
+  for (int i = 0; i < NUM_TRIM_UNKNOWNS; i++)
+  {
+    const TrimDual& fi = xdot[dynamic_states[i]];
+    f(i) = fi.v;
+    if (J != NULL)
+      for (int j = 0; j < NUM_TRIM_UNKNOWNS; j++)
+        (*J)(i, j) = fi.d[j];
+  }
+}
+
+}
+
+
+TrimOptions::TrimOptions() :
+  max_iterations(50),
+  tolerance(1e-9)
+{}
+
+
+void linearizeAircraft(const AircraftParams& params, const RigidBodyParams& body,
+                       const double x[NUM_RIGID_BODY_STATES], const double u[NUM_AIRCRAFT_INPUTS],
+                       double A[NUM_RIGID_BODY_STATES][NUM_RIGID_BODY_STATES],
+                       double B[NUM_RIGID_BODY_STATES][NUM_AIRCRAFT_INPUTS])
+{
+  // One pass with every state and input as an independent variable
+  StateInputDual xd[NUM_RIGID_BODY_STATES], ud[NUM_AIRCRAFT_INPUTS], xdot[NUM_RIGID_BODY_STATES];
+  for (int j = 0; j < NUM_RIGID_BODY_STATES; j++)
+    xd[j] = StateInputDual::variable(x[j], j);
+  for (int j = 0; j < NUM_AIRCRAFT_INPUTS; j++)
+    ud[j] = StateInputDual::variable(u[j], NUM_RIGID_BODY_STATES + j);
+  aircraftDerivatives(params, body, xd, ud, xdot);
+
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+  {
+    for (int j = 0; j < NUM_RIGID_BODY_STATES; j++)
+      A[i][j] = xdot[i].d[j];
+    for (int j = 0; j < NUM_AIRCRAFT_INPUTS; j++)
+      B[i][j] = xdot[i].d[NUM_RIGID_BODY_STATES + j];
+  }
+}
+
+
+TrimResult computeTrim(const AircraftParams& params, const RigidBodyParams& body,
+                       const TrimCondition& c, const TrimOptions& options)
+{
+  TrimResult result;
+
+  // Start from level flight at the coordinated turn bank angle
+  TrimVector z = TrimVector::Zero();
+  z(TRIM_ALPHA) = 0.05;
+  z(TRIM_PHI) = atan(c.Va*turnRate(c)/body.gravity);
+  z(TRIM_T) = 0.5;
+
+  TrimVector f;
+  TrimJacobian J;
+  residual(params, body, c, z, f, &J);
+  result.iterations = 0;
+  while (result.iterations < options.max_iterations && f.cwiseAbs().maxCoeff() > options.tolerance)
+  {
+    result.iterations++;
+
+    // Newton step, halved until the residual goes down
+    TrimVector dz = J.colPivHouseholderQr().solve(-f);
+    double scale = 1.0;
+    TrimVector z_next, f_next;
+    for (int i = 0; i < 20; i++, scale *= 0.5)
+    {
+      z_next = z + scale*dz;
+      residual(params, body, c, z_next, f_next, NULL);
+      if (f_next.allFinite() && f_next.norm() < f.norm())
+        break;
+    }
+    if (!f_next.allFinite() || f_next.norm() >= f.norm())
+      break;
+    z = z_next;
+    residual(params, body, c, z, f, &J);
+  }
+
+  // Thrust goes with throttle squared, so report the positive root
+  z(TRIM_T) = std::fabs(z(TRIM_T));
+  result.alpha = z(TRIM_ALPHA);
+  unpack(c, z.data(), result.x, result.u);
+
+  // Check every derivative that has a trim value, not just the ones Newton saw
+  double xdot[NUM_RIGID_BODY_STATES];
+  aircraftDerivatives(params, body, result.x, result.u, xdot);
+  double desired[NUM_RIGID_BODY_STATES] = {0.0};
+  desired[STATE_PD] = -c.Va*sin(c.gamma);
+  desired[STATE_PSI] = turnRate(c);
+  result.residual = 0.0;
+  for (int i = STATE_PD; i < NUM_RIGID_BODY_STATES; i++)
+    result.residual = std::max(result.residual, std::fabs(xdot[i] - desired[i]));
+  if (!std::isfinite(result.residual))
+    result.residual = std::numeric_limits<double>::infinity();
+  result.converged = result.residual <= options.tolerance;
+
+  linearizeAircraft(params, body, result.x, result.u, result.A, result.B);
+  return result;
+}
+
+}
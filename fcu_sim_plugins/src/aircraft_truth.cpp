@@ -20,7 +20,7 @@ namespace gazebo
 {
 
 AircraftTruth::AircraftTruth() :
-  ModelPlugin(),
+  LazySensorPlugin(),
   node_handle_(nullptr),
   prev_sim_time_(0)
 {}
@@ -28,7 +28,8 @@ AircraftTruth::AircraftTruth() :
 
 AircraftTruth::~AircraftTruth()
 {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
+  true_state_pool_.report(namespace_ + "/" + truth_topic_);
   if (node_handle_) {
     node_handle_->shutdown();
     delete node_handle_;
@@ -59,78 +60,74 @@ void AircraftTruth::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[gazebo_aircraft_truth] Couldn't find specified link \"" << link_name_ << "\".");
+  state_ = ModelState::Get(link_);
 
   /* Load Params from Gazebo Server */
-  getSdfParam<std::string>(_sdf, "windSpeedTopic", wind_speed_topic_, "wind");
   getSdfParam<std::string>(_sdf, "truthTopic", truth_topic_, "truth");
+  getSdfParam<double>(_sdf, "publishRate", pub_rate_, 100.0);
 
+  // Connect the update function to the simulation, on multiples of the publish period in sim time
+  updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/" + truth_topic_, pub_rate_,
+                                                            boost::bind(&AircraftTruth::OnUpdate, this, _1), 0.0);
 
-  // Connect the update function to the simulation
-  updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&AircraftTruth::OnUpdate, this, _1));
-
-  // Connect Subscribers
   true_state_pub_ = node_handle_->advertise<rosflight_msgs::State>(truth_topic_,1);
-  wind_speed_sub_ = node_handle_->subscribe(wind_speed_topic_, 1, &AircraftTruth::WindSpeedCallback, this);
+  AddConsumer(true_state_pub_);
+  LoadLazySensor(_sdf, pub_rate_ > 0.0 ? 1.0/pub_rate_ : 0.0, world_->GetSimTime());
 }
 
 // This gets called by the world update event.
 void AircraftTruth::OnUpdate(const common::UpdateInfo& _info) {
+  int skipped;
+  if (!SampleNeeded(_info.simTime, &skipped))
+    return;
 
   sampling_time_ = _info.simTime.Double() - prev_sim_time_;
   prev_sim_time_ = _info.simTime.Double();
   PublishTruth();
 }
 
-void AircraftTruth::WindSpeedCallback(const geometry_msgs::Vector3 &wind){
-  wind_.N = wind.x;
-  wind_.E = wind.y;
-  wind_.D = wind.z;
-}
-
 
 void AircraftTruth::PublishTruth()
 {
   /* Get state information from Gazebo - convert to NED         *
    * C denotes child frame, P parent frame, and W world frame.  *
    * Further C_pose_W_P denotes pose of P wrt. W expressed in C.*/
-  rosflight_msgs::State msg;
-  math::Pose W_pose_W_C = link_->GetWorldCoGPose();
-  msg.position[0] = W_pose_W_C.pos.x; // We should check to make sure that this is right
-  msg.position[1] = -W_pose_W_C.pos.y;
-  msg.position[2] = -W_pose_W_C.pos.z;
-  math::Vector3 euler_angles = W_pose_W_C.rot.GetAsEuler();
-  msg.phi = euler_angles.x;
-  msg.theta = -euler_angles.y;
-  msg.psi = -euler_angles.z;
-  math::Vector3 C_linear_velocity_W_C = link_->GetRelativeLinearVel();
-  double u = C_linear_velocity_W_C.x;
-  double v = -C_linear_velocity_W_C.y;
-  double w = -C_linear_velocity_W_C.z;
-  msg.Vg = sqrt(pow(u,2.0) + pow(v,2.0) + pow(w,2.0));
-  math::Vector3 C_angular_velocity_W_C = link_->GetRelativeAngularVel();
-  msg.p = C_angular_velocity_W_C.x;
-  msg.q = -C_angular_velocity_W_C.y;
-  msg.r = -C_angular_velocity_W_C.z;
-
-  msg.wn = wind_.N;
-  msg.we = wind_.E;
-
-  // wind info is available in the wind_ struct
-  double ur = u ;//- wind_.N;
-  double vr = v ;//- wind_.E;
-  double wr = w ;//- wind_.D;
-
-  msg.Va = sqrt(pow(ur,2.0) + pow(vr,2.0) + pow(wr,2.0));
-  msg.chi = atan2(msg.Va*sin(msg.psi), msg.Va*cos(msg.psi));
-  msg.alpha = atan2(wr , ur);
-  msg.beta = asin(vr/msg.Va);
-
-  msg.quat_valid = false;
-  msg.quat[0] = u;
-  msg.quat[1] = v;
-  msg.quat[2] = w;
-
-  //msg.header.stamp.fromSec(world_->GetSimTime().Double());
+  const ModelState::NEDState& x = state_->Snapshot();
+
+  rosflight_msgs::StatePtr msg = true_state_pool_.acquire();
+  msg->position[0] = x.pn;
+  msg->position[1] = x.pe;
+  msg->position[2] = x.pd;
+  msg->phi = x.phi;
+  msg->theta = x.theta;
+  msg->psi = x.psi;
+  double u = x.u;
+  double v = x.v;
+  double w = x.w;
+  msg->Vg = sqrt(pow(u,2.0) + pow(v,2.0) + pow(w,2.0));
+  msg->p = x.p;
+  msg->q = x.q;
+  msg->r = x.r;
+
+  msg->wn = x.wind.x;
+  msg->we = x.wind.y;
+
+  // wind for this step is in x.wind
+  double ur = u ;//- x.wind.x;
+  double vr = v ;//- x.wind.y;
+  double wr = w ;//- x.wind.z;
+
+  msg->Va = sqrt(pow(ur,2.0) + pow(vr,2.0) + pow(wr,2.0));
+  msg->chi = atan2(msg->Va*sin(msg->psi), msg->Va*cos(msg->psi));
+  msg->alpha = atan2(wr , ur);
+  msg->beta = asin(vr/msg->Va);
+
+  msg->quat_valid = false;
+  msg->quat[0] = u;
+  msg->quat[1] = v;
+  msg->quat[2] = w;
+
+  //msg->header.stamp.fromSec(world_->GetSimTime().Double());
 
   true_state_pub_.publish(msg);
 }
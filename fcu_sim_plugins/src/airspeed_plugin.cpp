@@ -16,29 +16,23 @@
 
 #include "fcu_sim_plugins/airspeed_plugin.h"
 
+#include <gazebo/math/Rand.hh>
+
 
 namespace gazebo {
 
 
-AirspeedPlugin::AirspeedPlugin() : ModelPlugin() {}
+AirspeedPlugin::AirspeedPlugin() : LazySensorPlugin() {}
 
 
 AirspeedPlugin::~AirspeedPlugin() {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
   if (nh_) {
     nh_->shutdown();
     delete nh_;
   }
 }
 
-void AirspeedPlugin::WindSpeedCallback(const geometry_msgs::Vector3 &wind){
-  wind_.N = wind.x;
-  wind_.E = wind.y;
-  wind_.D = wind.z;
-}
-
-
-
 void AirspeedPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   // Store the pointer to the model
   model_ = _model;
@@ -60,6 +54,7 @@ void AirspeedPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[gazebo_imu_plugin] Couldn't find specified link \"" << link_name_ << "\".");
+  state_ = ModelState::Get(link_);
 
   frame_id_ = link_name_;
 
@@ -69,40 +64,41 @@ void AirspeedPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   getSdfParam<double>(_sdf, "airDensity", rho_, 1.225);
   getSdfParam<double>(_sdf, "maxPressure", max_pressure_, 4000.0);
   getSdfParam<double>(_sdf, "minPressure", min_pressure_, 0.0);
+  getSdfParam<double>(_sdf, "publishRate", pub_rate_, 100.0);
 
 
-  last_time_ = world_->GetSimTime();
-
-  // Listen to the update event. This event is broadcast every simulation iteration.
-  this->updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&AirspeedPlugin::OnUpdate, this, _1));
+  // Ask the world's sensor scheduler to call us at the publish rate, on multiples of the period in sim time
+  this->updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/" + airspeed_topic_, pub_rate_,
+                                                                  boost::bind(&AirspeedPlugin::OnUpdate, this, _1),
+                                                                  0.0);
 
   airspeed_pub_ = nh_->advertise<rosflight_msgs::Airspeed>(airspeed_topic_, 10);
+  AddConsumer(airspeed_pub_);
+  LoadLazySensor(_sdf, pub_rate_ > 0.0 ? 1.0/pub_rate_ : 0.0, world_->GetSimTime());
 
   // Fill static members of airspeed message.
   airspeed_message_.header.frame_id = frame_id_;
 
-  standard_normal_distribution_ = std::normal_distribution<double>(0.0, 1.0);
+  // Without a seed, follow the world seed (gzserver --seed) so a run can still be reproduced
+  unsigned int seed;
+  getSdfParam<unsigned int>(_sdf, "seed", seed, math::Rand::GetSeed());
+  random_.seed(seed, namespace_ + "/airspeed");
 }
 
 // This gets called by the world update start event.
 void AirspeedPlugin::OnUpdate(const common::UpdateInfo& _info) {
+  // White noise only, nothing to catch up on after a gap
+  int skipped;
+  if (!SampleNeeded(_info.simTime, &skipped))
+    return;
 
-  // Calculate Airspeed
-  math::Vector3 C_linear_velocity_W_C = link_->GetRelativeLinearVel();
-  double u = C_linear_velocity_W_C.x;
-  double v = -C_linear_velocity_W_C.y;
-  double w = -C_linear_velocity_W_C.z;
-
-  /// TODO: Wind is being applied in the inertial frame, not the body-fixed frame
-  double ur = u - wind_.N;
-  double vr = v - wind_.E;
-  double wr = w - wind_.D;
-//  double Va = sqrt(pow(ur,2.0) + pow(vr,2.0) + pow(wr,2.0));
-  double Va = sqrt(pow(u,2.0) + pow(v,2.0) + pow(w,2.0));
+  // Airspeed relative to this step's wind
+  const ModelState::NEDState& x = state_->Snapshot();
+  double Va = x.Va;
 
   // Invert Airpseed to get sensor measurement
   double y = rho_*Va*Va/2.0; // Page 130 in the UAV Book
-  y += pressure_bias_ + pressure_noise_sigma_*standard_normal_distribution_(random_generator_);
+  y += pressure_bias_ + pressure_noise_sigma_*random_.normal();
 
   y = (y>max_pressure_)?max_pressure_:y;
   y = (y<min_pressure_)?min_pressure_:y;
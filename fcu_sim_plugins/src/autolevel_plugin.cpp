@@ -21,7 +21,7 @@ namespace gazebo {
 AutoLevelPlugin::AutoLevelPlugin() : ModelPlugin() {}
 
 AutoLevelPlugin::~AutoLevelPlugin() {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
 }
 
 void AutoLevelPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
@@ -47,6 +47,7 @@ void AutoLevelPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   std::string link_name;
   if (_sdf->HasElement("modelLink")){
     model_link = model_->GetLink(_sdf->GetElement("modelLink")->Get<std::string>());
+    model_state = ModelState::Get(model_link);
   }else{
     gzerr << "[AutoLevelPlugin] Please specify a linkName of the forces and moments plugin.\n";
   }
@@ -54,7 +55,8 @@ void AutoLevelPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
 
 
   // Connect Gazebo Update
-  updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&AutoLevelPlugin::OnUpdate, this, _1));
+  updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/autolevel", 0.0,
+                                                            boost::bind(&AutoLevelPlugin::OnUpdate, this, _1));
 
 
   // Set the axes of the gimbal
@@ -74,11 +76,11 @@ void AutoLevelPlugin::Reset()
 // Return the Sign of the argument
 void AutoLevelPlugin::OnUpdate(const common::UpdateInfo & _info)
 {
-    math::Vector3 global_pose = model_link->GetWorldCoGPose().rot.GetAsEuler();
+    const ModelState::NEDState& x = model_state->Snapshot();
     math::Vector3 relative_pose = model_link->GetRelativePose().rot.GetAsEuler();
 
-    double roll = -global_pose.x;
-    double pitch =  -global_pose.y;
+    double roll = -x.phi;
+    double pitch = x.theta;
     double yaw = -relative_pose.z;
 
     sensor_link->SetRelativePose(math::Pose(0, 0, -.50, roll, pitch, yaw));
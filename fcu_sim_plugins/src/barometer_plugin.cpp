@@ -16,14 +16,16 @@
 
 #include "fcu_sim_plugins/barometer_plugin.h"
 
+#include <gazebo/math/Rand.hh>
+
 namespace gazebo {
 
 AltimeterPlugin::AltimeterPlugin()
-    : ModelPlugin(),
+    : LazySensorPlugin(),
       node_handle_(0){}
 
 AltimeterPlugin::~AltimeterPlugin() {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
   if (node_handle_) {
     node_handle_->shutdown();
     delete node_handle_;
@@ -48,8 +50,6 @@ void AltimeterPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[barometer_plugin] Couldn't find specified link \"" << link_name_ << "\".");
-  // Connect to the Gazebo Update
-  this->updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&AltimeterPlugin::OnUpdate, this, _1));
   frame_id_ = link_name_;
 
   // load params from xacro
@@ -57,43 +57,51 @@ void AltimeterPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   getSdfParam<double>(_sdf, "noiseStdev", error_stdev_, 0.10);
   getSdfParam<double>(_sdf, "publishRate", pub_rate_, 50.0);
   getSdfParam<bool>(_sdf, "noiseOn", noise_on_, true);
-  last_time_ = world_->GetSimTime();
 
   // Configure ROS Integration
   node_handle_ = new ros::NodeHandle(namespace_);
   alt_pub_ = node_handle_->advertise<rosflight_msgs::Barometer>(message_topic_, 10);
+  AddConsumer(alt_pub_);
+  LoadLazySensor(_sdf, pub_rate_ > 0.0 ? 1.0/pub_rate_ : 0.0, world_->GetSimTime());
 
   // Configure Noise
-  random_generator_= std::default_random_engine(std::chrono::system_clock::now().time_since_epoch().count());
-  standard_normal_distribution_ = std::normal_distribution<double>(0.0, error_stdev_);
+  // Without a seed, follow the world seed (gzserver --seed), the wall clock made runs unrepeatable
+  unsigned int seed;
+  getSdfParam<unsigned int>(_sdf, "seed", seed, math::Rand::GetSeed());
+  random_.seed(seed, namespace_ + "/baro");
+
+  // Ask the world's sensor scheduler to call us at the publish rate
+  this->updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/" + message_topic_, pub_rate_,
+                                                                  boost::bind(&AltimeterPlugin::OnUpdate, this, _1));
 }
 
 
+// This gets called by the sensor scheduler whenever a sample is due.
 void AltimeterPlugin::OnUpdate(const common::UpdateInfo& _info)
 {
-  // check if time to publish
-  common::Time current_time  = world_->GetSimTime();
-  if((current_time - last_time_).Double() > 1.0/pub_rate_){
-
-    // pull z measurement out of Gazebo
-    math::Pose current_state_LFU = link_->GetWorldPose();
-
-    rosflight_msgs::Barometer message;
-    message.altitude = current_state_LFU.pos.z;
-    // add noise, if requested
-    if(noise_on_){
-      message.altitude += standard_normal_distribution_(random_generator_);
-    }
+  // White noise only, nothing to catch up on after a gap
+  int skipped;
+  if (!SampleNeeded(_info.simTime, &skipped))
+    return;
+
+  // pull z measurement out of Gazebo
+  math::Pose current_state_LFU = link_->GetWorldPose();
+
+  rosflight_msgs::Barometer message;
+  message.altitude = current_state_LFU.pos.z;
+  // add noise, if requested
+  if(noise_on_){
+    message.altitude += error_stdev_*random_.normal();
+  }
 
-    // Invert measurement model for pressure and temperature
-    message.temperature = 25.0; // This is constant for simulation
-    message.pressure = 101325.0*pow(1- (2.25577e-5 * message.altitude), 5.25588);
+  // Invert measurement model for pressure and temperature
+  message.temperature = 25.0; // This is constant for simulation
+  message.pressure = 101325.0*pow(1- (2.25577e-5 * message.altitude), 5.25588);
 
 
-    // publish message
-    message.header.stamp.fromSec(world_->GetSimTime().Double());
-    alt_pub_.publish(message);
-  }
+  // publish message
+  message.header.stamp.fromSec(_info.simTime.Double());
+  alt_pub_.publish(message);
 }
 
 GZ_REGISTER_MODEL_PLUGIN(AltimeterPlugin);
@@ -0,0 +1,439 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Headless Monte-Carlo runner.  Loads an agent yaml (the same file the launch
+ * files hand to rosparam) and a scenario yaml, then flies every dispersed run
+ * with the same force models the Gazebo plugins use, a fixed-step rigid-body
+ * integrator in place of the physics engine, and no ROS or Gazebo at all.
+ *
+ *   fcu_sim_batch <agent.yaml> <scenario.yaml> <output file>
+ *
+ * See fcu_sim/agents/mikey/dispersion.yaml for the scenario format.  Per-run
+ * metrics are written with ColumnarTable.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include "fcu_sim_plugins/aircraft_dynamics.h"
+#include "fcu_sim_plugins/columnar_writer.h"
+#include "fcu_sim_plugins/multirotor_dynamics.h"
+#include "fcu_sim_plugins/rigid_body.h"
+#include "fcu_sim_plugins/work_stealing_pool.h"
+#include "fcu_sim_plugins/yaml_params.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+// 1-sigma dispersions, applied independently to every run
+struct Dispersion
+{
+  double mass; // fraction of nominal
+  double drag; // fraction of nominal
+  double wind; // m/s, per NED axis
+  double gyro_noise; // rad/s, on the rate feedback
+  double attitude_noise; // rad, on the roll/pitch feedback
+  double altitude_noise; // m, on the altitude feedback
+};
+
+struct Scenario
+{
+  std::string vehicle;
+  int runs;
+  double duration;
+  double dt;
+  unsigned seed;
+  unsigned threads;
+  int batch;
+
+  double initial_altitude;
+  double initial_speed;
+
+  // multirotor only - inertia lives in the xacro, not the agent yaml
+  RigidBodyParams body;
+  int mode;
+  double command[4];
+
+  // fixed wing only - open loop surface deflections and throttle
+  AircraftControls delta;
+
+  Dispersion sigma;
+};
+
+enum Column
+{
+  COL_RUN, COL_MASS, COL_DRAG, COL_WIND_N, COL_WIND_E, COL_WIND_D,
+  COL_PN, COL_PE, COL_PD, COL_SPEED, COL_MAX_TILT, COL_MIN_ALTITUDE,
+  COL_RMS_ALTITUDE_ERROR, COL_CRASHED, COL_TIME,
+  NUM_COLUMNS
+};
+
+const char* column_names[NUM_COLUMNS] = {
+  "run", "mass", "drag_scale", "wind_n", "wind_e", "wind_d",
+  "pn", "pe", "pd", "speed", "max_tilt", "min_altitude",
+  "rms_altitude_error", "crashed", "time"
+};
+
+// Everything a run needs to remember between steps
+struct Run
+{
+  std::mt19937 rng;
+  std::normal_distribution<double> normal; // per run, it caches every other draw from rng
+  double x[NUM_RIGID_BODY_STATES];
+  RigidBodyParams body;
+  double drag_scale;
+  double wind[3]; // NED, m/s
+  double max_tilt;
+  double min_altitude;
+  double sum_sq_altitude_error;
+  long steps;
+  bool crashed;
+
+  void init(const Scenario& s, const RigidBodyParams& nominal, int index)
+  {
+    std::seed_seq seq{s.seed, static_cast<unsigned>(index)};
+    rng.seed(seq);
+    normal.reset();
+
+    body = nominal;
+    body.mass *= std::max(1.0 + s.sigma.mass*normal(rng), 0.1);
+    drag_scale = std::max(1.0 + s.sigma.drag*normal(rng), 0.0);
+    for (int i = 0; i < 3; i++)
+      wind[i] = s.sigma.wind*normal(rng);
+
+    for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+      x[i] = 0.0;
+    x[STATE_PD] = -s.initial_altitude;
+    x[STATE_U] = s.initial_speed;
+
+    max_tilt = 0.0;
+    min_altitude = s.initial_altitude;
+    sum_sq_altitude_error = 0.0;
+    steps = 0;
+    crashed = false;
+  }
+
+  // Wind rotated into the body frame
+  void bodyWind(double& wu, double& wv, double& ww) const
+  {
+    double cphi = cos(x[STATE_PHI]), sphi = sin(x[STATE_PHI]);
+    double cth = cos(x[STATE_THETA]), sth = sin(x[STATE_THETA]);
+    double cpsi = cos(x[STATE_PSI]), spsi = sin(x[STATE_PSI]);
+    wu = cth*cpsi*wind[0] + cth*spsi*wind[1] - sth*wind[2];
+    wv = (sphi*sth*cpsi - cphi*spsi)*wind[0] + (sphi*sth*spsi + cphi*cpsi)*wind[1] + sphi*cth*wind[2];
+    ww = (cphi*sth*cpsi + sphi*spsi)*wind[0] + (cphi*sth*spsi - sphi*cpsi)*wind[1] + cphi*cth*wind[2];
+  }
+
+  void integrate(const double fm[6], double dt, double altitude_reference)
+  {
+    rigidBodyStep(body, x, fm, dt);
+    steps++;
+
+    double altitude = -x[STATE_PD];
+    double tilt = acos(std::min(1.0, cos(x[STATE_PHI])*cos(x[STATE_THETA])));
+    max_tilt = std::max(max_tilt, tilt);
+    min_altitude = std::min(min_altitude, altitude);
+    sum_sq_altitude_error += (altitude - altitude_reference)*(altitude - altitude_reference);
+
+    bool finite = true;
+    for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+      finite = finite && std::isfinite(x[i]);
+    crashed = !finite || altitude < 0.0;
+  }
+
+  void record(ColumnarTable& table, int index, double dt) const
+  {
+    table.at(index, COL_RUN) = index;
+    table.at(index, COL_MASS) = body.mass;
+    table.at(index, COL_DRAG) = drag_scale;
+    table.at(index, COL_WIND_N) = wind[0];
+    table.at(index, COL_WIND_E) = wind[1];
+    table.at(index, COL_WIND_D) = wind[2];
+    table.at(index, COL_PN) = x[STATE_PN];
+    table.at(index, COL_PE) = x[STATE_PE];
+    table.at(index, COL_PD) = x[STATE_PD];
+    table.at(index, COL_SPEED) = sqrt(x[STATE_U]*x[STATE_U] + x[STATE_V]*x[STATE_V] + x[STATE_W]*x[STATE_W]);
+    table.at(index, COL_MAX_TILT) = max_tilt;
+    table.at(index, COL_MIN_ALTITUDE) = min_altitude;
+    table.at(index, COL_RMS_ALTITUDE_ERROR) = steps > 0 ? sqrt(sum_sq_altitude_error/steps) : 0.0;
+    table.at(index, COL_CRASHED) = crashed ? 1.0 : 0.0;
+    table.at(index, COL_TIME) = steps*dt;
+  }
+};
+
+
+// Fly runs [first, first + count) together through one batched multirotor model
+void runMultirotorBlock(const Scenario& s, const MultirotorParams& nominal, int first, int count,
+                        ColumnarTable& table)
+{
+  std::vector<Run> runs(count);
+  MultirotorDynamics dynamics(count);
+  for (int i = 0; i < count; i++)
+  {
+    RigidBodyParams body = s.body;
+    body.mass = nominal.mass;
+    runs[i].init(s, body, first + i);
+
+    // the controller keeps the nominal mass for its hover offset, only the
+    // drag it is fighting against changes
+    MultirotorParams params = nominal;
+    params.linear_mu *= runs[i].drag_scale;
+    params.angular_mu *= runs[i].drag_scale;
+    dynamics.setParams(i, params);
+
+    dynamics.command.mode[i] = s.mode;
+    dynamics.command.x[i] = s.command[0];
+    dynamics.command.y[i] = s.command[1];
+    dynamics.command.z[i] = s.command[2];
+    dynamics.command.F[i] = s.command[3];
+  }
+
+  double altitude_reference = s.mode == MODE_ANGLE_ALTITUDE ? s.command[3] : s.initial_altitude;
+  long num_steps = lround(s.duration/s.dt);
+  for (long k = 0; k < num_steps; k++)
+  {
+    // Feedback the controller sees, with sensor noise on top of the truth
+    for (int i = 0; i < count; i++)
+    {
+      Run& run = runs[i];
+      const double* x = run.x;
+      dynamics.state.pd[i] = x[STATE_PD] + s.sigma.altitude_noise*run.normal(run.rng);
+      dynamics.state.phi[i] = x[STATE_PHI] + s.sigma.attitude_noise*run.normal(run.rng);
+      dynamics.state.theta[i] = x[STATE_THETA] + s.sigma.attitude_noise*run.normal(run.rng);
+      dynamics.state.u[i] = x[STATE_U];
+      dynamics.state.v[i] = x[STATE_V];
+      dynamics.state.w[i] = x[STATE_W];
+      dynamics.state.p[i] = x[STATE_P] + s.sigma.gyro_noise*run.normal(run.rng);
+      dynamics.state.q[i] = x[STATE_Q] + s.sigma.gyro_noise*run.normal(run.rng);
+      dynamics.state.r[i] = x[STATE_R] + s.sigma.gyro_noise*run.normal(run.rng);
+      run.bodyWind(dynamics.state.wind_u[i], dynamics.state.wind_v[i], dynamics.state.wind_w[i]);
+    }
+
+    dynamics.step(s.dt);
+
+    bool all_crashed = true;
+    for (int i = 0; i < count; i++)
+    {
+      if (runs[i].crashed)
+        continue;
+      double fm[6] = {dynamics.forces.Fx[i], dynamics.forces.Fy[i], dynamics.forces.Fz[i],
+                      dynamics.forces.l[i], dynamics.forces.m[i], dynamics.forces.n[i]};
+      runs[i].integrate(fm, s.dt, altitude_reference);
+      all_crashed = all_crashed && runs[i].crashed;
+    }
+    if (all_crashed)
+      break;
+  }
+
+  for (int i = 0; i < count; i++)
+    runs[i].record(table, first + i, s.dt);
+}
+
+
+// Fly runs [first, first + count) open loop with the fixed-wing model
+void runAircraftBlock(const Scenario& s, const AircraftParams& nominal, int first, int count,
+                      ColumnarTable& table)
+{
+  RigidBodyParams body;
+  body.mass = nominal.mass;
+  body.Jx = nominal.Jx;
+  body.Jy = nominal.Jy;
+  body.Jz = nominal.Jz;
+  body.Jxz = nominal.Jxz;
+
+  long num_steps = lround(s.duration/s.dt);
+  for (int i = 0; i < count; i++)
+  {
+    Run run;
+    run.init(s, body, first + i);
+
+    AircraftParams params = nominal;
+    params.CD.O *= run.drag_scale;
+    params.CD.p *= run.drag_scale;
+    AircraftAeroTable aero_table;
+    aero_table.build(params, 0.001);
+
+    AircraftInput in;
+    in.delta = s.delta;
+    AircraftForces out;
+    for (long k = 0; k < num_steps && !run.crashed; k++)
+    {
+      in.u = run.x[STATE_U];
+      in.v = run.x[STATE_V];
+      in.w = run.x[STATE_W];
+      in.p = run.x[STATE_P];
+      in.q = run.x[STATE_Q];
+      in.r = run.x[STATE_R];
+      run.bodyWind(in.wind_u, in.wind_v, in.wind_w);
+      if (!computeAircraftForces(params, in, out, &aero_table))
+      {
+        run.crashed = true;
+        break;
+      }
+      double fm[6] = {out.Fx, out.Fy, out.Fz, out.l, out.m, out.n};
+      run.integrate(fm, s.dt, s.initial_altitude);
+    }
+    run.record(table, first + i, s.dt);
+  }
+}
+
+
+// Optional nested maps in the scenario file, missing ones read as empty
+YAML::Node section(const YAML::Node& node, const char* key)
+{
+  const YAML::Node value = node[key];
+  return value ? value : YAML::Node(YAML::NodeType::Map);
+}
+
+
+Scenario loadScenario(const YAML::Node& node)
+{
+  YamlParams p(node);
+  Scenario s;
+  s.vehicle = p.param<std::string>("vehicle", "multirotor");
+  s.runs = p.param<int>("runs", 1000);
+  s.duration = p.param<double>("duration", 10.0);
+  s.dt = p.param<double>("dt", 0.001);
+  s.seed = p.param<unsigned>("seed", 0);
+  s.threads = p.param<unsigned>("threads", 0);
+  s.batch = std::max(p.param<int>("batch", 64), 1);
+
+  s.initial_altitude = p.param<double>("initial_altitude", 10.0);
+  s.initial_speed = p.param<double>("initial_speed", 0.0);
+
+  s.body.Jx = p.param<double>("Jx", s.body.Jx);
+  s.body.Jy = p.param<double>("Jy", s.body.Jy);
+  s.body.Jz = p.param<double>("Jz", s.body.Jz);
+  s.body.Jxz = p.param<double>("Jxz", s.body.Jxz);
+
+  YamlParams command(section(node, "command"));
+  s.mode = command.param<int>("mode", MODE_ANGLE_ALTITUDE);
+  s.command[0] = command.param<double>("x", 0.0);
+  s.command[1] = command.param<double>("y", 0.0);
+  s.command[2] = command.param<double>("z", 0.0);
+  s.command[3] = command.param<double>("F", s.initial_altitude);
+
+  YamlParams delta(section(node, "delta"));
+  s.delta.e = delta.param<double>("e", 0.0);
+  s.delta.a = delta.param<double>("a", 0.0);
+  s.delta.r = delta.param<double>("r", 0.0);
+  s.delta.t = delta.param<double>("t", 0.0);
+
+  YamlParams sigma(section(node, "dispersion"));
+  s.sigma.mass = sigma.param<double>("mass", 0.0);
+  s.sigma.drag = sigma.param<double>("drag", 0.0);
+  s.sigma.wind = sigma.param<double>("wind", 0.0);
+  s.sigma.gyro_noise = sigma.param<double>("gyro_noise", 0.0);
+  s.sigma.attitude_noise = sigma.param<double>("attitude_noise", 0.0);
+  s.sigma.altitude_noise = sigma.param<double>("altitude_noise", 0.0);
+  return s;
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc != 4)
+  {
+    fprintf(stderr, "usage: %s <agent.yaml> <scenario.yaml> <output file>\n", argv[0]);
+    return 1;
+  }
+
+  YAML::Node agent_yaml, scenario_yaml;
+  try
+  {
+    agent_yaml = YAML::LoadFile(argv[1]);
+    scenario_yaml = YAML::LoadFile(argv[2]);
+  }
+  catch (const YAML::Exception& e)
+  {
+    fprintf(stderr, "[fcu_sim_batch] could not load yaml: %s\n", e.what());
+    return 1;
+  }
+
+  Scenario scenario;
+  MultirotorParams multirotor;
+  AircraftParams aircraft;
+  try
+  {
+    scenario = loadScenario(scenario_yaml);
+    YamlParams agent(agent_yaml);
+    multirotor.load(agent);
+    aircraft.load(agent);
+  }
+  catch (const YAML::Exception& e)
+  {
+    fprintf(stderr, "[fcu_sim_batch] bad parameter: %s\n", e.what());
+    return 1;
+  }
+
+  bool is_multirotor = scenario.vehicle == "multirotor";
+  if (!is_multirotor && scenario.vehicle != "fixedwing")
+  {
+    fprintf(stderr, "[fcu_sim_batch] unknown vehicle \"%s\", expected multirotor or fixedwing\n",
+            scenario.vehicle.c_str());
+    return 1;
+  }
+  if (scenario.runs <= 0 || scenario.dt <= 0.0 || scenario.duration <= 0.0)
+  {
+    fprintf(stderr, "[fcu_sim_batch] runs, dt and duration must be positive\n");
+    return 1;
+  }
+
+  ColumnarTable table(std::vector<std::string>(column_names, column_names + NUM_COLUMNS), scenario.runs);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    WorkStealingPool pool(scenario.threads);
+    for (int first = 0; first < scenario.runs; first += scenario.batch)
+    {
+      int count = std::min(scenario.batch, scenario.runs - first);
+      if (is_multirotor)
+        pool.submit([&, first, count]{ runMultirotorBlock(scenario, multirotor, first, count, table); });
+      else
+        pool.submit([&, first, count]{ runAircraftBlock(scenario, aircraft, first, count, table); });
+    }
+    pool.wait();
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (!table.write(argv[3]))
+  {
+    fprintf(stderr, "[fcu_sim_batch] could not write %s\n", argv[3]);
+    return 1;
+  }
+
+  int crashed = 0;
+  double sim_time = 0.0;
+  for (int i = 0; i < scenario.runs; i++)
+  {
+    crashed += table.at(i, COL_CRASHED) > 0.5;
+    sim_time += table.at(i, COL_TIME);
+  }
+  printf("[fcu_sim_batch] %d runs (%d crashed) in %.2f s wall, %.0fx real time\n",
+         scenario.runs, crashed, wall, sim_time/wall);
+  return 0;
+}
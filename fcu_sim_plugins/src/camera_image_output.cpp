@@ -0,0 +1,141 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/camera_image_output.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "fcu_sim_plugins/common.h"
+
+namespace gazebo {
+
+CameraImageOutput::CameraImageOutput() :
+  initialized_(false),
+  pooled_(true),
+  shm_slots_(0),
+  encode_quality_(-1),
+  encode_threads_(1),
+  encode_queue_(2) {}
+
+CameraImageOutput::~CameraImageOutput() {
+  encoder_.stop();
+}
+
+void CameraImageOutput::load(sdf::ElementPtr sdf) {
+  int pool_size;
+  getSdfParam<bool>(sdf, "pooledImages", pooled_, true);
+  getSdfParam<int>(sdf, "imagePoolSize", pool_size, 4);
+  getSdfParam<int>(sdf, "shmSlots", shm_slots_, 0);
+  getSdfParam<std::string>(sdf, "encodeFormat", encode_format_, "");
+  getSdfParam<int>(sdf, "encodeQuality", encode_quality_, -1);
+  getSdfParam<int>(sdf, "encodeThreads", encode_threads_, 1);
+  getSdfParam<int>(sdf, "encodeQueue", encode_queue_, 2);
+  getSdfParam<std::string>(sdf, "encodedTopic", encoded_topic_, "");
+  image_pool_ = MessagePool<sensor_msgs::Image>(pool_size > 0 ? pool_size : 1);
+}
+
+void CameraImageOutput::init(ros::NodeHandle* nh, const std::string& image_topic, const std::string& shm_name,
+                             size_t frame_size) {
+  initialized_ = true;
+
+  if (!encode_format_.empty()) {
+    std::string topic = encoded_topic_.empty() ? image_topic + "/encoded" : encoded_topic_;
+    encoded_pub_ = nh->advertise<sensor_msgs::CompressedImage>(topic, 1);
+    ros::Publisher* pub = &encoded_pub_;
+    std::string error;
+    if (!encoder_.start(encode_format_, encode_quality_, encode_threads_, encode_queue_,
+                        [pub](const sensor_msgs::CompressedImagePtr& msg) { pub->publish(msg); }, &error))
+      gzerr << "[CameraImageOutput] " << error << ", not encoding images\n";
+  }
+
+  if (shm_slots_ <= 0)
+    return;
+
+  // Segment names can't hold slashes past the first
+  std::string name = "/" + shm_name;
+  for (size_t i = 1; i < name.size(); i++)
+    if (name[i] == '/')
+      name[i] = '_';
+
+  std::string error;
+  if (!shm_writer_.open(name, shm_slots_, frame_size, &error)) {
+    gzerr << "[CameraImageOutput] " << error << ", not publishing through shared memory\n";
+    return;
+  }
+  shm_pub_ = nh->advertise<fcu_sim::ShmImage>(image_topic + "/shm", 1);
+  gzmsg << "[CameraImageOutput] " << shm_slots_ << " frames of shared memory in " << name << "\n";
+}
+
+void CameraImageOutput::publish(const unsigned char* src, const fcu_sim::ShmFrameInfo& image, const std::string& frame_id,
+                                image_transport::Publisher& raw_pub, int raw_subscribers) {
+  if (shm_writer_.isOpen() && shm_pub_.getNumSubscribers() > 0) {
+    uint64_t sequence = shm_writer_.write(image, src);
+    if (sequence != 0) {
+      fcu_sim::ShmImagePtr descriptor = shm_pool_.acquire();
+      descriptor->header.frame_id = frame_id;
+      descriptor->header.stamp.sec = image.sec;
+      descriptor->header.stamp.nsec = image.nsec;
+      descriptor->segment = shm_writer_.name();
+      descriptor->sequence = sequence;
+      descriptor->slots = shm_writer_.slots();
+      descriptor->height = image.height;
+      descriptor->width = image.width;
+      descriptor->encoding = image.encoding;
+      descriptor->step = image.step;
+      shm_pub_.publish(descriptor);
+    }
+  }
+
+  bool raw = pooled_ && raw_subscribers > 0;
+  bool encoded = encoder_.running() && encoded_pub_.getNumSubscribers() > 0;
+  if (!raw && !encoded)
+    return;
+
+  // One copy out of the render buffer; publishing the pointer lets roscpp skip
+  // serializing it for subscribers in this process, and the encoder holds the
+  // same message until it is done with it
+  sensor_msgs::ImagePtr msg = image_pool_.acquire();
+  msg->header.frame_id = frame_id;
+  msg->header.stamp.sec = image.sec;
+  msg->header.stamp.nsec = image.nsec;
+  msg->height = image.height;
+  msg->width = image.width;
+  msg->encoding = image.encoding;
+  msg->is_bigendian = 0;
+  msg->step = image.step;
+  msg->data.resize(static_cast<size_t>(image.step)*image.height);
+  std::memcpy(msg->data.data(), src, msg->data.size());
+  if (raw)
+    raw_pub.publish(msg);
+  if (encoded)
+    encoder_.submit(msg);
+}
+
+std::string CameraImageOutput::stats() const {
+  std::ostringstream out;
+  out << image_pool_.acquired() << " images published from the pool, " << image_pool_.allocations() << " allocated";
+  if (shm_writer_.isOpen())
+    out << ", " << shm_pool_.acquired() << " through shared memory";
+  if (encoder_.running()) {
+    fcu_sim::ImageEncoder::Stats s = encoder_.stats();
+    out << ", " << s.encoded << " of " << s.submitted << " encoded (" << s.dropped_queued << " dropped waiting, "
+        << s.dropped_stale << " stale, " << s.failed << " failed)";
+  }
+  return out.str();
+}
+
+}
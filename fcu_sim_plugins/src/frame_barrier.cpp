@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/frame_barrier.h"
+
+#include <chrono>
+
+namespace fcu_sim
+{
+
+FrameBarrier::FrameBarrier(int depth) :
+  depth_(depth < 0 ? 0 : depth),
+  last_rendered_time_(-1.0)
+{
+  stats_.requested = 0;
+  stats_.rendered = 0;
+  stats_.waits = 0;
+  stats_.timeouts = 0;
+  stats_.dropped = 0;
+  stats_.max_lag = 0;
+}
+
+
+void FrameBarrier::setDepth(int depth)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  depth_ = depth < 0 ? 0 : depth;
+}
+
+
+void FrameBarrier::reset()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.rendered = stats_.requested;
+    last_rendered_time_ = -1.0;
+  }
+  frame_done_.notify_all();
+}
+
+
+bool FrameBarrier::request(double timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats_.requested++;
+  if (lag() > stats_.max_lag)
+    stats_.max_lag = lag();
+  if (lag() <= depth_)
+    return true;
+
+  stats_.waits++;
+  std::chrono::duration<double> limit(timeout);
+  if (frame_done_.wait_for(lock, limit, [this] { return lag() <= depth_; }))
+    return true;
+
+  // Renderer stalled, write off what it still owes rather than time out on every frame after this
+  stats_.timeouts++;
+  stats_.dropped += lag();
+  stats_.rendered = stats_.requested;
+  return false;
+}
+
+
+void FrameBarrier::rendered(double t)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (t <= last_rendered_time_)
+      return;
+    last_rendered_time_ = t;
+
+    // The renderer can see a new scene before the physics thread gets round
+    // to requesting it, so allow one frame of credit but no more
+    if (stats_.rendered > stats_.requested)
+      return;
+    stats_.rendered++;
+  }
+  frame_done_.notify_one();
+}
+
+
+FrameBarrier::Stats FrameBarrier::stats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}
@@ -21,7 +21,10 @@ namespace gazebo {
 GimbalPlugin::GimbalPlugin() : ModelPlugin() {}
 
 GimbalPlugin::~GimbalPlugin() {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
+  if (pose_rate_.published() > 0)
+    gzmsg << "[GimbalPlugin] " << namespace_ << "/gimbal: published " << pose_rate_.published()
+          << " of " << pose_rate_.published() + pose_rate_.decimated() << " steps\n";
   if (nh_) {
     nh_->shutdown();
     delete nh_;
@@ -91,6 +94,11 @@ void GimbalPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
 
   getSdfParam<bool>(_sdf, "autoStabilize", auto_stabilize_, false);
 
+  // The joints are driven every step, the angles only go out at this rate (0 for every step)
+  double publish_rate;
+  getSdfParam<double>(_sdf, "publishRate", publish_rate, 50.0);
+  pose_rate_.setRate(publish_rate);
+
   // To perform auto stabilization, we need a pointer to the main link
   if(auto_stabilize_)
   {
@@ -102,10 +110,12 @@ void GimbalPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
     link_ = model_->GetLink(link_name);
     if (link_ == NULL)
       gzthrow("[ROSflight_SIL] Couldn't find specified link \"" << link_name << "\".");
+    state_ = ModelState::Get(link_);
   }
 
   // Connect Gazebo Update
-  updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&GimbalPlugin::OnUpdate, this, _1));
+  updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/gimbal", 0.0,
+                                                            boost::bind(&GimbalPlugin::OnUpdate, this, _1));
 
   // Connect ROS
   nh_ = new ros::NodeHandle();
@@ -166,11 +176,9 @@ void GimbalPlugin::OnUpdate(const common::UpdateInfo & _info)
   // Perform Control if auto stabilize flag is on
   if(auto_stabilize_)
   {
-    math::Pose W_pose_W_C = link_->GetWorldCoGPose();
-    math::Vector3 euler_angles = W_pose_W_C.rot.GetAsEuler();
-    double phi = euler_angles.x;
-    double theta = -euler_angles.y;
-    double psi = -euler_angles.z;
+    const ModelState::NEDState& x = state_->Snapshot();
+    double phi = x.phi;
+    double theta = x.theta;
     yaw_desired_ = 0;
     pitch_desired_ = theta;
     roll_desired_ = -phi;
@@ -193,6 +201,8 @@ void GimbalPlugin::OnUpdate(const common::UpdateInfo & _info)
 #endif
 
   // Publish ROS message of actual angles
+  if (!pose_rate_.due(_info.simTime.Double()))
+    return;
   geometry_msgs::Vector3Stamped angles_msg;
   angles_msg.header.stamp.sec = world_->GetSimTime().sec;
   angles_msg.header.stamp.nsec = world_->GetSimTime().nsec;
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/image_encoder.h"
+
+#include <algorithm>
+
+#include <boost/make_shared.hpp>
+#include <cv_bridge/cv_bridge.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <sensor_msgs/image_encodings.h>
+
+namespace fcu_sim
+{
+
+ImageEncoder::ImageEncoder() :
+  queue_size_(1),
+  stopping_(false),
+  next_frame_(0),
+  last_output_(0)
+{
+  stats_.submitted = 0;
+  stats_.encoded = 0;
+  stats_.dropped_queued = 0;
+  stats_.dropped_stale = 0;
+  stats_.failed = 0;
+}
+
+
+ImageEncoder::~ImageEncoder()
+{
+  stop();
+}
+
+
+bool ImageEncoder::start(const std::string& format, int quality, int threads, int queue_size,
+                         const Callback& done, std::string* error)
+{
+  stop();
+  if (format == "jpeg" || format == "jpg")
+  {
+    format_ = "jpeg";
+    params_.assign(1, cv::IMWRITE_JPEG_QUALITY);
+    params_.push_back(quality < 0 ? 90 : std::min(std::max(quality, 1), 100));
+  }
+  else if (format == "png")
+  {
+    format_ = "png";
+    params_.assign(1, cv::IMWRITE_PNG_COMPRESSION);
+    params_.push_back(quality < 0 ? 3 : std::min(quality, 9));
+  }
+  else
+  {
+    *error = "unknown image format \"" + format + "\", use jpeg or png";
+    return false;
+  }
+
+  done_ = done;
+  queue_size_ = queue_size > 0 ? queue_size : 1;
+  stopping_ = false;
+  for (int i = 0; i < std::max(threads, 1); i++)
+    workers_.push_back(std::thread(&ImageEncoder::work, this));
+  return true;
+}
+
+
+void ImageEncoder::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+  }
+  queued_.notify_all();
+  for (size_t i = 0; i < workers_.size(); i++)
+    workers_[i].join();
+  workers_.clear();
+}
+
+
+void ImageEncoder::submit(const sensor_msgs::ImageConstPtr& image)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.submitted++;
+    if (queue_.size() >= queue_size_)
+    {
+      queue_.pop_front();
+      stats_.dropped_queued++;
+    }
+    queue_.push_back(std::make_pair(++next_frame_, image));
+  }
+  queued_.notify_one();
+}
+
+
+ImageEncoder::Stats ImageEncoder::stats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+void ImageEncoder::work()
+{
+  for (;;)
+  {
+    std::pair<uint64_t, sensor_msgs::ImageConstPtr> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (stopping_)
+        return;
+      job = queue_.front();
+      queue_.pop_front();
+    }
+
+    sensor_msgs::CompressedImagePtr out = boost::make_shared<sensor_msgs::CompressedImage>();
+    bool encoded = encode(*job.second, out.get());
+    job.second.reset(); // back to the camera's pool as soon as possible
+
+    bool stale = false;
+    if (encoded)
+    {
+      std::lock_guard<std::mutex> lock(output_mutex_);
+      stale = job.first < last_output_;
+      if (!stale)
+      {
+        last_output_ = job.first;
+        done_(out);
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!encoded)
+      stats_.failed++;
+    else if (stale)
+      stats_.dropped_stale++;
+    else
+      stats_.encoded++;
+  }
+}
+
+
+bool ImageEncoder::encode(const sensor_msgs::Image& image, sensor_msgs::CompressedImage* out) const
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  // imencode wants BGR or mono; JPEG only takes 8 bits a channel, PNG also 16
+  std::string target;
+  if (enc::isColor(image.encoding))
+    target = enc::bitDepth(image.encoding) == 16 && format_ == "png" ? enc::BGR16 : enc::BGR8;
+  else if (enc::isMono(image.encoding))
+    target = enc::bitDepth(image.encoding) == 16 && format_ == "png" ? enc::MONO16 : enc::MONO8;
+  else
+    return false;
+
+  try
+  {
+    // Shares the image's buffer when no conversion is needed
+    cv_bridge::CvImageConstPtr cv_image = cv_bridge::toCvShare(image, sensor_msgs::ImageConstPtr(), target);
+    if (!cv::imencode("." + format_, cv_image->image, out->data, params_))
+      return false;
+  }
+  catch (const std::exception&)
+  {
+    return false;
+  }
+
+  out->header = image.header;
+  out->format = image.encoding + "; " + format_ + " compressed " + target;
+  return true;
+}
+
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2015 Fadri Furrer, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Michael Burri, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Mina Kamel, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Janosch Nikolic, ASL, ETH Zurich, Switzerland
+ * Copyright 2015 Markus Achtelik, ASL, ETH Zurich, Switzerland
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/imu_model.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <gazebo/math/Rand.hh>
+
+namespace gazebo {
+
+ImuModel::ImuModel() : perfect_imu_(false), noise_dt_(-1.0), velocity_prev_W_(0, 0, 0) {}
+
+void ImuModel::Load(sdf::ElementPtr _sdf, physics::LinkPtr link) {
+  link_ = link;
+
+  getSdfParam<double>(_sdf, "updateRate", imu_parameters_.update_rate_, 1000.0);
+  getSdfParam<double>(_sdf, "gyroscopeNoiseDensity",
+                      imu_parameters_.gyroscope_noise_density,
+                      2.0 * 35.0 / 3600.0 / 180.0 * M_PI);
+  getSdfParam<double>(_sdf, "gyroscopeBiasRandomWalk",
+                      imu_parameters_.gyroscope_random_walk,
+                      2.0 * 4.0 / 3600.0 / 180.0 * M_PI);
+  getSdfParam<double>(_sdf, "gyroscopeBiasCorrelationTime",
+                      imu_parameters_.gyroscope_bias_correlation_time,
+                      1.0e+3);
+  assert(imu_parameters_.gyroscope_bias_correlation_time > 0.0);
+  getSdfParam<double>(_sdf, "gyroscopeTurnOnBiasSigma",
+                      imu_parameters_.gyroscope_turn_on_bias_sigma,
+                      0.5 / 180.0 * M_PI);
+  getSdfParam<double>(_sdf, "accelerometerNoiseDensity",
+                      imu_parameters_.accelerometer_noise_density,
+                      2.0 * 2.0e-3);
+  getSdfParam<double>(_sdf, "accelerometerRandomWalk",
+                      imu_parameters_.accelerometer_random_walk,
+                      2.0 * 3.0e-3);
+  getSdfParam<double>(_sdf, "accelerometerBiasCorrelationTime",
+                      imu_parameters_.accelerometer_bias_correlation_time,
+                      300.0);
+  getSdfParam<bool>(_sdf, "perfectIMU", perfect_imu_, false);
+  assert(imu_parameters_.accelerometer_bias_correlation_time > 0.0);
+  getSdfParam<double>(_sdf, "accelerometerTurnOnBiasSigma",
+                      imu_parameters_.accelerometer_turn_on_bias_sigma,
+                      20.0e-3 * 9.8);
+
+  physics::WorldPtr world = link_->GetWorld();
+  gravity_W_ = world->GetPhysicsEngine()->GetGravity();
+  imu_parameters_.gravity_magnitude = gravity_W_.GetLength();
+
+  // Without a seed, follow the world seed (gzserver --seed) so a run can still be reproduced
+  unsigned int seed;
+  getSdfParam<unsigned int>(_sdf, "seed", seed, math::Rand::GetSeed());
+  random_.seed(seed, link_->GetScopedName() + "/imu");
+
+  gyroscope_bias_process_.setParameters(imu_parameters_.gyroscope_bias_correlation_time,
+                                        imu_parameters_.gyroscope_random_walk);
+  accelerometer_bias_process_.setParameters(imu_parameters_.accelerometer_bias_correlation_time,
+                                            imu_parameters_.accelerometer_random_walk);
+
+  double sigma_bon_g = imu_parameters_.gyroscope_turn_on_bias_sigma;
+  double sigma_bon_a = imu_parameters_.accelerometer_turn_on_bias_sigma;
+  for (int i = 0; i < 3; ++i) {
+      gyroscope_turn_on_bias_[i] = sigma_bon_g * random_.normal();
+      accelerometer_turn_on_bias_[i] = sigma_bon_a * random_.normal();
+  }
+
+  // TODO(nikolicj) incorporate steady-state covariance of bias process
+  gyroscope_bias_.setZero();
+  accelerometer_bias_.setZero();
+}
+
+void ImuModel::Sample(double dt,
+                      Eigen::Vector3d* linear_acceleration,
+                      Eigen::Vector3d* angular_velocity,
+                      math::Quaternion* orientation) {
+  math::Pose T_W_I = link_->GetWorldPose(); //TODO(burrimi): Check tf.
+  math::Quaternion C_W_I = T_W_I.rot;
+
+  #if GAZEBO_MAJOR_VERSION < 5
+    math::Vector3 velocity_current_W = link_->GetWorldLinearVel();
+    // link_->GetRelativeLinearAccel() does not work sometimes with old gazebo versions.
+    // This issue is solved in gazebo 5.
+    math::Vector3 acceleration = (velocity_current_W - velocity_prev_W_) / dt;
+    math::Vector3 acceleration_I = C_W_I.RotateVectorReverse(acceleration - gravity_W_);
+    velocity_prev_W_ = velocity_current_W;
+  #else
+    math::Vector3 acceleration_I = link_->GetRelativeLinearAccel() - C_W_I.RotateVectorReverse(gravity_W_);
+  #endif
+    math::Vector3 angular_vel_I = link_->GetRelativeAngularVel();
+
+  Eigen::Vector3d linear_acceleration_I(acceleration_I.x,
+                                        acceleration_I.y,
+                                        acceleration_I.z);
+  Eigen::Vector3d angular_velocity_I(angular_vel_I.x,
+                                     angular_vel_I.y,
+                                     angular_vel_I.z);
+
+  if(!perfect_imu_){
+    addNoise(&linear_acceleration_I, &angular_velocity_I, dt);
+  }
+
+  (*linear_acceleration) << linear_acceleration_I[0],
+                            -linear_acceleration_I[1],
+                            -linear_acceleration_I[2];
+  (*angular_velocity) << angular_velocity_I[0],
+                         -angular_velocity_I[1],
+                         -angular_velocity_I[2];
+  if (orientation != NULL)
+    *orientation = C_W_I;
+}
+
+void ImuModel::Skip(double dt) {
+  #if GAZEBO_MAJOR_VERSION < 5
+    // The previous velocity is from before the gap, differencing it would give a spike
+    velocity_prev_W_ = link_->GetWorldLinearVel();
+  #endif
+
+  if (perfect_imu_ || dt <= 0.0)
+    return;
+
+  double n[6];
+  random_.normals(n, 6);
+  for (int i = 0; i < 3; ++i) {
+    gyroscope_bias_[i] = gyroscope_bias_process_.skip(gyroscope_bias_[i], dt, n[i]);
+    accelerometer_bias_[i] = accelerometer_bias_process_.skip(accelerometer_bias_[i], dt, n[3 + i]);
+  }
+}
+
+/// \brief This function adds noise to acceleration and angular rates for
+///        accelerometer and gyroscope measurement simulation.
+void ImuModel::addNoise(Eigen::Vector3d* linear_acceleration,
+                        Eigen::Vector3d* angular_velocity,
+                        const double dt) {
+  assert(linear_acceleration != nullptr);
+  assert(angular_velocity != nullptr);
+
+  if(dt <= 0.0)
+  {
+    return;
+  }
+
+  // Discrete-time standard deviation equivalent to an "integrating" sampler
+  // with integration time dt.
+  if (dt != noise_dt_) {
+    noise_dt_ = dt;
+    gyroscope_sigma_d_ = 1 / sqrt(dt) * imu_parameters_.gyroscope_noise_density;
+    accelerometer_sigma_d_ = 1 / sqrt(dt) * imu_parameters_.accelerometer_noise_density;
+  }
+
+  // Bias and white noise for each axis of both sensors in one go
+  double n[12];
+  random_.normals(n, 12);
+
+  // Simulate gyroscope noise processes and add them to the true angular rate.
+  for (int i = 0; i < 3; ++i) {
+    gyroscope_bias_[i] = gyroscope_bias_process_.step(gyroscope_bias_[i], dt, n[2*i]);
+    (*angular_velocity)[i] = (*angular_velocity)[i] +
+        gyroscope_bias_[i] +
+        gyroscope_sigma_d_ * n[2*i + 1] +
+        gyroscope_turn_on_bias_[i];
+  }
+
+  // Simulate accelerometer noise processes and add them to the true linear
+  // acceleration.
+  for (int i = 0; i < 3; ++i) {
+    accelerometer_bias_[i] = accelerometer_bias_process_.step(accelerometer_bias_[i], dt, n[6 + 2*i]);
+    (*linear_acceleration)[i] = (*linear_acceleration)[i] +
+        accelerometer_bias_[i] +
+        accelerometer_sigma_d_ * n[6 + 2*i + 1] +
+        accelerometer_turn_on_bias_[i];
+  }
+
+}
+
+}
@@ -25,10 +25,10 @@ using namespace std;
 
 namespace gazebo {
 
-ImuPlugin::ImuPlugin() : ModelPlugin(),node_handle_(0),velocity_prev_W_(0, 0, 0) {}
+ImuPlugin::ImuPlugin() : LazySensorPlugin(),node_handle_(0),batch_size_(1),batch_count_(0) {}
 
 ImuPlugin::~ImuPlugin() {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
   if (node_handle_) {
     node_handle_->shutdown();
     delete node_handle_;
@@ -61,46 +61,41 @@ void ImuPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
 
   frame_id_ = link_name_;
 
-  getSdfParam<double>(_sdf, "updateRate", imu_parameters_.update_rate_, 1000.0);
   getSdfParam<std::string>(_sdf, "imuTopic", imu_topic_,
                            "imu/data");
-  getSdfParam<double>(_sdf, "gyroscopeNoiseDensity",
-                      imu_parameters_.gyroscope_noise_density,
-                      2.0 * 35.0 / 3600.0 / 180.0 * M_PI);
-  getSdfParam<double>(_sdf, "gyroscopeBiasRandomWalk",
-                      imu_parameters_.gyroscope_random_walk,
-                      2.0 * 4.0 / 3600.0 / 180.0 * M_PI);
-  getSdfParam<double>(_sdf, "gyroscopeBiasCorrelationTime",
-                      imu_parameters_.gyroscope_bias_correlation_time,
-                      1.0e+3);
-  assert(imu_parameters_.gyroscope_bias_correlation_time > 0.0);
-  getSdfParam<double>(_sdf, "gyroscopeTurnOnBiasSigma",
-                      imu_parameters_.gyroscope_turn_on_bias_sigma,
-                      0.5 / 180.0 * M_PI);
-  getSdfParam<double>(_sdf, "accelerometerNoiseDensity",
-                      imu_parameters_.accelerometer_noise_density,
-                      2.0 * 2.0e-3);
-  getSdfParam<double>(_sdf, "accelerometerRandomWalk",
-                      imu_parameters_.accelerometer_random_walk,
-                      2.0 * 3.0e-3);
-  getSdfParam<double>(_sdf, "accelerometerBiasCorrelationTime",
-                      imu_parameters_.accelerometer_bias_correlation_time,
-                      300.0);
-  getSdfParam<bool>(_sdf, "perfectIMU", perfect_imu_, false);
-  assert(imu_parameters_.accelerometer_bias_correlation_time > 0.0);
-  getSdfParam<double>(_sdf, "accelerometerTurnOnBiasSigma",
-                      imu_parameters_.accelerometer_turn_on_bias_sigma,
-                      20.0e-3 * 9.8);
+  getSdfParam<std::string>(_sdf, "batchTopic", batch_topic_,
+                           "imu/batch");
+  getSdfParam<int>(_sdf, "batchSize", batch_size_, 1);
+  if (batch_size_ < 1)
+  {
+    gzerr << "[gazebo_imu_plugin] batchSize must be at least 1, using 1.\n";
+    batch_size_ = 1;
+  }
+  imu_.Load(_sdf, link_);
+  const ImuParameters& imu_parameters = imu_.parameters();
 
   last_time_ = world_->GetSimTime();
 
-  // Listen to the update event. This event is broadcast every
-  // simulation iteration.
-  this->updateConnection_ =
-      event::Events::ConnectWorldUpdateBegin(
-          boost::bind(&ImuPlugin::OnUpdate, this, _1));
+  // Ask the world's sensor scheduler to call us at the IMU rate
+  this->updateConnection_ = SensorScheduler::Get(world_).Register(
+      namespace_ + "/" + imu_topic_, imu_parameters.update_rate_,
+      boost::bind(&ImuPlugin::OnUpdate, this, _1));
 
-  imu_pub_ = node_handle_->advertise<sensor_msgs::Imu>(imu_topic_, 10);
+  if (batch_size_ > 1)
+  {
+    batch_pub_ = node_handle_->advertise<fcu_sim::ImuBatch>(batch_topic_, 10);
+    batch_message_.header.frame_id = link_name_;
+    batch_message_.stamp.resize(batch_size_);
+    batch_message_.linear_acceleration.resize(3*batch_size_);
+    batch_message_.angular_velocity.resize(3*batch_size_);
+    AddConsumer(batch_pub_);
+  }
+  else
+  {
+    imu_pub_ = node_handle_->advertise<sensor_msgs::Imu>(imu_topic_, 10);
+    AddConsumer(imu_pub_);
+  }
+  LoadLazySensor(_sdf, imu_parameters.update_rate_ > 0.0 ? 1.0/imu_parameters.update_rate_ : 0.0, world_->GetSimTime());
 
   // Fill imu message.
   imu_message_.header.frame_id = frame_id_;
@@ -110,169 +105,121 @@ void ImuPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   // the measurements.
   // Angular velocity measurement covariance.
   imu_message_.angular_velocity_covariance[0] =
-      imu_parameters_.gyroscope_noise_density *
-      imu_parameters_.gyroscope_noise_density;
+      imu_parameters.gyroscope_noise_density *
+      imu_parameters.gyroscope_noise_density;
   imu_message_.angular_velocity_covariance[4] =
-      imu_parameters_.gyroscope_noise_density *
-      imu_parameters_.gyroscope_noise_density;
+      imu_parameters.gyroscope_noise_density *
+      imu_parameters.gyroscope_noise_density;
   imu_message_.angular_velocity_covariance[8] =
-      imu_parameters_.gyroscope_noise_density *
-      imu_parameters_.gyroscope_noise_density;
+      imu_parameters.gyroscope_noise_density *
+      imu_parameters.gyroscope_noise_density;
   // Linear acceleration measurement covariance.
   imu_message_.linear_acceleration_covariance[0] =
-      imu_parameters_.accelerometer_noise_density *
-      imu_parameters_.accelerometer_noise_density;
+      imu_parameters.accelerometer_noise_density *
+      imu_parameters.accelerometer_noise_density;
   imu_message_.linear_acceleration_covariance[4] =
-      imu_parameters_.accelerometer_noise_density *
-      imu_parameters_.accelerometer_noise_density;
+      imu_parameters.accelerometer_noise_density *
+      imu_parameters.accelerometer_noise_density;
   imu_message_.linear_acceleration_covariance[8] =
-      imu_parameters_.accelerometer_noise_density *
-      imu_parameters_.accelerometer_noise_density;
+      imu_parameters.accelerometer_noise_density *
+      imu_parameters.accelerometer_noise_density;
   // Orientation estimate covariance (no estimate provided).
   imu_message_.orientation_covariance[0] = -1.0;
-
-  gravity_W_ = world_->GetPhysicsEngine()->GetGravity();
-  imu_parameters_.gravity_magnitude = gravity_W_.GetLength();
-
-  standard_normal_distribution_ = std::normal_distribution<double>(0.0, 1.0);
-
-  double sigma_bon_g = imu_parameters_.gyroscope_turn_on_bias_sigma;
-  double sigma_bon_a = imu_parameters_.accelerometer_turn_on_bias_sigma;
-  for (int i = 0; i < 3; ++i) {
-      gyroscope_turn_on_bias_[i] =
-          sigma_bon_g * standard_normal_distribution_(random_generator_);
-      accelerometer_turn_on_bias_[i] =
-          sigma_bon_a * standard_normal_distribution_(random_generator_);
-  }
-
-  // TODO(nikolicj) incorporate steady-state covariance of bias process
-  gyroscope_bias_.setZero();
-  accelerometer_bias_.setZero();
 }
 
 void ImuPlugin::Reset()
 {
   last_time_ = world_->GetSimTime();
+  batch_count_ = 0;
+  integrator_.reset();
 }
 
-/// \brief This function adds noise to acceleration and angular rates for
-///        accelerometer and gyroscope measurement simulation.
-void ImuPlugin::addNoise(Eigen::Vector3d* linear_acceleration,
-                               Eigen::Vector3d* angular_velocity,
-                               const double dt) {
-  ROS_ASSERT(linear_acceleration != nullptr);
-  ROS_ASSERT(angular_velocity != nullptr);
+// This gets called by the sensor scheduler whenever a sample is due.
+void ImuPlugin::OnUpdate(const common::UpdateInfo& _info)
+{
+  common::Time current_time  = _info.simTime;
+  int skipped;
+  if (!SampleNeeded(current_time, &skipped))
+    return;
 
-  if(dt <= 0.0)
+  double dt = (current_time - last_time_).Double();
+  if (skipped > 0)
   {
-    return;
+    // Catch the biases up on the samples nobody wanted, and start a new batch
+    double period = 1.0/imu_.parameters().update_rate_;
+    imu_.Skip(dt - period);
+    dt = period;
+    batch_count_ = 0;
+    integrator_.reset();
   }
 
-  // Gyrosocpe
-  double tau_g = imu_parameters_.gyroscope_bias_correlation_time;
-  // Discrete-time standard deviation equivalent to an "integrating" sampler
-  // with integration time dt.
-  double sigma_g_d = 1 / sqrt(dt) * imu_parameters_.gyroscope_noise_density;
-  double sigma_b_g = imu_parameters_.gyroscope_random_walk;
-  // Compute exact covariance of the process after dt [Maybeck 4-114].
-  double sigma_b_g_d =
-      sqrt( - sigma_b_g * sigma_b_g * tau_g / 2.0 *
-      (exp(-2.0 * dt / tau_g) - 1.0));
-  // Compute state-transition.
-  double phi_g_d = exp(-1.0 / tau_g * dt);
-  // Simulate gyroscope noise processes and add them to the true angular rate.
-  for (int i = 0; i < 3; ++i) {
-    gyroscope_bias_[i] = phi_g_d * gyroscope_bias_[i] +
-        sigma_b_g_d * standard_normal_distribution_(random_generator_);
-    (*angular_velocity)[i] = (*angular_velocity)[i] +
-        gyroscope_bias_[i] +
-        sigma_g_d * standard_normal_distribution_(random_generator_) +
-        gyroscope_turn_on_bias_[i];
-  }
+  Eigen::Vector3d linear_acceleration;
+  Eigen::Vector3d angular_velocity;
+  math::Quaternion C_W_I;
+  imu_.Sample(dt, &linear_acceleration, &angular_velocity, &C_W_I);
+  last_time_ = current_time;
 
-  // Accelerometer
-  double tau_a = imu_parameters_.accelerometer_bias_correlation_time;
-  // Discrete-time standard deviation equivalent to an "integrating" sampler
-  // with integration time dt.
-  double sigma_a_d = 1 / sqrt(dt) * imu_parameters_.accelerometer_noise_density;
-  double sigma_b_a = imu_parameters_.accelerometer_random_walk;
-  // Compute exact covariance of the process after dt [Maybeck 4-114].
-  double sigma_b_a_d =
-      sqrt( - sigma_b_a * sigma_b_a * tau_a / 2.0 *
-      (exp(-2.0 * dt / tau_a) - 1.0));
-  // Compute state-transition.
-  double phi_a_d = exp(-1.0 / tau_a * dt);
-  // Simulate accelerometer noise processes and add them to the true linear
-  // acceleration.
-  for (int i = 0; i < 3; ++i) {
-    accelerometer_bias_[i] = phi_a_d * accelerometer_bias_[i] +
-        sigma_b_a_d * standard_normal_distribution_(random_generator_);
-    (*linear_acceleration)[i] = (*linear_acceleration)[i] +
-        accelerometer_bias_[i] +
-        sigma_a_d * standard_normal_distribution_(random_generator_) +
-        accelerometer_turn_on_bias_[i];
+  if (batch_size_ > 1)
+  {
+    AddToBatch(current_time, linear_acceleration, angular_velocity, dt);
+    return;
   }
 
+  // Fill IMU message.1
+  imu_message_.header.stamp.sec = current_time.sec;
+  imu_message_.header.stamp.nsec = current_time.nsec;
+
+  // TODO: Add orientation estimator.
+  imu_message_.orientation.w = 1;
+  imu_message_.orientation.x = 0;
+  imu_message_.orientation.y = 0;
+  imu_message_.orientation.z = 0;
+  imu_message_.orientation.w = C_W_I.w;
+  imu_message_.orientation.x = C_W_I.x;
+  imu_message_.orientation.y = C_W_I.y;
+  imu_message_.orientation.z = C_W_I.z;
+
+  imu_message_.linear_acceleration.x = linear_acceleration[0];
+  imu_message_.linear_acceleration.y = linear_acceleration[1];
+  imu_message_.linear_acceleration.z = linear_acceleration[2];
+  imu_message_.angular_velocity.x = angular_velocity[0];
+  imu_message_.angular_velocity.y = angular_velocity[1];
+  imu_message_.angular_velocity.z = angular_velocity[2];
+
+  imu_pub_.publish(imu_message_);
 }
 
-// This gets called by the world update start event.
-void ImuPlugin::OnUpdate(const common::UpdateInfo& _info)
+// Collect samples and publish them, with their delta angle and velocity, once the batch is full
+void ImuPlugin::AddToBatch(const common::Time& time, const Eigen::Vector3d& linear_acceleration,
+                           const Eigen::Vector3d& angular_velocity, double dt)
 {
-  common::Time current_time  = world_->GetSimTime();
-  double dt = (current_time - last_time_).Double();
-  if(dt >= 1.0/imu_parameters_.update_rate_)
+  int i = batch_count_++;
+  batch_message_.stamp[i].sec = time.sec;
+  batch_message_.stamp[i].nsec = time.nsec;
+  for (int j = 0; j < 3; j++)
   {
-    math::Pose T_W_I = link_->GetWorldPose(); //TODO(burrimi): Check tf.
-    math::Quaternion C_W_I = T_W_I.rot;
-
-    #if GAZEBO_MAJOR_VERSION < 5
-      math::Vector3 velocity_current_W = link_->GetWorldLinearVel();
-      // link_->GetRelativeLinearAccel() does not work sometimes with old gazebo versions.
-      // This issue is solved in gazebo 5.
-      math::Vector3 acceleration = (velocity_current_W - velocity_prev_W_) / dt;
-      math::Vector3 acceleration_I = C_W_I.RotateVectorReverse(acceleration - gravity_W_);
-      velocity_prev_W_ = velocity_current_W;
-    #else
-      math::Vector3 acceleration_I = link_->GetRelativeLinearAccel() - C_W_I.RotateVectorReverse(gravity_W_);
-    #endif
-      math::Vector3 angular_vel_I = link_->GetRelativeAngularVel();
-
-    Eigen::Vector3d linear_acceleration_I(acceleration_I.x,
-                                          acceleration_I.y,
-                                          acceleration_I.z);
-    Eigen::Vector3d angular_velocity_I(angular_vel_I.x,
-                                       angular_vel_I.y,
-                                       angular_vel_I.z);
-
-    if(!perfect_imu_){
-      addNoise(&linear_acceleration_I, &angular_velocity_I, dt);
-    }
-
-    // Fill IMU message.1
-    imu_message_.header.stamp.sec = current_time.sec;
-    imu_message_.header.stamp.nsec = current_time.nsec;
-
-    // TODO: Add orientation estimator.
-    imu_message_.orientation.w = 1;
-    imu_message_.orientation.x = 0;
-    imu_message_.orientation.y = 0;
-    imu_message_.orientation.z = 0;
-    imu_message_.orientation.w = C_W_I.w;
-    imu_message_.orientation.x = C_W_I.x;
-    imu_message_.orientation.y = C_W_I.y;
-    imu_message_.orientation.z = C_W_I.z;
-
-    imu_message_.linear_acceleration.x = linear_acceleration_I[0];
-    imu_message_.linear_acceleration.y = -linear_acceleration_I[1];
-    imu_message_.linear_acceleration.z = -linear_acceleration_I[2];
-    imu_message_.angular_velocity.x = angular_velocity_I[0];
-    imu_message_.angular_velocity.y = -angular_velocity_I[1];
-    imu_message_.angular_velocity.z = -angular_velocity_I[2];
-
-    imu_pub_.publish(imu_message_);
-
-    last_time_ = current_time;
+    batch_message_.linear_acceleration[3*i + j] = linear_acceleration[j];
+    batch_message_.angular_velocity[3*i + j] = angular_velocity[j];
   }
+  integrator_.add(linear_acceleration, angular_velocity, dt);
+
+  if (batch_count_ < batch_size_)
+    return;
+
+  Eigen::Vector3d delta_angle = integrator_.deltaAngle();
+  Eigen::Vector3d delta_velocity = integrator_.deltaVelocity();
+  batch_message_.header.stamp = batch_message_.stamp[i];
+  batch_message_.delta_angle.x = delta_angle[0];
+  batch_message_.delta_angle.y = delta_angle[1];
+  batch_message_.delta_angle.z = delta_angle[2];
+  batch_message_.delta_velocity.x = delta_velocity[0];
+  batch_message_.delta_velocity.y = delta_velocity[1];
+  batch_message_.delta_velocity.z = delta_velocity[2];
+  batch_message_.integration_time = integrator_.time();
+  batch_pub_.publish(batch_message_);
+
+  batch_count_ = 0;
+  integrator_.restart();
 }
 
 
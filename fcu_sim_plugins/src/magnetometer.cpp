@@ -16,15 +16,17 @@
 
 #include "fcu_sim_plugins/magnetometer.h"
 
+#include <gazebo/math/Rand.hh>
+
 
 namespace gazebo {
 
 
-MagnetometerPlugin::MagnetometerPlugin() : ModelPlugin() {}
+MagnetometerPlugin::MagnetometerPlugin() : LazySensorPlugin() {}
 
 
 MagnetometerPlugin::~MagnetometerPlugin() {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
   if (nh_) {
     nh_->shutdown();
     delete nh_;
@@ -49,9 +51,9 @@ void MagnetometerPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[gazebo_imu_plugin] Couldn't find specified link \"" << link_name_ << "\".");
+  state_ = ModelState::Get(link_);
 
   frame_id_ = link_name_;
-  next_pub_time_ = world_->GetSimTime().Double();
 
   getSdfParam<std::string>(_sdf, "namespace", namespace_, "~");
   getSdfParam<std::string>(_sdf, "mag_topic", mag_topic_, "gps/data");
@@ -61,14 +63,15 @@ void MagnetometerPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   getSdfParam<double>(_sdf, "declination", declination_, 160.0);
   getSdfParam<double>(_sdf, "inclination", inclination_, 160.0);
 
-  // set up noise parameters
-  normal_dist_ = std::normal_distribution<double>(0.0, 1.0);
-  uniform_dist_ = std::uniform_real_distribution<double>(-bias_range_, bias_range_);
+  // Without a seed, follow the world seed (gzserver --seed) so a run can still be reproduced
+  unsigned int seed;
+  getSdfParam<unsigned int>(_sdf, "seed", seed, math::Rand::GetSeed());
+  random_.seed(seed, namespace_ + "/mag");
 
   // Create a bias offset
-  bias_vector_.x = uniform_dist_(random_gen_);
-  bias_vector_.y = uniform_dist_(random_gen_);
-  bias_vector_.z = uniform_dist_(random_gen_);
+  bias_vector_.x = random_.uniform(-bias_range_, bias_range_);
+  bias_vector_.y = random_.uniform(-bias_range_, bias_range_);
+  bias_vector_.z = random_.uniform(-bias_range_, bias_range_);
 
   // Figure out inertial magnetic field
   // Gazebo coordinates is NWU and Earth's magnetic field is defined in NED, hence the negative signs
@@ -78,6 +81,8 @@ void MagnetometerPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
 
   // Set up ROS publisher
   mag_pub_ = nh_->advertise<sensor_msgs::MagneticField>(mag_topic_, 10);
+  AddConsumer(mag_pub_);
+  LoadLazySensor(_sdf, pub_rate_ > 0.0 ? 1.0/pub_rate_ : 0.0, world_->GetSimTime());
 
   // Fill in static members of message
   mag_msg_.header.frame_id = frame_id_;
@@ -85,40 +90,40 @@ void MagnetometerPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   for(int i = 0; i < 3; i++)
       mag_msg_.magnetic_field_covariance[i + 3*i] = noise_sigma_*noise_sigma_;
 
-  // Listen to the update event. This event is broadcast every simulation iteration.
-  this->updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&MagnetometerPlugin::OnUpdate, this, _1));
+  // Ask the world's sensor scheduler to call us at the publish rate
+  this->updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/" + mag_topic_, pub_rate_,
+                                                                  boost::bind(&MagnetometerPlugin::OnUpdate, this, _1));
 }
 
 
-// This gets called by the world update start event.
+// This gets called by the sensor scheduler whenever a sample is due.
 void MagnetometerPlugin::OnUpdate(const common::UpdateInfo& _info)
 {
-    math::Pose I_to_B = link_->GetWorldPose();
-    double now = world_->GetSimTime().Double();
+    // Only white noise on top of a fixed bias, nothing to catch up on after a gap
+    int skipped;
+    if (!SampleNeeded(_info.simTime, &skipped))
+      return;
+
+    const math::Quaternion& I_to_B = state_->Snapshot().W_pose_W_C.rot;
 
-    math::Vector3 noise;
-    noise.x = noise_sigma_*normal_dist_(random_gen_);
-    noise.y = noise_sigma_*normal_dist_(random_gen_);
-    noise.z = noise_sigma_*normal_dist_(random_gen_);
+    double n[3];
+    random_.normals(n, 3);
+    math::Vector3 noise(noise_sigma_*n[0], noise_sigma_*n[1], noise_sigma_*n[2]);
 
     // combine parts to create a measurement
-    math::Vector3 measurement = I_to_B.rot.RotateVectorReverse(inertial_magnetic_field_) + noise + bias_vector_;
+    math::Vector3 measurement = I_to_B.RotateVectorReverse(inertial_magnetic_field_) + noise + bias_vector_;
 
     // normalize measurement
     math::Vector3 normalized = measurement.Normalize();
 
-    // if time, publish
-    if(now > next_pub_time_)
-    {
-        next_pub_time_ += 1/pub_rate_;
-        mag_msg_.header.seq += 1;
-        mag_msg_.header.stamp.sec = world_->GetSimTime().sec;
-        mag_msg_.header.stamp.nsec = world_->GetSimTime().nsec;
-        mag_msg_.magnetic_field.x = normalized.x;
-        mag_msg_.magnetic_field.y = -normalized.y; // convert to NED for publishing
-        mag_msg_.magnetic_field.z = -normalized.z;
-        mag_pub_.publish(mag_msg_);
-    }
+    // publish
+    mag_msg_.header.seq += 1;
+    mag_msg_.header.stamp.sec = _info.simTime.sec;
+    mag_msg_.header.stamp.nsec = _info.simTime.nsec;
+    mag_msg_.magnetic_field.x = normalized.x;
+    mag_msg_.magnetic_field.y = -normalized.y; // convert to NED for publishing
+    mag_msg_.magnetic_field.z = -normalized.z;
+    mag_pub_.publish(mag_msg_);
 }
 
 GZ_REGISTER_MODEL_PLUGIN(MagnetometerPlugin);
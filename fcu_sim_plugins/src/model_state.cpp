@@ -0,0 +1,112 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/model_state.h"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#include <boost/weak_ptr.hpp>
+
+namespace gazebo
+{
+
+ModelStatePtr ModelState::Get(physics::LinkPtr link)
+{
+  // Plugins live in separate libraries, this library holds the one instance per link.
+  // The instance holds on to its link, so a live entry can't be confused with a
+  // new link that happens to reuse the address.
+  static std::mutex instances_mutex;
+  static std::map<physics::Link*, boost::weak_ptr<ModelState> > instances;
+
+  std::lock_guard<std::mutex> lock(instances_mutex);
+  boost::weak_ptr<ModelState>& weak = instances[link.get()];
+  ModelStatePtr instance = weak.lock();
+  if (!instance)
+  {
+    instance.reset(new ModelState(link));
+    weak = instance;
+  }
+  return instance;
+}
+
+
+ModelState::ModelState(physics::LinkPtr link) :
+  link_(link),
+  world_(link->GetWorld()),
+  valid_(false),
+  wind_source_(WindSource::Get(link->GetModel()))
+{}
+
+
+const ModelState::NEDState& ModelState::Snapshot()
+{
+  // The iteration count moves every physics step
+  if (!valid_ || state_.iteration != world_->GetIterations())
+    Compute();
+  return state_;
+}
+
+
+void ModelState::Compute()
+{
+  NEDState& s = state_;
+  s.time = world_->GetSimTime();
+  s.iteration = world_->GetIterations();
+
+  /* C denotes child frame, P parent frame, and W world frame.  *
+   * Further C_pose_W_P denotes pose of P wrt. W expressed in C.*/
+  s.W_pose_W_C = link_->GetWorldCoGPose();
+  s.C_linear_velocity_W_C = link_->GetRelativeLinearVel();
+  s.C_angular_velocity_W_C = link_->GetRelativeAngularVel();
+
+  // Convert from NWU (gazebo coordinates) to NED (MAV coordinates)
+  s.pn = s.W_pose_W_C.pos.x;
+  s.pe = -s.W_pose_W_C.pos.y;
+  s.pd = -s.W_pose_W_C.pos.z;
+  math::Vector3 euler_angles = s.W_pose_W_C.rot.GetAsEuler();
+  s.phi = euler_angles.x;
+  s.theta = -euler_angles.y;
+  s.psi = -euler_angles.z;
+  s.u = s.C_linear_velocity_W_C.x;
+  s.v = -s.C_linear_velocity_W_C.y;
+  s.w = -s.C_linear_velocity_W_C.z;
+  s.p = s.C_angular_velocity_W_C.x;
+  s.q = -s.C_angular_velocity_W_C.y;
+  s.r = -s.C_angular_velocity_W_C.z;
+  s.attitude.Set(s.W_pose_W_C.rot.w, s.W_pose_W_C.rot.x, -s.W_pose_W_C.rot.y, -s.W_pose_W_C.rot.z);
+
+  // Body to vehicle frame, eq. 2.4 in the UAV Book
+  double cp = cos(s.phi), sp = sin(s.phi);
+  double ct = cos(s.theta), st = sin(s.theta);
+  double cs = cos(s.psi), ss = sin(s.psi);
+  s.R << ct*cs, sp*st*cs - cp*ss, cp*st*cs + sp*ss,
+         ct*ss, sp*st*ss + cp*cs, cp*st*ss - sp*cs,
+         -st,   sp*ct,            cp*ct;
+
+  s.wind = wind_source_->Wind(math::Vector3(s.pn, s.pe, s.pd), s.time);
+  Eigen::Vector3d wind_body = s.R.transpose()*Eigen::Vector3d(s.wind.x, s.wind.y, s.wind.z);
+  s.wind_body.Set(wind_body(0), wind_body(1), wind_body(2));
+  s.ur = s.u - wind_body(0);
+  s.vr = s.v - wind_body(1);
+  s.wr = s.w - wind_body(2);
+  s.Va = sqrt(s.ur*s.ur + s.vr*s.vr + s.wr*s.wr);
+
+  valid_ = true;
+}
+
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/multirotor_dynamics.h"
+
+#include <cmath>
+
+namespace fcu_sim
+{
+
+static constexpr double kGravity = 9.80665;
+static constexpr double kDirtyDerivativeTau = 0.05; // SimplePID default
+
+// Defaults are the same ones the Gazebo plugin has always used
+MultirotorParams::MultirotorParams() :
+  mass(3.856),
+  linear_mu(0.8),
+  angular_mu(0.5),
+  ground_effect{-55.3516, 181.8265, -203.9874, 85.3735, -7.6619},
+  l{.2, .25, .25},
+  m{.2, .25, .25},
+  n{.2, .25, .25},
+  F{1.0, 0.25, 0.35},
+  roll{0.1, 0.0, 0.0},
+  pitch{0.1, 0.0, 0.0},
+  yaw{0.1, 0.0, 0.0},
+  alt{0.1, 0.0, 0.0}
+{}
+
+
+void MultirotorDynamics::PIDBank::resize(size_t n)
+{
+  kp.resize(n, 0.0);
+  ki.resize(n, 0.0);
+  kd.resize(n, 0.0);
+  integrator.resize(n, 0.0);
+  differentiator.resize(n, 0.0);
+  last_error.resize(n, 0.0);
+  last_state.resize(n, 0.0);
+}
+
+void MultirotorDynamics::PIDBank::reset(size_t i)
+{
+  integrator[i] = 0.0;
+  differentiator[i] = 0.0;
+  last_error[i] = 0.0;
+  last_state[i] = 0.0;
+}
+
+void MultirotorDynamics::ActuatorBank::resize(size_t n)
+{
+  max.resize(n, 0.0);
+  tau_up.resize(n, 0.0);
+  tau_down.resize(n, 0.0);
+  desired.resize(n, 0.0);
+  applied.resize(n, 0.0);
+}
+
+
+MultirotorDynamics::MultirotorDynamics(size_t num_vehicles) :
+  size_(0)
+{
+  resize(num_vehicles);
+}
+
+void MultirotorDynamics::resize(size_t num_vehicles)
+{
+  size_t old_size = size_;
+  size_ = num_vehicles;
+
+  std::vector<double>* buffers[] = {
+    &state.pd, &state.phi, &state.theta, &state.u, &state.v, &state.w,
+    &state.p, &state.q, &state.r, &state.wind_u, &state.wind_v, &state.wind_w,
+    &command.x, &command.y, &command.z, &command.F,
+    &forces.Fx, &forces.Fy, &forces.Fz, &forces.l, &forces.m, &forces.n,
+    &mass_, &linear_mu_, &angular_mu_, &ge_a_, &ge_b_, &ge_c_, &ge_d_, &ge_e_,
+    &current_, &x_dot_, &out_};
+  for (std::vector<double>* buffer : buffers)
+    buffer->resize(size_, 0.0);
+  command.mode.resize(size_, MODE_NONE);
+  has_x_dot_.resize(size_, 0);
+  active_.resize(size_, 0);
+
+  l_.resize(size_);
+  m_.resize(size_);
+  n_.resize(size_);
+  F_.resize(size_);
+  roll_.resize(size_);
+  pitch_.resize(size_);
+  yaw_.resize(size_);
+  alt_.resize(size_);
+
+  // New vehicles start with the default airframe
+  MultirotorParams defaults;
+  for (size_t i = old_size; i < size_; i++)
+    setParams(i, defaults);
+}
+
+void MultirotorDynamics::setParams(size_t i, const MultirotorParams &params)
+{
+  mass_[i] = params.mass;
+  linear_mu_[i] = params.linear_mu;
+  angular_mu_[i] = params.angular_mu;
+  ge_a_[i] = params.ground_effect[0];
+  ge_b_[i] = params.ground_effect[1];
+  ge_c_[i] = params.ground_effect[2];
+  ge_d_[i] = params.ground_effect[3];
+  ge_e_[i] = params.ground_effect[4];
+
+  const MultirotorParams::Actuator* actuators[] = {&params.l, &params.m, &params.n, &params.F};
+  ActuatorBank* banks[] = {&l_, &m_, &n_, &F_};
+  for (int j = 0; j < 4; j++)
+  {
+    banks[j]->max[i] = actuators[j]->max;
+    banks[j]->tau_up[i] = actuators[j]->tau_up;
+    banks[j]->tau_down[i] = actuators[j]->tau_down;
+  }
+
+  const MultirotorParams::Gains* gains[] = {&params.roll, &params.pitch, &params.yaw, &params.alt};
+  PIDBank* pids[] = {&roll_, &pitch_, &yaw_, &alt_};
+  for (int j = 0; j < 4; j++)
+  {
+    pids[j]->kp[i] = gains[j]->P;
+    pids[j]->ki[i] = gains[j]->I;
+    pids[j]->kd[i] = gains[j]->D;
+  }
+}
+
+void MultirotorDynamics::setParams(const MultirotorParams &params)
+{
+  for (size_t i = 0; i < size_; i++)
+    setParams(i, params);
+}
+
+void MultirotorDynamics::reset(size_t i)
+{
+  ActuatorBank* banks[] = {&l_, &m_, &n_, &F_};
+  for (ActuatorBank* bank : banks)
+  {
+    bank->desired[i] = 0.0;
+    bank->applied[i] = 0.0;
+  }
+  roll_.reset(i);
+  pitch_.reset(i);
+  yaw_.reset(i);
+  alt_.reset(i);
+
+  command.mode[i] = MODE_NONE;
+  forces.Fx[i] = 0.0;
+  forces.Fy[i] = 0.0;
+  forces.Fz[i] = 0.0;
+  forces.l[i] = 0.0;
+  forces.m[i] = 0.0;
+  forces.n[i] = 0.0;
+}
+
+void MultirotorDynamics::reset()
+{
+  for (size_t i = 0; i < size_; i++)
+    reset(i);
+}
+
+
+// One PID update per vehicle.  Lanes that are not active keep their memory
+// untouched, exactly as if computePID had not been called for that vehicle.
+void MultirotorDynamics::computePID(PIDBank& pid, const double* desired, const double* current,
+                                    const double* x_dot, const char* has_x_dot, const char* active,
+                                    double dt, double* out)
+{
+  const size_t N = pid.kp.size();
+  double* kp = pid.kp.data();
+  double* ki = pid.ki.data();
+  double* kd = pid.kd.data();
+  double* integrator = pid.integrator.data();
+  double* differentiator = pid.differentiator.data();
+  double* last_error = pid.last_error.data();
+  double* last_state = pid.last_state.data();
+
+  // SimplePID does nothing (and returns zero) for very small time steps
+  const bool dt_ok = dt >= 0.0001;
+  const double d_decay = (2.0*kDirtyDerivativeTau - dt)/(2.0*kDirtyDerivativeTau + dt);
+  const double d_gain = 2.0/(2.0*kDirtyDerivativeTau + dt);
+
+  for (size_t i = 0; i < N; i++)
+  {
+    double error = desired[i] - current[i];
+    bool valid = active[i] && dt_ok && error == error;
+
+    // Use the measured derivative if we have one, otherwise the dirty derivative
+    double dirty = d_decay*differentiator[i] + d_gain*(current[i] - last_state[i]);
+    bool use_dirty = kd[i] > 0.0 && !has_x_dot[i];
+    double diff = use_dirty ? dirty : differentiator[i];
+    double d_term = (kd[i] > 0.0) ? kd[i]*(has_x_dot[i] ? x_dot[i] : diff) : 0.0;
+
+    // trapezoidal integration
+    double integ = (ki[i] > 0.0) ? integrator[i] + dt/2.0*(error + last_error[i]) : integrator[i];
+    double i_term = (ki[i] > 0.0) ? ki[i]*integ : 0.0;
+
+    double u = kp[i]*error + i_term - d_term;
+
+    differentiator[i] = valid ? diff : differentiator[i];
+    integrator[i] = valid ? integ : integrator[i];
+    last_error[i] = valid ? error : last_error[i];
+    last_state[i] = valid ? current[i] : last_state[i];
+    out[i] = valid ? u : 0.0;
+  }
+}
+
+// Discrete first-order response with separate rise and fall time constants
+void MultirotorDynamics::filterActuator(ActuatorBank& act, double min_scale, double dt)
+{
+  const size_t N = act.max.size();
+  const double* max = act.max.data();
+  const double* tau_up = act.tau_up.data();
+  const double* tau_down = act.tau_down.data();
+  const double* desired = act.desired.data();
+  double* applied = act.applied.data();
+
+  for (size_t i = 0; i < N; i++)
+  {
+    double tau = (desired[i] > applied[i]) ? tau_up[i] : tau_down[i];
+    double alpha = dt/(tau + dt);
+    double x = (1.0 - alpha)*applied[i] + alpha*desired[i];
+    double hi = max[i];
+    double lo = min_scale*max[i];
+    x = (x > hi) ? hi : x;
+    x = (x < lo) ? lo : x;
+    applied[i] = x;
+  }
+}
+
+
+void MultirotorDynamics::step(double dt)
+{
+  const size_t N = size_;
+  const int* mode = command.mode.data();
+  double* current = current_.data();
+  double* x_dot = x_dot_.data();
+  double* out = out_.data();
+  char* has_x_dot = has_x_dot_.data();
+  char* active = active_.data();
+
+  /*
+   * Roll and pitch: rate mode tracks p/q with a dirty derivative,
+   * angle modes track phi/theta and use p/q as the derivative
+   */
+  for (size_t i = 0; i < N; i++)
+  {
+    bool rate = mode[i] == MODE_RATE_THROTTLE;
+    active[i] = mode[i] >= MODE_RATE_THROTTLE && mode[i] <= MODE_ANGLE_ALTITUDE;
+    has_x_dot[i] = !rate;
+    current[i] = rate ? state.p[i] : state.phi[i];
+    x_dot[i] = state.p[i];
+  }
+  computePID(roll_, command.x.data(), current, x_dot, has_x_dot, active, dt, out);
+  for (size_t i = 0; i < N; i++)
+    l_.desired[i] = active[i] ? out[i] : l_.desired[i];
+
+  for (size_t i = 0; i < N; i++)
+  {
+    bool rate = mode[i] == MODE_RATE_THROTTLE;
+    current[i] = rate ? state.q[i] : state.theta[i];
+    x_dot[i] = state.q[i];
+  }
+  computePID(pitch_, command.y.data(), current, x_dot, has_x_dot, active, dt, out);
+  for (size_t i = 0; i < N; i++)
+    m_.desired[i] = active[i] ? out[i] : m_.desired[i];
+
+  // Yaw is always a rate loop
+  for (size_t i = 0; i < N; i++)
+    has_x_dot[i] = 0;
+  computePID(yaw_, command.z.data(), state.r.data(), x_dot, has_x_dot, active, dt, out);
+  for (size_t i = 0; i < N; i++)
+    n_.desired[i] = active[i] ? out[i] : n_.desired[i];
+
+  // Thrust: either straight throttle or altitude hold on top of a static hover offset
+  for (size_t i = 0; i < N; i++)
+  {
+    double phi = state.phi[i];
+    double theta = state.theta[i];
+    double pddot = -std::sin(theta)*state.u[i] + std::sin(phi)*std::cos(theta)*state.v[i]
+        + std::cos(phi)*std::cos(theta)*state.w[i];
+    current[i] = -state.pd[i];
+    x_dot[i] = -pddot;
+    has_x_dot[i] = 1;
+    active[i] = mode[i] == MODE_ANGLE_ALTITUDE;
+  }
+  computePID(alt_, command.F.data(), current, x_dot, has_x_dot, active, dt, out);
+  for (size_t i = 0; i < N; i++)
+  {
+    double hover = mass_[i]*kGravity/(std::cos(command.x[i])*std::cos(command.y[i]));
+    double throttle = command.F[i]*F_.max[i]; // this comes in normalized between 0 and 1
+    bool throttle_mode = mode[i] == MODE_RATE_THROTTLE || mode[i] == MODE_ANGLE_THROTTLE;
+    double Fz = active[i] ? out[i] + hover : F_.desired[i];
+    F_.desired[i] = throttle_mode ? throttle : Fz;
+  }
+
+  // calculate the actual output force using low-pass-filters to introduce a first-order
+  // approximation of delay in motor reponse
+  filterActuator(l_, -1.0, dt);
+  filterActuator(m_, -1.0, dt);
+  filterActuator(n_, -1.0, dt);
+  filterActuator(F_, 0.0, dt);
+
+  // Apply other forces (wind) <- follows "Quadrotors and Accelerometers - State Estimation With an Improved Dynamic Model"
+  // By Rob Leishman et al. (Remember NED)
+  for (size_t i = 0; i < N; i++)
+  {
+    double z = -state.pd[i];
+    double ground_effect = (((ge_a_[i]*z + ge_b_[i])*z + ge_c_[i])*z + ge_d_[i])*z + ge_e_[i];
+    ground_effect = (ground_effect > 0.0) ? ground_effect : 0.0;
+
+    double ur = state.u[i] - state.wind_u[i];
+    double vr = state.v[i] - state.wind_v[i];
+    double wr = state.w[i] - state.wind_w[i];
+
+    forces.Fx[i] = -linear_mu_[i]*ur;
+    forces.Fy[i] = -linear_mu_[i]*vr;
+    forces.Fz[i] = -linear_mu_[i]*wr - F_.applied[i] - ground_effect;
+    forces.l[i] = -angular_mu_[i]*state.p[i] + l_.applied[i];
+    forces.m[i] = -angular_mu_[i]*state.q[i] + m_.applied[i];
+    forces.n[i] = -angular_mu_[i]*state.r[i] + n_.applied[i];
+  }
+}
+
+}
@@ -24,7 +24,11 @@
 namespace gazebo {
 
 OdometryPlugin::~OdometryPlugin() {
-  event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  updateConnection_.reset();
+  odometry_pool_.report(namespace_ + "/" + odometry_pub_topic_);
+  euler_pool_.report(namespace_ + "/euler");
+  pose_pool_.report(namespace_ + "/" + pose_pub_topic_);
+  transform_pool_.report(namespace_ + "/" + transform_pub_topic_);
   if (node_handle_) {
     node_handle_->shutdown();
     delete node_handle_;
@@ -52,6 +56,7 @@ void OdometryPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   link_ = model_->GetLink(link_name_);
   if (link_ == NULL)
     gzthrow("[gazebo_odometry_plugin] Couldn't find specified link \"" << link_name_ << "\".");
+  state_ = ModelState::Get(link_);
 
   getSdfParam<std::string>(_sdf, "poseTopic", pose_pub_topic_, "pose");
   getSdfParam<std::string>(_sdf, "poseWithCovarianceTopic", pose_with_covariance_pub_topic_, "pose_with_covariance");
@@ -65,7 +70,8 @@ void OdometryPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     gzthrow("[gazebo_odometry_plugin] Couldn't find specified parent link \"" << parent_frame_id_ << "\".");
   }
 
-  updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&OdometryPlugin::OnUpdate, this, _1));
+  updateConnection_ = SensorScheduler::Get(world_).Register(namespace_ + "/" + odometry_pub_topic_, 0.0,
+                                                            boost::bind(&OdometryPlugin::OnUpdate, this, _1));
   pose_pub_ = node_handle_->advertise<geometry_msgs::PoseStamped>(pose_pub_topic_, 10);
   transform_pub_ = node_handle_->advertise<geometry_msgs::TransformStamped>(transform_pub_topic_, 10);
   odometry_pub_ = node_handle_->advertise<nav_msgs::Odometry>(odometry_pub_topic_, 10);
@@ -76,9 +82,10 @@ void OdometryPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
 void OdometryPlugin::OnUpdate(const common::UpdateInfo& _info) {
   // C denotes child frame, P parent frame, and W world frame.
   // Further C_pose_W_P denotes pose of P wrt. W expressed in C.
-  math::Pose W_pose_W_C = link_->GetWorldCoGPose();
-  math::Vector3 C_linear_velocity_W_C = link_->GetRelativeLinearVel();
-  math::Vector3 C_angular_velocity_W_C = link_->GetRelativeAngularVel();
+  const ModelState::NEDState& x = state_->Snapshot();
+  const math::Pose& W_pose_W_C = x.W_pose_W_C;
+  const math::Vector3& C_linear_velocity_W_C = x.C_linear_velocity_W_C;
+  const math::Vector3& C_angular_velocity_W_C = x.C_angular_velocity_W_C;
 
   math::Vector3 gazebo_linear_velocity = C_linear_velocity_W_C;
   math::Vector3 gazebo_angular_velocity = C_angular_velocity_W_C;
@@ -100,68 +107,68 @@ void OdometryPlugin::OnUpdate(const common::UpdateInfo& _info) {
     gazebo_pose = C_pose_P_C_;
   }
 
-  nav_msgs::Odometry odometry;
-  odometry.header.frame_id = "NED";
-  odometry.header.seq = odometry_sequence_++;
-  odometry.header.stamp.sec = (world_->GetSimTime()).sec;
-  odometry.header.stamp.nsec = (world_->GetSimTime()).nsec;
-  odometry.child_frame_id = namespace_;
-  copyPosition(gazebo_pose.pos, &odometry.pose.pose.position);
+  nav_msgs::OdometryPtr odometry = odometry_pool_.acquire();
+  odometry->header.frame_id = "NED";
+  odometry->header.seq = odometry_sequence_++;
+  odometry->header.stamp.sec = x.time.sec;
+  odometry->header.stamp.nsec = x.time.nsec;
+  odometry->child_frame_id = namespace_;
+  copyPosition(gazebo_pose.pos, &odometry->pose.pose.position);
 
   // Convert from NWU (gazebo coordinates) to NED (MAV coordinates)
-  odometry.pose.pose.position.y *= -1.0;
-  odometry.pose.pose.position.z *= -1.0;
-  odometry.pose.pose.orientation.w = gazebo_pose.rot.w;
-  odometry.pose.pose.orientation.x = gazebo_pose.rot.x;
-  odometry.pose.pose.orientation.y = -1.0*gazebo_pose.rot.y;
-  odometry.pose.pose.orientation.z = -1.0*gazebo_pose.rot.z;
-  odometry.twist.twist.linear.x = gazebo_linear_velocity.x;
-  odometry.twist.twist.linear.y = -1.0*gazebo_linear_velocity.y;
-  odometry.twist.twist.linear.z = -1.0*gazebo_linear_velocity.z;
-  odometry.twist.twist.angular.x = gazebo_angular_velocity.x;
-  odometry.twist.twist.angular.y = -1.0*gazebo_angular_velocity.y;
-  odometry.twist.twist.angular.z = -1.0*gazebo_angular_velocity.z;
+  odometry->pose.pose.position.y *= -1.0;
+  odometry->pose.pose.position.z *= -1.0;
+  odometry->pose.pose.orientation.w = gazebo_pose.rot.w;
+  odometry->pose.pose.orientation.x = gazebo_pose.rot.x;
+  odometry->pose.pose.orientation.y = -1.0*gazebo_pose.rot.y;
+  odometry->pose.pose.orientation.z = -1.0*gazebo_pose.rot.z;
+  odometry->twist.twist.linear.x = gazebo_linear_velocity.x;
+  odometry->twist.twist.linear.y = -1.0*gazebo_linear_velocity.y;
+  odometry->twist.twist.linear.z = -1.0*gazebo_linear_velocity.z;
+  odometry->twist.twist.angular.x = gazebo_angular_velocity.x;
+  odometry->twist.twist.angular.y = -1.0*gazebo_angular_velocity.y;
+  odometry->twist.twist.angular.z = -1.0*gazebo_angular_velocity.z;
 
   // Publish all the topics, for which the topic name is specified.
   if (euler_pub_.getNumSubscribers() > 0) {
-    geometry_msgs::Vector3Stamped euler;
+    geometry_msgs::Vector3StampedPtr euler = euler_pool_.acquire();
     tf::Quaternion q;
-    tf::quaternionMsgToTF(odometry.pose.pose.orientation, q);
+    tf::quaternionMsgToTF(odometry->pose.pose.orientation, q);
     tf::Matrix3x3 R(q);
     double roll, pitch, yaw;
     R.getEulerYPR(yaw, pitch, roll);
-    euler.header = odometry.header;
-    euler.vector.x = roll;
-    euler.vector.y = pitch;
-    euler.vector.z = yaw;
+    euler->header = odometry->header;
+    euler->vector.x = roll;
+    euler->vector.y = pitch;
+    euler->vector.z = yaw;
     euler_pub_.publish(euler);
   }
   if (pose_pub_.getNumSubscribers() > 0) {
-    geometry_msgs::PoseStampedPtr pose(new geometry_msgs::PoseStamped);
-    pose->header = odometry.header;
-    pose->pose = odometry.pose.pose;
+    geometry_msgs::PoseStampedPtr pose = pose_pool_.acquire();
+    pose->header = odometry->header;
+    pose->pose = odometry->pose.pose;
     pose_pub_.publish(pose);
   }
 
   if (transform_pub_.getNumSubscribers() > 0) {
-    geometry_msgs::TransformStampedPtr transform(new geometry_msgs::TransformStamped);
-    transform->header = odometry.header;
+    geometry_msgs::TransformStampedPtr transform = transform_pool_.acquire();
+    transform->header = odometry->header;
     geometry_msgs::Vector3 translation;
-    translation.x = odometry.pose.pose.position.x;
-    translation.y = odometry.pose.pose.position.y;
-    translation.z = odometry.pose.pose.position.z;
+    translation.x = odometry->pose.pose.position.x;
+    translation.y = odometry->pose.pose.position.y;
+    translation.z = odometry->pose.pose.position.z;
     transform->transform.translation = translation;
-    transform->transform.rotation = odometry.pose.pose.orientation;
+    transform->transform.rotation = odometry->pose.pose.orientation;
     transform_pub_.publish(transform);
   }
   if (odometry_pub_.getNumSubscribers() > 0) {
     odometry_pub_.publish(odometry);
   }
   tf::Quaternion tf_q;
-  tf::quaternionMsgToTF(odometry.pose.pose.orientation, tf_q);
-  tf::Vector3 tf_v(odometry.pose.pose.position.x, odometry.pose.pose.position.y, odometry.pose.pose.position.z);
+  tf::quaternionMsgToTF(odometry->pose.pose.orientation, tf_q);
+  tf::Vector3 tf_v(odometry->pose.pose.position.x, odometry->pose.pose.position.y, odometry->pose.pose.position.z);
   tf_ = tf::Transform(tf_q, tf_v);
-  transform_broadcaster_.sendTransform(tf::StampedTransform(tf_, odometry.header.stamp, parent_frame_id_, namespace_));
+  transform_broadcaster_.sendTransform(tf::StampedTransform(tf_, odometry->header.stamp, parent_frame_id_, namespace_));
 }
 
 GZ_REGISTER_MODEL_PLUGIN(OdometryPlugin);
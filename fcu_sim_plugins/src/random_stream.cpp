@@ -0,0 +1,245 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/random_stream.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fcu_sim
+{
+
+namespace
+{
+
+// Philox4x32 multipliers and Weyl key increments
+const uint32_t M0 = 0xD2511F53;
+const uint32_t M1 = 0xCD9E8D57;
+const uint32_t W0 = 0x9E3779B9;
+const uint32_t W1 = 0xBB67AE85;
+
+// philox4x32_10 on counters counter ... counter + kLanes - 1, two words out of each
+template<int kLanes>
+void philoxBlock(const uint32_t key[2], uint64_t counter, uint64_t out[2*kLanes])
+{
+  // One array per counter word so every round is a straight loop over lanes
+  uint32_t c0[kLanes], c1[kLanes], c2[kLanes], c3[kLanes];
+  for (int j = 0; j < kLanes; j++)
+  {
+    c0[j] = static_cast<uint32_t>(counter + j);
+    c1[j] = static_cast<uint32_t>((counter + j) >> 32);
+    c2[j] = 0;
+    c3[j] = 0;
+  }
+
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; round++)
+  {
+    for (int j = 0; j < kLanes; j++)
+    {
+      uint64_t p0 = static_cast<uint64_t>(M0)*c0[j];
+      uint64_t p1 = static_cast<uint64_t>(M1)*c2[j];
+      uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1[j] ^ k0;
+      uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3[j] ^ k1;
+      c0[j] = n0;
+      c1[j] = static_cast<uint32_t>(p1);
+      c2[j] = n2;
+      c3[j] = static_cast<uint32_t>(p0);
+    }
+    k0 += W0;
+    k1 += W1;
+  }
+
+  for (int j = 0; j < kLanes; j++)
+  {
+    out[2*j] = (static_cast<uint64_t>(c0[j]) << 32) | c1[j];
+    out[2*j + 1] = (static_cast<uint64_t>(c2[j]) << 32) | c3[j];
+  }
+}
+
+// splitmix64 finalizer, spreads seed and substream over all key bits
+uint64_t mix(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30))*0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27))*0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+const double kTwoPowMinus53 = 1.0/9007199254740992.0;
+
+// Ziggurat layers for the standard normal, all of equal area V.  x[0] is the
+// width of the base strip (which includes the tail past R), x[1] = R, x[256] = 0.
+const int kLayers = 256;
+const double kTailStart = 3.6541528853610088;
+const double kLayerArea = 4.92867323399e-3;
+
+struct Ziggurat
+{
+  double x[kLayers + 1];
+  double ratio[kLayers]; // x[i + 1]/x[i], the part of layer i inside the curve
+
+  Ziggurat()
+  {
+    double f = std::exp(-0.5*kTailStart*kTailStart);
+    x[0] = kLayerArea/f;
+    x[1] = kTailStart;
+    x[kLayers] = 0.0;
+    for (int i = 2; i < kLayers; i++)
+    {
+      x[i] = std::sqrt(-2.0*std::log(kLayerArea/x[i - 1] + f));
+      f = std::exp(-0.5*x[i]*x[i]);
+    }
+    for (int i = 0; i < kLayers; i++)
+      ratio[i] = x[i + 1]/x[i];
+  }
+};
+
+const Ziggurat ziggurat;
+
+}
+
+
+RandomStream::RandomStream(uint64_t seed, const std::string& substream)
+{
+  this->seed(seed, substream);
+}
+
+
+void RandomStream::seed(uint64_t seed, const std::string& substream)
+{
+  uint64_t key = mix(mix(seed) ^ hash(substream));
+  uint32_t words[2] = {static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32)};
+  setKey(words);
+}
+
+
+void RandomStream::setKey(const uint32_t key[2])
+{
+  key_[0] = key[0];
+  key_[1] = key[1];
+  counter_ = 0;
+  word_index_ = kBlockSize;
+  normal_index_ = kBlockSize;
+}
+
+
+void RandomStream::philox4x32_10(const uint32_t key[2], uint32_t ctr[4])
+{
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; round++)
+  {
+    uint64_t p0 = static_cast<uint64_t>(M0)*ctr[0];
+    uint64_t p1 = static_cast<uint64_t>(M1)*ctr[2];
+    uint32_t c0 = static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ k0;
+    uint32_t c2 = static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ k1;
+    ctr[0] = c0;
+    ctr[1] = static_cast<uint32_t>(p1);
+    ctr[2] = c2;
+    ctr[3] = static_cast<uint32_t>(p0);
+    k0 += W0;
+    k1 += W1;
+  }
+}
+
+
+uint64_t RandomStream::hash(const std::string& name)
+{
+  uint64_t h = 0xCBF29CE484222325ull;
+  for (size_t i = 0; i < name.size(); i++)
+  {
+    h ^= static_cast<unsigned char>(name[i]);
+    h *= 0x100000001B3ull;
+  }
+  return h;
+}
+
+
+void RandomStream::normals(double* out, int n)
+{
+  while (n > 0)
+  {
+    if (normal_index_ == kBlockSize)
+      refillNormal();
+    int count = std::min(n, kBlockSize - normal_index_);
+    std::copy(normal_ + normal_index_, normal_ + normal_index_ + count, out);
+    normal_index_ += count;
+    out += count;
+    n -= count;
+  }
+}
+
+
+void RandomStream::refillWords()
+{
+  philoxBlock<kBlockSize/2>(key_, counter_, words_);
+  counter_ += kBlockSize/2;
+  word_index_ = 0;
+}
+
+
+void RandomStream::refillNormal()
+{
+  const Ziggurat& z = ziggurat;
+  for (int i = 0; i < kBlockSize; i++)
+  {
+    for (;;)
+    {
+      // Low 8 bits pick the layer, the top 53 a signed position across it
+      uint64_t word = nextWord();
+      int layer = word & (kLayers - 1);
+      double u = 2.0*((word >> 11)*kTwoPowMinus53) - 1.0;
+
+      // Inside the rectangle under the next layer up, by far the most common case
+      if (std::fabs(u) < z.ratio[layer])
+      {
+        normal_[i] = u*z.x[layer];
+        break;
+      }
+      if (layer == 0)
+      {
+        normal_[i] = normalTail(u < 0.0);
+        break;
+      }
+
+      // In the wedge between the rectangles, accept under the curve
+      double x = u*z.x[layer];
+      double f0 = std::exp(-0.5*(z.x[layer]*z.x[layer] - x*x));
+      double f1 = std::exp(-0.5*(z.x[layer + 1]*z.x[layer + 1] - x*x));
+      if (f1 + uniform()*(f0 - f1) < 1.0)
+      {
+        normal_[i] = x;
+        break;
+      }
+    }
+  }
+  normal_index_ = 0;
+}
+
+
+double RandomStream::normalTail(bool negative)
+{
+  // Marsaglia's exponential rejection for |x| > R, 1 - u is in (0, 1]
+  double x, y;
+  do
+  {
+    x = std::log(1.0 - uniform())/kTailStart;
+    y = std::log(1.0 - uniform());
+  } while (-2.0*y < x*x);
+  return negative ? x - kTailStart : kTailStart - x;
+}
+
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/rigid_body.h"
+
+#include <cmath>
+
+namespace fcu_sim
+{
+
+RigidBodyParams::RigidBodyParams() :
+  mass(1.0),
+  Jx(0.07),
+  Jy(0.08),
+  Jz(0.12),
+  Jxz(0.0),
+  gravity(9.80665)
+{}
+
+
+void rigidBodyStep(const RigidBodyParams& params, double x[NUM_RIGID_BODY_STATES], const double fm[6], double dt)
+{
+  const int N = NUM_RIGID_BODY_STATES;
+  double k1[N], k2[N], k3[N], k4[N], tmp[N];
+
+  rigidBodyDerivatives(params, x, fm, k1);
+  for (int i = 0; i < N; i++)
+    tmp[i] = x[i] + dt/2.0*k1[i];
+  rigidBodyDerivatives(params, tmp, fm, k2);
+  for (int i = 0; i < N; i++)
+    tmp[i] = x[i] + dt/2.0*k2[i];
+  rigidBodyDerivatives(params, tmp, fm, k3);
+  for (int i = 0; i < N; i++)
+    tmp[i] = x[i] + dt*k3[i];
+  rigidBodyDerivatives(params, tmp, fm, k4);
+
+  for (int i = 0; i < N; i++)
+    x[i] += dt/6.0*(k1[i] + 2.0*k2[i] + 2.0*k3[i] + k4[i]);
+}
+
+}
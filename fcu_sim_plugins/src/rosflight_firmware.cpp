@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/rosflight_firmware.h"
+
+#include <dlfcn.h>
+
+namespace gazebo
+{
+
+FirmwareInstance::FirmwareInstance() :
+  handle_(NULL)
+{}
+
+
+FirmwareInstance::~FirmwareInstance()
+{
+  if (handle_ != NULL)
+    dlclose(handle_);
+}
+
+
+bool FirmwareInstance::Load(const std::string& library, std::string* error)
+{
+  // A new namespace every time, otherwise the loader hands back the copy we already have
+  handle_ = dlmopen(LM_ID_NEWLM, library.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle_ == NULL)
+  {
+    *error = dlerror();
+    return false;
+  }
+
+  return Bind(init, "rosflight_init", error)
+      && Bind(run, "rosflight_run", error)
+      && Bind(call_imu_isr, "SIL_call_IMU_ISR", error)
+      && Bind(start_imu_calibration, "start_imu_calibration", error)
+      && Bind(now_us, "SIL_now_us", error)
+      && Bind(accel_read_raw, "accel_read_raw", error)
+      && Bind(gyro_read_raw, "gyro_read_raw", error)
+      && Bind(temp_read_raw, "temp_read_raw", error)
+      && Bind(rc_signals, "_rc_signals", error)
+      && Bind(armed_state, "_armed_state", error)
+      && Bind(combined_control, "_combined_control", error)
+      && Bind(command, "_command", error)
+      && Bind(current_state, "_current_state", error)
+      && Bind(outputs, "_outputs", error);
+}
+
+
+template<class T>
+bool FirmwareInstance::Bind(T& member, const char* name, std::string* error)
+{
+  void* symbol = dlsym(handle_, name);
+  if (symbol == NULL)
+  {
+    *error = std::string("missing symbol ") + name;
+    return false;
+  }
+  member = reinterpret_cast<T>(symbol);
+  return true;
+}
+
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/rotor_model.h"
+
+namespace fcu_sim
+{
+
+std::unique_ptr<RotorModel> makeRotorModel(int num_rotors)
+{
+  switch (num_rotors)
+  {
+  case 4:
+    return std::unique_ptr<RotorModel>(new FixedRotorModel<4>);
+  case 6:
+    return std::unique_ptr<RotorModel>(new FixedRotorModel<6>);
+  case 8:
+    return std::unique_ptr<RotorModel>(new FixedRotorModel<8>);
+  default:
+    return std::unique_ptr<RotorModel>(new FixedRotorModel<Eigen::Dynamic>(num_rotors));
+  }
+}
+
+template class FixedRotorModel<4>;
+template class FixedRotorModel<6>;
+template class FixedRotorModel<8>;
+template class FixedRotorModel<Eigen::Dynamic>;
+
+}
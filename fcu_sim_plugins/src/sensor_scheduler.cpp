@@ -0,0 +1,317 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/sensor_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <boost/bind.hpp>
+
+namespace gazebo
+{
+
+namespace
+{
+
+int64_t gcd(int64_t a, int64_t b)
+{
+  while (b != 0)
+  {
+    int64_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+int64_t positiveMod(int64_t a, int64_t b)
+{
+  return ((a % b) + b) % b;
+}
+
+}
+
+const int64_t SensorScheduler::kWheelSize;
+
+SensorScheduler& SensorScheduler::Get(physics::WorldPtr world)
+{
+  // Plugins live in separate libraries, this library holds the one instance per world
+  static std::mutex instances_mutex;
+  static std::map<std::string, SensorScheduler*> instances;
+
+  std::lock_guard<std::mutex> lock(instances_mutex);
+  SensorScheduler*& instance = instances[world->GetName()];
+  if (instance == NULL)
+    instance = new SensorScheduler(world);
+  return *instance;
+}
+
+
+SensorScheduler::SensorScheduler(physics::WorldPtr world) :
+  world_(world),
+  wheel_(kWheelSize),
+  updating_(false),
+  next_id_(0)
+{
+  step_size_ = world_->GetPhysicsEngine()->GetMaxStepSize();
+  last_tick_ = llround(world_->GetSimTime().Double()/step_size_);
+}
+
+
+SensorScheduler::ConnectionPtr SensorScheduler::Register(const std::string& name, double rate,
+                                                         const Callback& callback, double phase)
+{
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  unsigned id = next_id_++;
+  Entry& entry = entries_[id];
+  entry.name = name;
+  entry.rate = rate;
+  entry.callback = callback;
+  entry.timer = fcu_sim::UpdateTimer::get(name);
+  entry.phase = phase;
+  entry.timed = false;
+  entry.removed = false;
+  entry.calls = 0;
+  entry.sum_jitter = 0.0;
+  entry.max_jitter = 0.0;
+  Configure(id, entry);
+  Schedule(id, entry, last_tick_);
+
+  if (rate > 0.0 && std::fabs(1.0/(entry.period*step_size_) - rate) > 0.01*rate)
+    gzwarn << "[fcu_sim_plugins] " << name << " asked for " << rate << " Hz, but with a "
+           << step_size_ << " s physics step it will run at " << 1.0/(entry.period*step_size_) << " Hz\n";
+
+  if (!updateConnection_)
+    updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&SensorScheduler::OnUpdate, this, _1));
+
+  return ConnectionPtr(new Connection(this, id));
+}
+
+
+void SensorScheduler::Unregister(unsigned id)
+{
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  std::map<unsigned, Entry>::iterator it = entries_.find(id);
+  if (it == entries_.end() || it->second.removed)
+    return;
+
+  Stats stats = MakeStats(it->second);
+  if (stats.calls > 1)
+    gzmsg << "[fcu_sim_plugins] " << stats.name << ": " << stats.calls << " calls at "
+          << stats.effective_rate << " Hz (every " << stats.decimation << " steps), jitter mean " << stats.mean_jitter*1e3
+          << " ms, max " << stats.max_jitter*1e3 << " ms\n";
+
+  // Stale ids left in the wheel are skipped when their slot comes around
+  if (updating_)
+  {
+    it->second.removed = true;
+    removed_.push_back(id);
+    return;
+  }
+  entries_.erase(it);
+
+  if (entries_.empty() && updateConnection_)
+  {
+    event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+    updateConnection_.reset();
+  }
+}
+
+
+std::vector<SensorScheduler::Stats> SensorScheduler::GetStats() const
+{
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::vector<Stats> stats;
+  for (std::map<unsigned, Entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it)
+  {
+    if (!it->second.removed)
+      stats.push_back(MakeStats(it->second));
+  }
+  return stats;
+}
+
+
+void SensorScheduler::OnUpdate(const common::UpdateInfo& info)
+{
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  double step_size = world_->GetPhysicsEngine()->GetMaxStepSize();
+  int64_t tick = llround(info.simTime.Double()/step_size);
+
+  if (step_size != step_size_)
+  {
+    // Periods are counted in physics steps, so everything has to be redone
+    step_size_ = step_size;
+    for (std::map<unsigned, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+      Configure(it->first, it->second);
+    Rebuild(tick - 1);
+  }
+  else if (tick < last_tick_ || tick - last_tick_ > kWheelSize)
+  {
+    // World was reset, or we were away for longer than the wheel covers
+    Rebuild(tick - 1);
+  }
+
+  updating_ = true;
+  for (int64_t t = last_tick_ + 1; t <= tick; t++)
+  {
+    last_tick_ = t;
+    std::vector<unsigned>& slot = wheel_[t % kWheelSize];
+    due_.clear();
+    due_.swap(slot);
+
+    for (size_t i = 0; i < due_.size(); i++)
+    {
+      unsigned id = due_[i];
+      std::map<unsigned, Entry>::iterator it = entries_.find(id);
+      if (it == entries_.end() || it->second.removed)
+        continue;
+      Entry& entry = it->second;
+
+      if (entry.next_tick > t)
+      {
+        // Due on a later lap of the wheel
+        slot.push_back(id);
+        continue;
+      }
+      if (t < tick)
+      {
+        // Missed while catching up, run it once on the current step instead
+        entry.next_tick = tick;
+        wheel_[tick % kWheelSize].push_back(id);
+        continue;
+      }
+
+      double now = info.simTime.Double();
+      if (entry.timed)
+      {
+        double nominal = entry.rate > 0.0 ? 1.0/entry.rate : step_size_;
+        double jitter = std::fabs((now - entry.last_call_time) - nominal);
+        entry.sum_jitter += jitter;
+        entry.max_jitter = std::max(entry.max_jitter, jitter);
+      }
+      entry.timed = true;
+      entry.last_call_time = now;
+      entry.calls++;
+
+      {
+        fcu_sim::ScopedTimer timing(entry.timer);
+        entry.callback(info);
+      }
+
+      if (!entry.removed)
+        Schedule(id, entry, t);
+    }
+  }
+  updating_ = false;
+
+  for (size_t i = 0; i < removed_.size(); i++)
+    entries_.erase(removed_[i]);
+  removed_.clear();
+
+  if (entries_.empty() && updateConnection_)
+  {
+    event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+    updateConnection_.reset();
+  }
+}
+
+
+void SensorScheduler::Configure(unsigned id, Entry& entry) const
+{
+  entry.period = 1;
+  if (entry.rate > 0.0)
+    entry.period = std::max<int64_t>(1, llround(1.0/(entry.rate*step_size_)));
+
+  if (entry.phase >= 0.0)
+    entry.offset = positiveMod(llround(entry.phase*entry.period), entry.period);
+  else
+    entry.offset = PickOffset(entry.period, id);
+}
+
+
+/*
+ * Two sensors with periods p1, p2 and offsets o1, o2 land on the same step
+ * once every lcm(p1, p2) steps if o1 == o2 (mod gcd(p1, p2)), and never
+ * otherwise.  Pick the offset that collides least often with everyone else.
+ */
+int64_t SensorScheduler::PickOffset(int64_t period, unsigned ignore) const
+{
+  int64_t best_offset = 0;
+  double best_cost = std::numeric_limits<double>::max();
+  for (int64_t offset = 0; offset < period && offset < kWheelSize; offset++)
+  {
+    double cost = 0.0;
+    for (std::map<unsigned, Entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it)
+    {
+      const Entry& other = it->second;
+      if (it->first == ignore || other.removed)
+        continue;
+      int64_t g = gcd(period, other.period);
+      if (positiveMod(offset - other.offset, g) == 0)
+        cost += static_cast<double>(g)/(static_cast<double>(period)*other.period);
+    }
+    if (cost < best_cost)
+    {
+      best_cost = cost;
+      best_offset = offset;
+    }
+  }
+  return best_offset;
+}
+
+
+void SensorScheduler::Schedule(unsigned id, Entry& entry, int64_t after_tick)
+{
+  int64_t first = after_tick + 1;
+  entry.next_tick = first + positiveMod(entry.offset - first, entry.period);
+  wheel_[entry.next_tick % kWheelSize].push_back(id);
+}
+
+
+void SensorScheduler::Rebuild(int64_t tick)
+{
+  for (size_t i = 0; i < wheel_.size(); i++)
+    wheel_[i].clear();
+  last_tick_ = tick;
+  for (std::map<unsigned, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+  {
+    if (it->second.removed)
+      continue;
+    it->second.timed = false;
+    Schedule(it->first, it->second, tick);
+  }
+}
+
+
+SensorScheduler::Stats SensorScheduler::MakeStats(const Entry& entry) const
+{
+  Stats stats;
+  stats.name = entry.name;
+  stats.rate = entry.rate;
+  stats.effective_rate = 1.0/(entry.period*step_size_);
+  stats.decimation = entry.period;
+  stats.calls = entry.calls;
+  stats.mean_jitter = entry.calls > 1 ? entry.sum_jitter/(entry.calls - 1) : 0.0;
+  stats.max_jitter = entry.max_jitter;
+  return stats;
+}
+
+}
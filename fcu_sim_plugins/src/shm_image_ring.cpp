@@ -0,0 +1,270 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/shm_image_ring.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fcu_sim
+{
+
+namespace
+{
+
+const char kMagic[8] = {'F', 'C', 'U', 'I', 'M', 'G', '0', '1'};
+
+// Segment layout: header, then slots, each a SlotHeader and slot_size bytes, all 64-byte aligned
+struct SegmentHeader
+{
+  char magic[8];
+  uint32_t slots;
+  uint32_t reserved;
+  uint64_t slot_size;
+  std::atomic<uint64_t> last; // sequence of the newest frame
+};
+
+struct SlotHeader
+{
+  std::atomic<uint64_t> version; // odd while writing, 2*sequence once written
+  uint32_t width;
+  uint32_t height;
+  uint32_t step;
+  uint32_t sec;
+  uint32_t nsec;
+  uint32_t reserved;
+  uint64_t size;
+  char encoding[32];
+};
+
+size_t align(size_t n)
+{
+  return (n + 63) & ~static_cast<size_t>(63);
+}
+
+size_t slotStride(uint64_t slot_size)
+{
+  return align(sizeof(SlotHeader)) + align(slot_size);
+}
+
+SlotHeader* slotAt(uint8_t* base, uint64_t sequence)
+{
+  const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(base);
+  return reinterpret_cast<SlotHeader*>(base + align(sizeof(SegmentHeader))
+                                       + (sequence % header->slots)*slotStride(header->slot_size));
+}
+
+}
+
+
+ShmImageWriter::ShmImageWriter() :
+  base_(NULL),
+  length_(0)
+{
+}
+
+
+ShmImageWriter::~ShmImageWriter()
+{
+  close();
+}
+
+
+void ShmImageWriter::close()
+{
+  if (base_ == NULL)
+    return;
+  munmap(base_, length_);
+  shm_unlink(name_.c_str());
+  base_ = NULL;
+  length_ = 0;
+}
+
+
+bool ShmImageWriter::open(const std::string& name, int slots, size_t slot_size, std::string* error)
+{
+  close();
+  if (slots <= 0 || slot_size == 0)
+  {
+    *error = "a shared-memory image ring needs at least one slot of a non-zero size";
+    return false;
+  }
+
+  // Start from a fresh segment, readers of one left behind by a crashed run see it vanish
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+  {
+    *error = "could not create shared memory " + name + ": " + strerror(errno);
+    return false;
+  }
+
+  size_t length = align(sizeof(SegmentHeader)) + slots*slotStride(slot_size);
+  if (ftruncate(fd, length) != 0)
+  {
+    *error = "could not size shared memory " + name + ": " + strerror(errno);
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    *error = "could not map shared memory " + name + ": " + strerror(errno);
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  // ftruncate zero-fills, so every slot version starts at 0, never written
+  base_ = static_cast<uint8_t*>(mapping);
+  length_ = length;
+  name_ = name;
+  SegmentHeader* header = reinterpret_cast<SegmentHeader*>(base_);
+  header->slots = slots;
+  header->reserved = 0;
+  header->slot_size = slot_size;
+  header->last.store(0, std::memory_order_relaxed);
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+  std::atomic_thread_fence(std::memory_order_release);
+  return true;
+}
+
+
+int ShmImageWriter::slots() const
+{
+  return base_ != NULL ? reinterpret_cast<const SegmentHeader*>(base_)->slots : 0;
+}
+
+
+uint64_t ShmImageWriter::write(const ShmFrameInfo& image, const uint8_t* data)
+{
+  if (base_ == NULL)
+    return 0;
+  SegmentHeader* header = reinterpret_cast<SegmentHeader*>(base_);
+  uint64_t size = static_cast<uint64_t>(image.step)*image.height;
+  if (size > header->slot_size || image.encoding.size() >= sizeof(SlotHeader().encoding))
+    return 0;
+
+  uint64_t sequence = header->last.load(std::memory_order_relaxed) + 1;
+  SlotHeader* slot = slotAt(base_, sequence);
+  slot->version.store(2*sequence - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->width = image.width;
+  slot->height = image.height;
+  slot->step = image.step;
+  slot->sec = image.sec;
+  slot->nsec = image.nsec;
+  slot->size = size;
+  std::memset(slot->encoding, 0, sizeof(slot->encoding));
+  std::memcpy(slot->encoding, image.encoding.data(), image.encoding.size());
+  std::memcpy(reinterpret_cast<uint8_t*>(slot) + align(sizeof(SlotHeader)), data, size);
+
+  slot->version.store(2*sequence, std::memory_order_release);
+  header->last.store(sequence, std::memory_order_release);
+  return sequence;
+}
+
+
+ShmImageReader::ShmImageReader() :
+  base_(NULL),
+  length_(0)
+{
+}
+
+
+ShmImageReader::~ShmImageReader()
+{
+  if (base_ != NULL)
+    munmap(const_cast<uint8_t*>(base_), length_);
+}
+
+
+bool ShmImageReader::open(const std::string& name, std::string* error)
+{
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+  {
+    *error = "could not open shared memory " + name + ": " + strerror(errno);
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < align(sizeof(SegmentHeader)))
+  {
+    ::close(fd);
+    *error = name + " is too short for an image ring";
+    return false;
+  }
+  size_t length = info.st_size;
+  void* mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    *error = "could not map shared memory " + name + ": " + strerror(errno);
+    return false;
+  }
+
+  const SegmentHeader* header = static_cast<const SegmentHeader*>(mapping);
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->slots == 0
+      || length < align(sizeof(SegmentHeader)) + header->slots*slotStride(header->slot_size))
+  {
+    munmap(mapping, length);
+    *error = name + " is not an image ring";
+    return false;
+  }
+
+  if (base_ != NULL)
+    munmap(const_cast<uint8_t*>(base_), length_);
+  base_ = static_cast<const uint8_t*>(mapping);
+  length_ = length;
+  return true;
+}
+
+
+bool ShmImageReader::read(uint64_t sequence, ShmFrameInfo* image, std::vector<uint8_t>* data) const
+{
+  if (base_ == NULL || sequence == 0)
+    return false;
+  const SlotHeader* slot = slotAt(const_cast<uint8_t*>(base_), sequence);
+  if (slot->version.load(std::memory_order_acquire) != 2*sequence)
+    return false;
+
+  image->width = slot->width;
+  image->height = slot->height;
+  image->step = slot->step;
+  image->sec = slot->sec;
+  image->nsec = slot->nsec;
+  image->encoding.assign(slot->encoding, strnlen(slot->encoding, sizeof(slot->encoding)));
+  uint64_t size = slot->size;
+  if (size > reinterpret_cast<const SegmentHeader*>(base_)->slot_size)
+    return false;
+  data->resize(size);
+  std::memcpy(data->data(), reinterpret_cast<const uint8_t*>(slot) + align(sizeof(SlotHeader)), size);
+
+  // Still the same frame once copied, or the writer lapped us
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot->version.load(std::memory_order_relaxed) == 2*sequence;
+}
+
+}
@@ -9,21 +9,31 @@
 #include <gazebo/sensors/CameraSensor.hh>
 #include <gazebo/sensors/SensorTypes.hh>
 #include <gazebo/sensors/SensorManager.hh>
+#include <gazebo/rendering/Camera.hh>
+#include <gazebo/rendering/Scene.hh>
 #include <unistd.h>
 #include <math.h>
 
 #include <sensor_msgs/Illuminance.h>
 
+#include "fcu_sim_plugins/common.h"
+
 using namespace gazebo;
 
 // Register this plugin with the simulator
 GZ_REGISTER_SENSOR_PLUGIN(StepCamera)
 
-StepCamera::StepCamera(){
+StepCamera::StepCamera() : _pipelineDepth(0), _frameTimeout(1.0), _waitTimer(NULL){
 }
 
 StepCamera::~StepCamera(){
     event::Events::DisconnectWorldUpdateBegin(_updateConnection);
+
+    fcu_sim::FrameBarrier::Stats stats = _frameBarrier.stats();
+    gzmsg << "[StepCamera] " << stats.requested << " frames, physics waited for " << stats.waits
+          << ", most frames in flight " << stats.max_lag << " (depth " << _pipelineDepth << "), "
+          << stats.timeouts << " timeouts dropped " << stats.dropped << "\n";
+    gzmsg << "[StepCamera] " << _output.stats() << "\n";
 }
 
 void StepCamera::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
@@ -58,6 +68,19 @@ void StepCamera::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
         this->_updateRate  = 1.0 / this->parentSensor_->GetUpdateRate();
     # endif
 
+    // How far physics may run ahead of the renderer, and how long it waits (wall s) before giving up on a frame
+    getSdfParam<int>(_sdf, "pipelineDepth", _pipelineDepth, 0);
+    getSdfParam<double>(_sdf, "frameTimeout", _frameTimeout, 1.0);
+    _frameBarrier.setDepth(_pipelineDepth);
+    // GazeboRosCameraUtils keeps its namespace and camera name private
+    std::string robot_namespace, camera_name;
+    getSdfParam<std::string>(_sdf, "robotNamespace", robot_namespace, "");
+    getSdfParam<std::string>(_sdf, "cameraName", camera_name, sensor_name);
+    _name = robot_namespace + "/" + camera_name;
+    _waitTimer = fcu_sim::UpdateTimer::get(_name + "/wait_for_render");
+
+    _output.load(_sdf);
+
     if(std::ceil(this->_updateRate / worldRate) != this->_updateRate / worldRate){
         gzwarn << "The update rate of sensor " << sensor_name << " does not evenly divide into the "
                << "MaxStepSize of the world. This will result in an actual framerate that is slower than requested. "
@@ -74,15 +97,28 @@ void StepCamera::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
     _resetConnection = event::Events::ConnectWorldReset(boost::bind(&StepCamera::Reset, this));
 }
 
+common::Time StepCamera::SceneTime() const {
+    // The sensor's LastMeasurementTime is only updated after OnNewFrame runs
+    # if GAZEBO_MAJOR_VERSION >= 7
+        return this->camera->GetScene()->SimTime();
+    # else
+        return this->camera->GetScene()->GetSimTime();
+    # endif
+}
+
 void StepCamera::OnUpdateParentSensor(){
-    this->_updateLock.unlock(); // We need both of these to get maximial speed.
+    // Reported here and from OnNewFrame, whichever comes first lets physics go (the barrier counts it once)
+    _frameBarrier.rendered(SceneTime().Double());
 }
 
-void StepCamera::OnUpdate(const common::UpdateInfo&){
-   if(this->parentSensor->IsActive() && (this->world_->GetSimTime() - this->last_update_time_) >= (this->_updateRate) ){
-     // If we should have published a message, try and get a lock to wait for onUpdateParentSensor
-     if(!this->_updateLock.timed_lock(boost::posix_time::seconds(this->_updateRate))){
-         ROS_FATAL_STREAM("Update loop timed out waiting for the renderer.");
+void StepCamera::OnUpdate(const common::UpdateInfo& _info){
+   if(this->parentSensor->IsActive() && (_info.simTime - _lastRequestTime) >= (this->_updateRate) ){
+     // A frame is due, wait until the renderer is no more than _pipelineDepth frames behind
+     _lastRequestTime = _info.simTime;
+     fcu_sim::ScopedTimer timing(_waitTimer);
+     if(!_frameBarrier.request(_frameTimeout)){
+         gzwarn << "[StepCamera] renderer fell more than " << _frameTimeout << " s behind at "
+                << _info.simTime.Double() << " s, carrying on without it\n";
      }
    }
 }
@@ -90,6 +126,8 @@ void StepCamera::OnUpdate(const common::UpdateInfo&){
 void StepCamera::Reset(){
     this->last_update_time_ = 0;
     this->sensor_update_time_ = 0;
+    _lastRequestTime = 0;
+    _frameBarrier.reset();
 }
 
 
@@ -97,17 +135,40 @@ void StepCamera::OnNewFrame(const unsigned char *_image,
     unsigned int _width, unsigned int _height, unsigned int _depth,
     const std::string &_format)
 {
-    common::Time current_time = this->world_->GetSimTime();
+    // Stamp with the scene time the frame shows, physics may already be further on
+    common::Time current_time = SceneTime();
 
     if (this->parentSensor->IsActive() && (current_time - this->last_update_time_) >= (this->_updateRate))
     {
-        this->_updateLock.unlock(); // We need both of these to get maximial speed.
+        _frameBarrier.rendered(current_time.Double());
         this->sensor_update_time_ = current_time;
 
-        this->PutCameraData(_image);
+        this->PublishImage(_image);
         this->PublishCameraInfo();
 
         this->last_update_time_ = current_time;
     }
 
-}
\ No newline at end of file
+}
+
+void StepCamera::PublishImage(const unsigned char *_src)
+{
+    // GazeboRosCameraUtils sets up ROS and the encoding on its own thread after Load
+    if (!this->initialized_ || this->height_ <= 0 || this->width_ <= 0)
+        return;
+
+    fcu_sim::ShmFrameInfo image;
+    image.width = this->width_;
+    image.height = this->height_;
+    image.step = this->skip_ * this->width_;
+    image.encoding = this->type_;
+    image.sec = this->sensor_update_time_.sec;
+    image.nsec = this->sensor_update_time_.nsec;
+    if (!_output.initialized())
+        _output.init(this->rosnode_, this->image_topic_name_, "fcu_sim_" + _name,
+                     static_cast<size_t>(image.step) * image.height);
+
+    _output.publish(_src, image, this->frame_name_, this->image_pub_, *this->image_connect_count_);
+    if (!_output.pooled())
+        this->PutCameraData(_src);
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/tick_monitor.h"
+
+#include <sstream>
+
+#include "fcu_sim_plugins/update_timer.h"
+
+namespace fcu_sim
+{
+
+namespace
+{
+
+// Label values may not hold quotes, backslashes or newlines unescaped
+std::string label(const std::string& value)
+{
+  std::string escaped;
+  for (size_t i = 0; i < value.size(); i++)
+  {
+    if (value[i] == '\n')
+      escaped += "\\n";
+    else if (value[i] == '"' || value[i] == '\\')
+      escaped += std::string("\\") + value[i];
+    else
+      escaped += value[i];
+  }
+  return escaped;
+}
+
+void header(std::ostringstream& out, const char* name, const char* type, const char* help)
+{
+  out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+}
+
+
+TickStats::TickStats() :
+  period(0.0),
+  real_time_factor(0.0),
+  steps(0),
+  overruns(0),
+  mean_step(0.0),
+  max_step(0.0),
+  worst_sim_time(0.0)
+{
+}
+
+
+TickMonitor::TickMonitor() :
+  target_period_(0.0),
+  period_begin_wall_(0),
+  period_begin_sim_(0.0),
+  steps_(0),
+  overruns_(0),
+  step_sum_(0),
+  step_max_(0),
+  worst_sim_time_(0.0),
+  steps_total_(0),
+  overruns_total_(0),
+  tick_begin_wall_(0),
+  tick_begin_sim_(0.0)
+{
+}
+
+
+void TickMonitor::beginTick(double sim_time, uint64_t wall)
+{
+  if (period_begin_wall_ == 0)
+  {
+    period_begin_wall_ = wall;
+    period_begin_sim_ = sim_time;
+  }
+  tick_begin_wall_ = wall;
+  tick_begin_sim_ = sim_time;
+}
+
+
+void TickMonitor::endTick(uint64_t wall)
+{
+  if (tick_begin_wall_ == 0)
+    return;
+  uint64_t step = wall - tick_begin_wall_;
+
+  steps_++;
+  steps_total_++;
+  step_sum_ += step;
+  if (target_period_ > 0.0 && step*1e-9 > target_period_)
+  {
+    overruns_++;
+    overruns_total_++;
+  }
+
+  // Only a new worst pays for the breakdown, the registry walk takes a lock
+  if (step > step_max_)
+  {
+    step_max_ = step;
+    worst_sim_time_ = tick_begin_sim_;
+    worst_breakdown_ = UpdateTimer::spansWithin(tick_begin_wall_, wall);
+  }
+  tick_begin_wall_ = 0;
+}
+
+
+TickStats TickMonitor::collect(double sim_time, uint64_t wall)
+{
+  TickStats stats;
+  stats.period = elapsed(wall);
+  stats.real_time_factor = stats.period > 0.0 ? (sim_time - period_begin_sim_)/stats.period : 0.0;
+  stats.steps = steps_;
+  stats.overruns = overruns_;
+  stats.mean_step = steps_ > 0 ? step_sum_*1e-9/steps_ : 0.0;
+  stats.max_step = step_max_*1e-9;
+  stats.worst_sim_time = worst_sim_time_;
+  for (size_t i = 0; i < worst_breakdown_.size(); i++)
+    stats.worst_breakdown.push_back(std::make_pair(worst_breakdown_[i].first, worst_breakdown_[i].second*1e-9));
+
+  period_begin_wall_ = wall;
+  period_begin_sim_ = sim_time;
+  steps_ = 0;
+  overruns_ = 0;
+  step_sum_ = 0;
+  step_max_ = 0;
+  worst_sim_time_ = 0.0;
+  worst_breakdown_.clear();
+  return stats;
+}
+
+
+std::string TickMonitor::prometheus(const TickStats& stats, int models) const
+{
+  std::ostringstream out;
+  out.precision(9);
+
+  header(out, "fcu_sim_real_time_factor", "gauge", "Sim time over wall time during the last period.");
+  out << "fcu_sim_real_time_factor " << stats.real_time_factor << "\n";
+  header(out, "fcu_sim_models", "gauge", "Models in the world.");
+  out << "fcu_sim_models " << models << "\n";
+  header(out, "fcu_sim_target_step_seconds", "gauge", "Wall time a step may take at real_time_update_rate, 0 for no limit.");
+  out << "fcu_sim_target_step_seconds " << target_period_ << "\n";
+  header(out, "fcu_sim_steps_total", "counter", "Physics steps.");
+  out << "fcu_sim_steps_total " << steps_total_ << "\n";
+  header(out, "fcu_sim_overruns_total", "counter", "Physics steps that took longer than the target.");
+  out << "fcu_sim_overruns_total " << overruns_total_ << "\n";
+  header(out, "fcu_sim_step_seconds", "gauge", "Wall time of a physics step during the last period.");
+  out << "fcu_sim_step_seconds{stat=\"mean\"} " << stats.mean_step << "\n";
+  out << "fcu_sim_step_seconds{stat=\"max\"} " << stats.max_step << "\n";
+  header(out, "fcu_sim_worst_step_update_seconds", "gauge", "Timed updates inside the slowest step of the last period.");
+  for (size_t i = 0; i < stats.worst_breakdown.size(); i++)
+    out << "fcu_sim_worst_step_update_seconds{update=\"" << label(stats.worst_breakdown[i].first) << "\"} "
+        << stats.worst_breakdown[i].second << "\n";
+
+  // Every timer since start-up, as a summary
+  header(out, "fcu_sim_update_seconds", "summary", "Wall time of each timed plugin update.");
+  std::vector<std::pair<std::string, LatencyHistogram::Summary> > timers = UpdateTimer::summaries();
+  for (size_t i = 0; i < timers.size(); i++)
+  {
+    const LatencyHistogram::Summary& s = timers[i].second;
+    std::string update = "update=\"" + label(timers[i].first) + "\"";
+    out << "fcu_sim_update_seconds{" << update << ",quantile=\"0.5\"} " << s.p50*1e-9 << "\n";
+    out << "fcu_sim_update_seconds{" << update << ",quantile=\"0.9\"} " << s.p90*1e-9 << "\n";
+    out << "fcu_sim_update_seconds{" << update << ",quantile=\"0.99\"} " << s.p99*1e-9 << "\n";
+    out << "fcu_sim_update_seconds{" << update << ",quantile=\"0.999\"} " << s.p999*1e-9 << "\n";
+    out << "fcu_sim_update_seconds_sum{" << update << "} " << s.mean*s.count*1e-9 << "\n";
+    out << "fcu_sim_update_seconds_count{" << update << "} " << s.count << "\n";
+  }
+  return out.str();
+}
+
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/trace.h"
+
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "fcu_sim_plugins/update_timer.h"
+
+namespace fcu_sim
+{
+
+namespace
+{
+
+struct Event
+{
+  const char* name;
+  uint64_t begin;
+  uint64_t end;
+};
+
+// One per thread that has recorded, written only by that thread
+struct ThreadBuffer
+{
+  int tid;
+  const char* name;
+  std::atomic<uint64_t> capture; // the capture count refers to, stale buffers start over
+  std::atomic<uint64_t> count; // events since that capture began, may exceed kBufferSize
+  Event events[Trace::kBufferSize];
+};
+
+std::atomic<uint64_t> current_capture(0);
+uint64_t capture_start = 0; // ns, written by start() before enabling
+
+std::mutex& buffersMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Never destroyed, like the buffers in it, a thread may record during exit
+std::vector<ThreadBuffer*>& buffers()
+{
+  static std::vector<ThreadBuffer*>* all = new std::vector<ThreadBuffer*>;
+  return *all;
+}
+
+ThreadBuffer* threadBuffer()
+{
+  static thread_local ThreadBuffer* buffer = NULL;
+  if (buffer == NULL)
+  {
+    buffer = new ThreadBuffer;
+    buffer->name = NULL;
+    buffer->capture.store(0, std::memory_order_relaxed);
+    buffer->count.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(buffersMutex());
+    buffer->tid = buffers().size() + 1;
+    buffers().push_back(buffer);
+  }
+
+  uint64_t capture = current_capture.load(std::memory_order_acquire);
+  if (buffer->capture.load(std::memory_order_relaxed) != capture)
+  {
+    buffer->count.store(0, std::memory_order_relaxed);
+    buffer->capture.store(capture, std::memory_order_release);
+  }
+  return buffer;
+}
+
+void writeString(FILE* file, const char* text)
+{
+  fputc('"', file);
+  for (const char* c = text; *c != '\0'; c++)
+  {
+    if (*c == '"' || *c == '\\')
+      fputc('\\', file);
+    if (static_cast<unsigned char>(*c) >= 0x20)
+      fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+}
+
+std::atomic<bool> Trace::enabled_(false);
+const int Trace::kBufferSize;
+
+
+void Trace::start()
+{
+  enabled_.store(false, std::memory_order_relaxed);
+  capture_start = UpdateTimer::now();
+  current_capture.fetch_add(1, std::memory_order_release);
+  enabled_.store(true, std::memory_order_release);
+}
+
+
+void Trace::stop()
+{
+  enabled_.store(false, std::memory_order_release);
+}
+
+
+void Trace::record(const char* name, uint64_t begin, uint64_t end)
+{
+  ThreadBuffer* buffer = threadBuffer();
+  uint64_t n = buffer->count.load(std::memory_order_relaxed);
+  Event& event = buffer->events[n & (kBufferSize - 1)];
+  event.name = name;
+  event.begin = begin;
+  event.end = end;
+  buffer->count.store(n + 1, std::memory_order_release);
+}
+
+
+void Trace::nameThread(const char* name)
+{
+  threadBuffer()->name = name;
+}
+
+
+long Trace::writeChromeTrace(const std::string& filename)
+{
+  std::string temporary = filename + ".tmp";
+  FILE* file = fopen(temporary.c_str(), "w");
+  if (file == NULL)
+    return -1;
+
+  std::vector<ThreadBuffer*> all;
+  {
+    std::lock_guard<std::mutex> lock(buffersMutex());
+    all = buffers();
+  }
+
+  // Complete ("X") events in microseconds from start(), one track per thread
+  uint64_t capture = current_capture.load(std::memory_order_acquire);
+  long written = 0;
+  const char* separator = "\n";
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+  for (size_t i = 0; i < all.size(); i++)
+  {
+    ThreadBuffer* buffer = all[i];
+    uint64_t count = buffer->count.load(std::memory_order_acquire);
+    if (buffer->capture.load(std::memory_order_acquire) != capture || count == 0)
+      continue;
+
+    if (buffer->name != NULL)
+    {
+      fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+              separator, buffer->tid);
+      writeString(file, buffer->name);
+      fputs("}}", file);
+      separator = ",\n";
+    }
+
+    // Only the newest kBufferSize survive the wrap
+    uint64_t first = count > static_cast<uint64_t>(kBufferSize) ? count - kBufferSize : 0;
+    for (uint64_t n = first; n < count; n++)
+    {
+      const Event& event = buffer->events[n & (kBufferSize - 1)];
+      if (event.begin < capture_start)
+        continue;
+      fprintf(file, "%s{\"name\":", separator);
+      writeString(file, event.name);
+      fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", buffer->tid,
+              (event.begin - capture_start)*1e-3, (event.end - event.begin)*1e-3);
+      separator = ",\n";
+      written++;
+    }
+  }
+  fputs("\n]}\n", file);
+
+  bool ok = ferror(file) == 0;
+  ok = fclose(file) == 0 && ok;
+  if (!ok || std::rename(temporary.c_str(), filename.c_str()) != 0)
+    return -1;
+  return written;
+}
+
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Headless trim and linearization sweep for the fixed-wing model.  Loads an
+ * agent yaml (the same file the launch files hand to rosparam) and a grid of
+ * airspeeds, flight path angles and turn radii, trims the aircraft at every
+ * combination in parallel and writes the trim states, inputs and A/B matrices
+ * with ColumnarTable, one row per trim point.
+ *
+ *   fcu_sim_trim <agent.yaml> <trim.yaml> <output file>
+ *
+ * See fcu_sim/agents/junker/trim.yaml for the grid format.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include "fcu_sim_plugins/aircraft_trim.h"
+#include "fcu_sim_plugins/columnar_writer.h"
+#include "fcu_sim_plugins/work_stealing_pool.h"
+#include "fcu_sim_plugins/yaml_params.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+const char* state_names[NUM_RIGID_BODY_STATES] = {
+  "pn", "pe", "pd", "u", "v", "w", "phi", "theta", "psi", "p", "q", "r"
+};
+
+const char* input_names[NUM_AIRCRAFT_INPUTS] = {"e", "t", "a", "r"};
+
+enum Column
+{
+  COL_VA, COL_GAMMA, COL_R, COL_BETA, COL_CONVERGED, COL_ITERATIONS, COL_RESIDUAL, COL_ALPHA,
+  COL_X, // NUM_RIGID_BODY_STATES trim states
+  COL_U = COL_X + NUM_RIGID_BODY_STATES, // NUM_AIRCRAFT_INPUTS trim inputs
+  COL_A = COL_U + NUM_AIRCRAFT_INPUTS, // A row-major
+  COL_B = COL_A + NUM_RIGID_BODY_STATES*NUM_RIGID_BODY_STATES, // B row-major
+  NUM_COLUMNS = COL_B + NUM_RIGID_BODY_STATES*NUM_AIRCRAFT_INPUTS
+};
+
+// A_u_w is d(u dot)/dw, B_q_e is d(q dot)/d(delta_e)
+std::vector<std::string> columnNames()
+{
+  std::vector<std::string> names = {"Va", "gamma", "R", "beta", "converged", "iterations", "residual", "alpha"};
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+    names.push_back(std::string("x_") + state_names[i]);
+  for (int i = 0; i < NUM_AIRCRAFT_INPUTS; i++)
+    names.push_back(std::string("u_") + input_names[i]);
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+    for (int j = 0; j < NUM_RIGID_BODY_STATES; j++)
+      names.push_back(std::string("A_") + state_names[i] + "_" + state_names[j]);
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+    for (int j = 0; j < NUM_AIRCRAFT_INPUTS; j++)
+      names.push_back(std::string("B_") + state_names[i] + "_" + input_names[j]);
+  return names;
+}
+
+struct Grid
+{
+  std::vector<double> Va;
+  std::vector<double> gamma;
+  std::vector<double> R;
+  double beta;
+  unsigned threads;
+  TrimOptions options;
+};
+
+// A scalar or a list
+std::vector<double> values(const YAML::Node& node, const char* key, double default_value)
+{
+  const YAML::Node value = node[key];
+  if (!value)
+    return std::vector<double>(1, default_value);
+  if (value.IsSequence())
+    return value.as<std::vector<double> >();
+  return std::vector<double>(1, value.as<double>());
+}
+
+Grid loadGrid(const YAML::Node& node)
+{
+  YamlParams p(node);
+  Grid g;
+  g.Va = values(node, "Va", 25.0);
+  g.gamma = values(node, "gamma", 0.0);
+  g.R = values(node, "R", INFINITY);
+  g.beta = p.param<double>("beta", 0.0);
+  g.threads = p.param<unsigned>("threads", 0);
+  g.options.max_iterations = p.param<int>("max_iterations", g.options.max_iterations);
+  g.options.tolerance = p.param<double>("tolerance", g.options.tolerance);
+  return g;
+}
+
+void record(ColumnarTable& table, size_t row, const TrimCondition& c, const TrimResult& result)
+{
+  table.at(row, COL_VA) = c.Va;
+  table.at(row, COL_GAMMA) = c.gamma;
+  table.at(row, COL_R) = c.R;
+  table.at(row, COL_BETA) = c.beta;
+  table.at(row, COL_CONVERGED) = result.converged;
+  table.at(row, COL_ITERATIONS) = result.iterations;
+  table.at(row, COL_RESIDUAL) = result.residual;
+  table.at(row, COL_ALPHA) = result.alpha;
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+    table.at(row, COL_X + i) = result.x[i];
+  for (int i = 0; i < NUM_AIRCRAFT_INPUTS; i++)
+    table.at(row, COL_U + i) = result.u[i];
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+  {
+    for (int j = 0; j < NUM_RIGID_BODY_STATES; j++)
+      table.at(row, COL_A + i*NUM_RIGID_BODY_STATES + j) = result.A[i][j];
+    for (int j = 0; j < NUM_AIRCRAFT_INPUTS; j++)
+      table.at(row, COL_B + i*NUM_AIRCRAFT_INPUTS + j) = result.B[i][j];
+  }
+}
+
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc != 4)
+  {
+    fprintf(stderr, "usage: %s <agent.yaml> <trim.yaml> <output file>\n", argv[0]);
+    return 1;
+  }
+
+  YAML::Node agent_yaml, grid_yaml;
+  try
+  {
+    agent_yaml = YAML::LoadFile(argv[1]);
+    grid_yaml = YAML::LoadFile(argv[2]);
+  }
+  catch (const YAML::Exception& e)
+  {
+    fprintf(stderr, "[fcu_sim_trim] could not load yaml: %s\n", e.what());
+    return 1;
+  }
+
+  Grid grid;
+  AircraftParams aircraft;
+  try
+  {
+    grid = loadGrid(grid_yaml);
+    YamlParams agent(agent_yaml);
+    aircraft.load(agent);
+  }
+  catch (const YAML::Exception& e)
+  {
+    fprintf(stderr, "[fcu_sim_trim] bad parameter: %s\n", e.what());
+    return 1;
+  }
+
+  RigidBodyParams body;
+  body.mass = aircraft.mass;
+  body.Jx = aircraft.Jx;
+  body.Jy = aircraft.Jy;
+  body.Jz = aircraft.Jz;
+  body.Jxz = aircraft.Jxz;
+
+  std::vector<TrimCondition> conditions;
+  for (double Va : grid.Va)
+    for (double gamma : grid.gamma)
+      for (double R : grid.R)
+      {
+        TrimCondition c = {Va, gamma, R, grid.beta};
+        conditions.push_back(c);
+      }
+  for (const TrimCondition& c : conditions)
+  {
+    if (c.Va <= 0.0 || c.R == 0.0)
+    {
+      fprintf(stderr, "[fcu_sim_trim] Va must be positive and R nonzero\n");
+      return 1;
+    }
+  }
+
+  ColumnarTable table(columnNames(), conditions.size());
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    WorkStealingPool pool(grid.threads);
+    for (size_t i = 0; i < conditions.size(); i++)
+    {
+      pool.submit([&, i]{
+        record(table, i, conditions[i], computeTrim(aircraft, body, conditions[i], grid.options));
+      });
+    }
+    pool.wait();
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (!table.write(argv[3]))
+  {
+    fprintf(stderr, "[fcu_sim_trim] could not write %s\n", argv[3]);
+    return 1;
+  }
+
+  int converged = 0;
+  for (size_t i = 0; i < conditions.size(); i++)
+  {
+    converged += table.at(i, COL_CONVERGED) > 0.5;
+    if (table.at(i, COL_CONVERGED) < 0.5)
+      fprintf(stderr, "[fcu_sim_trim] no trim at Va %g gamma %g R %g (residual %g)\n", conditions[i].Va,
+              conditions[i].gamma, conditions[i].R, table.at(i, COL_RESIDUAL));
+  }
+  printf("[fcu_sim_trim] %d of %zu trim points converged in %.3f s wall\n",
+         converged, conditions.size(), wall);
+  return 0;
+}
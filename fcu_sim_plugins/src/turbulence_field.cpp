@@ -0,0 +1,334 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/turbulence_field.h"
+
+#include <climits>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <unsupported/Eigen/FFT>
+
+#include "fcu_sim_plugins/random_stream.h"
+
+namespace fcu_sim
+{
+
+namespace
+{
+
+const char kMagic[8] = {'F', 'C', 'U', 'T', 'R', 'B', '0', '1'};
+
+struct FileHeader
+{
+  char magic[8];
+  uint32_t size[3];
+  uint32_t reserved;
+  double spacing;
+};
+
+bool isPowerOfTwo(int n)
+{
+  return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Signed wavenumber of FFT bin i out of n, for a box of length n*spacing
+double wavenumber(int i, int n, double spacing)
+{
+  return 2.0*M_PI*(i < n/2 ? i : i - n)/(n*spacing);
+}
+
+// In-place inverse FFT of a 3D array (x fastest) along every axis
+void inverseFFT3(std::vector<std::complex<double> >& a, const int n[3])
+{
+  Eigen::FFT<double> fft;
+  size_t stride[3] = {1, static_cast<size_t>(n[0]), static_cast<size_t>(n[0])*n[1]};
+  for (int axis = 0; axis < 3; axis++)
+  {
+    std::vector<std::complex<double> > line(n[axis]), out(n[axis]);
+    int o1 = (axis + 1) % 3, o2 = (axis + 2) % 3;
+    for (int j = 0; j < n[o1]; j++)
+    {
+      for (int k = 0; k < n[o2]; k++)
+      {
+        size_t base = j*stride[o1] + k*stride[o2];
+        for (int i = 0; i < n[axis]; i++)
+          line[i] = a[base + i*stride[axis]];
+        fft.inv(out, line);
+        for (int i = 0; i < n[axis]; i++)
+          a[base + i*stride[axis]] = out[i];
+      }
+    }
+  }
+}
+
+}
+
+
+TurbulenceParams::TurbulenceParams() :
+  spacing(4.0),
+  intensity(1.0),
+  length_scale(150.0)
+{
+  size[0] = size[1] = size[2] = 64;
+}
+
+
+TurbulenceField::TurbulenceField() :
+  spacing_(1.0),
+  data_(NULL),
+  mapping_(NULL),
+  mapping_size_(0)
+{
+  size_[0] = size_[1] = size_[2] = 0;
+  mean_[0] = mean_[1] = mean_[2] = 0.0;
+}
+
+
+TurbulenceField::~TurbulenceField()
+{
+  unmap();
+}
+
+
+void TurbulenceField::unmap()
+{
+  if (mapping_ != NULL)
+    munmap(mapping_, mapping_size_);
+  mapping_ = NULL;
+  mapping_size_ = 0;
+}
+
+
+bool TurbulenceField::generate(const TurbulenceParams& params, uint64_t seed)
+{
+  for (int i = 0; i < 3; i++)
+    if (!isPowerOfTwo(params.size[i]))
+      return false;
+  if (params.spacing <= 0.0 || params.intensity < 0.0 || params.length_scale <= 0.0)
+    return false;
+
+  const int* n = params.size;
+  size_t points = static_cast<size_t>(n[0])*n[1]*n[2];
+  std::vector<std::complex<double> > modes[3];
+  for (int c = 0; c < 3; c++)
+    modes[c].assign(points, std::complex<double>(0.0, 0.0));
+
+  // Random Fourier modes with amplitude from the von Karman energy spectrum
+  // E(k) ~ (Lk)^4/(1 + (Lk)^2)^(17/6), shared over the shell as E(k)/(4 pi k^2),
+  // projected onto the plane normal to k so the field is divergence free
+  RandomStream random(seed, "turbulence");
+  double L = params.length_scale;
+  size_t index = 0;
+  for (int z = 0; z < n[2]; z++)
+  {
+    double kz = wavenumber(z, n[2], params.spacing);
+    for (int y = 0; y < n[1]; y++)
+    {
+      double ky = wavenumber(y, n[1], params.spacing);
+      for (int x = 0; x < n[0]; x++, index++)
+      {
+        double kx = wavenumber(x, n[0], params.spacing);
+        double k2 = kx*kx + ky*ky + kz*kz;
+
+        // Draw even for the mean mode so the sequence doesn't depend on which mode is skipped
+        std::complex<double> xi[3];
+        for (int c = 0; c < 3; c++)
+          xi[c] = std::complex<double>(random.normal(), random.normal());
+        if (k2 == 0.0)
+          continue;
+
+        double Lk2 = L*L*k2;
+        double energy = Lk2*Lk2/std::pow(1.0 + Lk2, 17.0/6.0);
+        double amplitude = std::sqrt(energy/(4.0*M_PI*k2));
+        double k[3] = {kx, ky, kz};
+        std::complex<double> k_dot_xi = (kx*xi[0] + ky*xi[1] + kz*xi[2])/k2;
+        for (int c = 0; c < 3; c++)
+          modes[c][index] = amplitude*(xi[c] - k[c]*k_dot_xi);
+      }
+    }
+  }
+
+  // Back to space, keeping the real part (still Gaussian with the same spectrum)
+  double sum_squares = 0.0;
+  for (int c = 0; c < 3; c++)
+  {
+    inverseFFT3(modes[c], n);
+    for (size_t i = 0; i < points; i++)
+      sum_squares += modes[c][i].real()*modes[c][i].real();
+  }
+
+  // The spectrum above is only a shape, scale the box to the requested rms
+  double rms = std::sqrt(sum_squares/(3.0*points));
+  double scale = rms > 0.0 ? params.intensity/rms : 0.0;
+
+  unmap();
+  storage_.resize(3*points);
+  for (size_t i = 0; i < points; i++)
+    for (int c = 0; c < 3; c++)
+      storage_[3*i + c] = static_cast<float>(scale*modes[c][i].real());
+
+  data_ = storage_.data();
+  for (int i = 0; i < 3; i++)
+    size_[i] = n[i];
+  spacing_ = params.spacing;
+  return true;
+}
+
+
+bool TurbulenceField::load(const std::string& filename, std::string* error)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    *error = "could not open " + filename;
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader))
+  {
+    close(fd);
+    *error = filename + " is too short for a turbulence file";
+    return false;
+  }
+
+  size_t length = info.st_size;
+  void* mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    *error = "could not map " + filename;
+    return false;
+  }
+
+  FileHeader header;
+  std::memcpy(&header, mapping, sizeof(header));
+  bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+      && std::isfinite(header.spacing) && header.spacing > 0.0;
+
+  // Sizes index the grid as int, and the point count must not wrap before
+  // it is compared with the file length
+  const size_t max_points = (SIZE_MAX - sizeof(FileHeader))/3/sizeof(float);
+  size_t points = 1;
+  for (int i = 0; valid && i < 3; i++)
+  {
+    valid = header.size[i] > 0 && header.size[i] <= static_cast<uint32_t>(INT_MAX)
+        && points <= max_points/header.size[i];
+    if (valid)
+      points *= header.size[i];
+  }
+  valid = valid && length == sizeof(FileHeader) + 3*points*sizeof(float);
+  if (!valid)
+  {
+    munmap(mapping, length);
+    *error = filename + " is not a turbulence file or is truncated";
+    return false;
+  }
+
+  unmap();
+  storage_.clear();
+  mapping_ = mapping;
+  mapping_size_ = length;
+  data_ = reinterpret_cast<const float*>(static_cast<const char*>(mapping) + sizeof(FileHeader));
+  for (int i = 0; i < 3; i++)
+    size_[i] = header.size[i];
+  spacing_ = header.spacing;
+  return true;
+}
+
+
+bool TurbulenceField::save(const std::string& filename) const
+{
+  if (empty())
+    return false;
+
+  std::ofstream file(filename.c_str(), std::ios::binary);
+  if (!file)
+    return false;
+
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  for (int i = 0; i < 3; i++)
+    header.size[i] = size_[i];
+  header.reserved = 0;
+  header.spacing = spacing_;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  size_t points = static_cast<size_t>(size_[0])*size_[1]*size_[2];
+  file.write(reinterpret_cast<const char*>(data_), 3*points*sizeof(float));
+  return file.good();
+}
+
+
+void TurbulenceField::setMeanWind(const double mean[3])
+{
+  for (int i = 0; i < 3; i++)
+    mean_[i] = mean[i];
+}
+
+
+void TurbulenceField::sample(const double position[3], double t, double wind[3]) const
+{
+  for (int c = 0; c < 3; c++)
+    wind[c] = mean_[c];
+  if (empty())
+    return;
+
+  // Grid cell and weights, the box repeats in every direction
+  int i0[3], i1[3];
+  double f[3];
+  for (int a = 0; a < 3; a++)
+  {
+    double g = (position[a] - mean_[a]*t)/spacing_;
+
+    // A diverged vehicle can be anywhere, leave it the mean wind rather than
+    // convert a NaN or a huge cell number to an integer; the box repeats, so
+    // folding g into one period first changes nothing
+    if (!std::isfinite(g))
+      return;
+    g = std::fmod(g, static_cast<double>(size_[a]));
+    double cell = std::floor(g);
+    f[a] = g - cell;
+    long i = static_cast<long>(cell) % size_[a];
+    if (i < 0)
+      i += size_[a];
+    i0[a] = i;
+    i1[a] = (i + 1) % size_[a];
+  }
+
+  size_t row = size_[0];
+  size_t slab = row*size_[1];
+  for (int corner = 0; corner < 8; corner++)
+  {
+    int cx = corner & 1, cy = (corner >> 1) & 1, cz = (corner >> 2) & 1;
+    double weight = (cx ? f[0] : 1.0 - f[0])*(cy ? f[1] : 1.0 - f[1])*(cz ? f[2] : 1.0 - f[2]);
+    const float* v = data_ + 3*((cz ? i1[2] : i0[2])*slab + (cy ? i1[1] : i0[1])*row + (cx ? i1[0] : i0[0]));
+    wind[0] += weight*v[0];
+    wind[1] += weight*v[1];
+    wind[2] += weight*v[2];
+  }
+}
+
+}
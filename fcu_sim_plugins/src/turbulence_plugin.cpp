@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "fcu_sim_plugins/turbulence_plugin.h"
+
+#include <gazebo/math/Rand.hh>
+
+namespace gazebo {
+
+TurbulencePlugin::~TurbulencePlugin() {
+  if (wind_source_)
+    wind_source_->ClearProvider();
+}
+
+void TurbulencePlugin::Load(physics::WorldPtr _world, sdf::ElementPtr _sdf) {
+  std::string field_file, save_file;
+  getSdfParam<std::string>(_sdf, "fieldFile", field_file, "");
+  getSdfParam<std::string>(_sdf, "saveFile", save_file, "");
+
+  fcu_sim::TurbulenceParams params;
+  math::Vector3 grid_size(params.size[0], params.size[1], params.size[2]);
+  getSdfParam<math::Vector3>(_sdf, "gridSize", grid_size, grid_size);
+  getSdfParam<double>(_sdf, "gridSpacing", params.spacing, params.spacing);
+  getSdfParam<double>(_sdf, "intensity", params.intensity, params.intensity);
+  getSdfParam<double>(_sdf, "lengthScale", params.length_scale, params.length_scale);
+  params.size[0] = static_cast<int>(grid_size.x);
+  params.size[1] = static_cast<int>(grid_size.y);
+  params.size[2] = static_cast<int>(grid_size.z);
+
+  // Same convention as the wind plugin: no seed means the world seed
+  unsigned int seed;
+  getSdfParam<unsigned int>(_sdf, "seed", seed, math::Rand::GetSeed());
+
+  math::Vector3 mean_wind;
+  getSdfParam<math::Vector3>(_sdf, "meanWind", mean_wind, math::Vector3(0, 0, 0));
+
+  field_.reset(new fcu_sim::TurbulenceField);
+
+  // A saved field is mapped as is, much faster than synthesizing a large one on every launch
+  std::string error;
+  if (!field_file.empty() && field_->load(field_file, &error))
+  {
+    gzmsg << "[turbulence_plugin] mapped " << field_file << "\n";
+  }
+  else
+  {
+    if (!field_file.empty())
+      gzwarn << "[turbulence_plugin] " << error << ", generating a new field\n";
+
+    common::Time start = common::Time::GetWallTime();
+    if (!field_->generate(params, seed))
+      gzthrow("[turbulence_plugin] gridSize must be powers of two and the other parameters positive");
+    gzmsg << "[turbulence_plugin] generated " << params.size[0] << "x" << params.size[1] << "x" << params.size[2]
+          << " field (seed " << seed << ") in " << (common::Time::GetWallTime() - start).Double() << " s\n";
+
+    if (!save_file.empty() && !field_->save(save_file))
+      gzerr << "[turbulence_plugin] could not write " << save_file << "\n";
+  }
+
+  double mean[3] = {mean_wind.x, mean_wind.y, mean_wind.z};
+  field_->setMeanWind(mean);
+
+  wind_source_ = WindSource::Get(_world);
+  wind_source_->SetProvider(boost::bind(&TurbulencePlugin::Wind, this, _1, _2));
+}
+
+math::Vector3 TurbulencePlugin::Wind(const math::Vector3& position, const common::Time& time) const {
+  double p[3] = {position.x, position.y, position.z};
+  double w[3];
+  field_->sample(p, time.Double(), w);
+  return math::Vector3(w[0], w[1], w[2]);
+}
+
+GZ_REGISTER_WORLD_PLUGIN(TurbulencePlugin)
+}
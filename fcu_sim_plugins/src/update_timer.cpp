@@ -0,0 +1,199 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/update_timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace fcu_sim
+{
+
+namespace
+{
+
+std::mutex& registryMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Never destroyed, plugins may still record while static destructors run
+std::map<std::string, UpdateTimer*>& registry()
+{
+  static std::map<std::string, UpdateTimer*>* timers = new std::map<std::string, UpdateTimer*>;
+  return *timers;
+}
+
+bool longerSpan(const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b)
+{
+  return a.second > b.second;
+}
+
+}
+
+const int LatencyHistogram::kSubBuckets;
+const int LatencyHistogram::kMaxShift;
+const int LatencyHistogram::kBuckets;
+
+
+void LatencyHistogram::reset()
+{
+  for (int i = 0; i < kBuckets; i++)
+    counts_[i].store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+
+int LatencyHistogram::bucket(uint64_t ns)
+{
+  if (ns < 2*kSubBuckets)
+    return static_cast<int>(ns);
+
+  // Octave from the top bit, position within it from the next five
+  int msb = 63 - __builtin_clzll(ns);
+  int shift = msb - 5;
+  if (shift > kMaxShift)
+    return kBuckets - 1;
+  int mantissa = static_cast<int>(ns >> shift);
+  return 2*kSubBuckets + (shift - 1)*kSubBuckets + (mantissa - kSubBuckets);
+}
+
+
+uint64_t LatencyHistogram::upperBound(int bucket)
+{
+  if (bucket < 2*kSubBuckets)
+    return bucket;
+  int shift = (bucket - 2*kSubBuckets)/kSubBuckets + 1;
+  uint64_t mantissa = kSubBuckets + (bucket - 2*kSubBuckets) % kSubBuckets;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+
+LatencyHistogram::Summary LatencyHistogram::summary() const
+{
+  Summary s;
+  uint64_t counts[kBuckets];
+  uint64_t total = 0;
+  for (int i = 0; i < kBuckets; i++)
+  {
+    counts[i] = counts_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  s.count = total;
+  s.mean = total > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed))/total : 0.0;
+  s.max = max_.load(std::memory_order_relaxed);
+
+  const double fractions[4] = {0.5, 0.9, 0.99, 0.999};
+  uint64_t* out[4] = {&s.p50, &s.p90, &s.p99, &s.p999};
+  uint64_t seen = 0;
+  int b = 0;
+  for (int k = 0; k < 4; k++)
+  {
+    uint64_t rank = static_cast<uint64_t>(std::ceil(fractions[k]*total));
+    while (b < kBuckets - 1 && seen + counts[b] < rank)
+      seen += counts[b++];
+    *out[k] = total > 0 ? std::min(upperBound(b), s.max) : 0;
+  }
+  return s;
+}
+
+
+UpdateTimer* UpdateTimer::get(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  UpdateTimer*& timer = registry()[name];
+  if (timer == NULL)
+    timer = new UpdateTimer(name);
+  return timer;
+}
+
+
+std::vector<std::pair<std::string, LatencyHistogram::Summary> > UpdateTimer::summaries()
+{
+  std::vector<std::pair<std::string, LatencyHistogram::Summary> > all;
+  std::lock_guard<std::mutex> lock(registryMutex());
+  for (std::map<std::string, UpdateTimer*>::const_iterator it = registry().begin(); it != registry().end(); ++it)
+  {
+    LatencyHistogram::Summary s = it->second->histogram_.summary();
+    if (s.count > 0)
+      all.push_back(std::make_pair(it->first, s));
+  }
+  return all;
+}
+
+
+std::string UpdateTimer::report()
+{
+  std::vector<std::pair<std::string, LatencyHistogram::Summary> > all = summaries();
+  std::string text = "# name count mean_us p50_us p90_us p99_us p99.9_us max_us\n";
+  char line[512];
+  for (size_t i = 0; i < all.size(); i++)
+  {
+    const LatencyHistogram::Summary& s = all[i].second;
+    snprintf(line, sizeof(line), "%s %llu %.2f %.2f %.2f %.2f %.2f %.2f\n", all[i].first.c_str(),
+             static_cast<unsigned long long>(s.count), s.mean*1e-3, s.p50*1e-3, s.p90*1e-3,
+             s.p99*1e-3, s.p999*1e-3, s.max*1e-3);
+    text += line;
+  }
+  return text;
+}
+
+
+bool UpdateTimer::writeReport(const std::string& filename)
+{
+  std::string temporary = filename + ".tmp";
+  {
+    std::ofstream file(temporary.c_str());
+    file << report();
+    if (!file)
+      return false;
+  }
+  return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+
+std::vector<std::pair<std::string, uint64_t> > UpdateTimer::spansWithin(uint64_t begin, uint64_t end)
+{
+  std::vector<std::pair<std::string, uint64_t> > spans;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (std::map<std::string, UpdateTimer*>::const_iterator it = registry().begin(); it != registry().end(); ++it)
+    {
+      uint64_t span_begin = it->second->last_begin_.load(std::memory_order_relaxed);
+      uint64_t span_end = it->second->last_end_.load(std::memory_order_relaxed);
+      if (span_begin >= begin && span_end <= end && span_end >= span_begin)
+        spans.push_back(std::make_pair(it->first, span_end - span_begin));
+    }
+  }
+  std::sort(spans.begin(), spans.end(), longerSpan);
+  return spans;
+}
+
+
+void UpdateTimer::resetAll()
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  for (std::map<std::string, UpdateTimer*>::iterator it = registry().begin(); it != registry().end(); ++it)
+    it->second->histogram_.reset();
+}
+
+}
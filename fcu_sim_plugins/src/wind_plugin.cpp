@@ -22,6 +22,8 @@ namespace gazebo {
 
 WindPlugin::~WindPlugin() {
   event::Events::DisconnectWorldUpdateBegin(update_connection_);
+  if (wind_source_)
+    wind_source_->ClearProvider();
   if (node_handle_) {
     node_handle_->shutdown();
     delete node_handle_;
@@ -47,6 +49,7 @@ void WindPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   getSdfParam<std::string>(_sdf, "windPubTopic", wind_pub_topic_, "wind");
   getSdfParam<std::string>(_sdf, "frameId", frame_id_, "world");
   getSdfParam<std::string>(_sdf, "linkName", link_name_, "wind");
+  getSdfParam<double>(_sdf, "windPubRate", wind_pub_rate_, 10.0);
 
   // Get the wind params from SDF.
   getSdfParam<double>(_sdf, "windForceMean", wind_force_mean_, 0.0);
@@ -69,37 +72,51 @@ void WindPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   if (link_ == NULL)
     gzthrow("[gazebo_wind_plugin] Couldn't find specified link \"" << link_name_ << "\".");
 
+  // Without a seed, follow the world seed (gzserver --seed) so a run can still be reproduced
+  unsigned int seed;
+  getSdfParam<unsigned int>(_sdf, "seed", seed, math::Rand::GetSeed());
+  random_.seed(seed, namespace_ + "/wind");
+  gzmsg << "[gazebo_wind_plugin] " << namespace_ << " wind seed " << seed << "\n";
+
+  // Draw a wind on the first step
+  wind_change_delay = 0;
+  wind_change_value = 0;
+  drawn_iteration_ = world_->GetIterations() - 1;
+
+  // Serve the wind to the rest of the model
+  world_wind_source_ = WindSource::Get(world_);
+  wind_source_ = WindSource::Get(model_);
+  wind_source_->SetProvider(boost::bind(&WindPlugin::Wind, this, _1, _2));
 
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   update_connection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&WindPlugin::OnUpdate, this, _1));
+  update_timer_ = fcu_sim::UpdateTimer::get(namespace_ + "/wind");
 
-  wind_pub_ = node_handle_->advertise<geometry_msgs::Vector3>(wind_pub_topic_, 10);
+  if (wind_pub_rate_ > 0.0)
+    wind_pub_ = node_handle_->advertise<geometry_msgs::Vector3>(wind_pub_topic_, 10);
+  last_pub_time_ = world_->GetSimTime();
 }
 
-// This gets called by the world update start event.
-void WindPlugin::OnUpdate(const common::UpdateInfo& _info) {
+void WindPlugin::Draw() {
+  uint64_t iteration = world_->GetIterations();
+  if (iteration == drawn_iteration_)
+    return;
+  drawn_iteration_ = iteration;
+
   // Get the current simulation time.
   common::Time now = world_->GetSimTime();
 
-  // Establish Random Number Generator
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-  std::default_random_engine generator (seed);
-  std::uniform_real_distribution<double> direction_distribution(-1,1);
-  std::normal_distribution<double> force_distribution(wind_force_mean_,sqrt(wind_force_variance_));
-  std::normal_distribution<double> gust_force_distribution(wind_gust_force_mean_,sqrt(wind_gust_force_variance_));
-  std::normal_distribution<double> wind_change_distribution(1000,500);
-
   // Calculate the wind force
 
 
   if (wind_change_delay==wind_change_value)
   {
-      wind_strength = force_distribution(generator);
-      wind_x = direction_distribution(generator);
-      wind_y = direction_distribution(generator);
-      wind_z = direction_distribution(generator);
-      wind_change_value = ceil(abs(wind_change_distribution(generator)));
+      wind_strength = random_.normal(wind_force_mean_, sqrt(wind_force_variance_));
+      wind_x = random_.uniform(-1, 1);
+      wind_y = random_.uniform(-1, 1);
+      wind_z = random_.uniform(-1, 1);
+      wind_change_value = ceil(fabs(random_.normal(1000, 500)));
       wind_change_delay=0;
   }
   else
@@ -114,28 +131,57 @@ void WindPlugin::OnUpdate(const common::UpdateInfo& _info) {
   wind_direction.z = wind_z;
   wind_direction.Normalize();
 
-  math::Vector3 wind = wind_strength * wind_direction;
-  // Apply a force from the wind to the link.
-  link_->AddForceAtRelativePosition(wind, xyz_offset_);
+  wind_ = wind_strength * wind_direction;
 
   //Wind Gust
 
-  math::Vector3 wind_gust(0, 0, 0);
+  wind_gust_.Set(0, 0, 0);
   // Calculate the wind gust force.
   if (now >= wind_gust_start_ && now < wind_gust_end_) {
-    double wind_gust_strength = gust_force_distribution(generator);
-    wind_gust = wind_gust_strength * wind_gust_direction_;
-    // Apply a force from the wind gust to the link.
-    link_->AddForceAtRelativePosition(wind_gust, xyz_offset_);
+    double wind_gust_strength = random_.normal(wind_gust_force_mean_, sqrt(wind_gust_force_variance_));
+    wind_gust_ = wind_gust_strength * wind_gust_direction_;
   }
+}
 
-  geometry_msgs::Vector3 wind_msg;
+math::Vector3 WindPlugin::Wind(const math::Vector3& position, const common::Time& time) {
+  if (world_wind_source_->HasProvider())
+    return world_wind_source_->Wind(position, time);
 
-  wind_msg.x = wind.x + wind_gust.x;
-  wind_msg.y = wind.y + wind_gust.y;
-  wind_msg.z = wind.z + wind_gust.z;
+  // The random wind is drawn in Gazebo's frame, where it also pushes on the link
+  Draw();
+  return WindSource::NWUToNED(wind_ + wind_gust_);
+}
 
-  wind_pub_.publish(wind_msg);
+// This gets called by the world update start event.
+void WindPlugin::OnUpdate(const common::UpdateInfo& _info) {
+  fcu_sim::ScopedTimer timing(update_timer_);
+  common::Time now = world_->GetSimTime();
+
+  // A world-wide field only acts through the aero models, the random wind also pushes on the link
+  if (!world_wind_source_->HasProvider())
+  {
+    Draw();
+
+    // Apply a force from the wind to the link.
+    link_->AddForceAtRelativePosition(wind_, xyz_offset_);
+
+    // Apply a force from the wind gust to the link.
+    if (now >= wind_gust_start_ && now < wind_gust_end_)
+      link_->AddForceAtRelativePosition(wind_gust_, xyz_offset_);
+  }
+
+  // Decimated copy for logging, nothing in the simulation reads it
+  if (wind_pub_rate_ > 0.0 && (now - last_pub_time_).Double() >= 1.0/wind_pub_rate_)
+  {
+    last_pub_time_ = now;
+    math::Vector3 wind = wind_source_->Wind(WindSource::NWUToNED(link_->GetWorldCoGPose().pos), now);
+
+    geometry_msgs::Vector3 wind_msg;
+    wind_msg.x = wind.x;
+    wind_msg.y = wind.y;
+    wind_msg.z = wind.z;
+    wind_pub_.publish(wind_msg);
+  }
 }
 
 GZ_REGISTER_MODEL_PLUGIN(WindPlugin);
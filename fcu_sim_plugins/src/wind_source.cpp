@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fcu_sim_plugins/wind_source.h"
+
+#include <map>
+#include <mutex>
+
+#include <boost/weak_ptr.hpp>
+
+namespace gazebo
+{
+
+namespace
+{
+
+// Plugins live in separate libraries, this library holds the one instance per model and per world
+std::mutex instances_mutex;
+std::map<const void*, boost::weak_ptr<WindSource> > instances;
+
+}
+
+
+WindSourcePtr WindSource::Get(physics::ModelPtr model)
+{
+  // Outside the lock, it takes it too
+  WindSourcePtr world = Get(model->GetWorld());
+
+  std::lock_guard<std::mutex> lock(instances_mutex);
+  boost::weak_ptr<WindSource>& weak = instances[model.get()];
+  WindSourcePtr instance = weak.lock();
+  if (!instance)
+  {
+    instance.reset(new WindSource(model, physics::WorldPtr(), world));
+    weak = instance;
+  }
+  return instance;
+}
+
+
+WindSourcePtr WindSource::Get(physics::WorldPtr world)
+{
+  std::lock_guard<std::mutex> lock(instances_mutex);
+  boost::weak_ptr<WindSource>& weak = instances[world.get()];
+  WindSourcePtr instance = weak.lock();
+  if (!instance)
+  {
+    instance.reset(new WindSource(physics::ModelPtr(), world, WindSourcePtr()));
+    weak = instance;
+  }
+  return instance;
+}
+
+
+WindSource::WindSource(physics::ModelPtr model, physics::WorldPtr world, WindSourcePtr fallback) :
+  model_(model),
+  world_(world),
+  fallback_(fallback)
+{}
+
+
+math::Vector3 WindSource::Wind(const math::Vector3& position, const common::Time& time) const
+{
+  if (provider_)
+    return provider_(position, time);
+  if (fallback_)
+    return fallback_->Wind(position, time);
+  return math::Vector3(0, 0, 0);
+}
+
+}
@@ -15,17 +15,34 @@
  */
 
 #include "fcu_sim_plugins/world_utilities.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include "gazebo/physics/World.hh"
 #include "gazebo/physics/Model.hh"
 #include <gazebo/gazebo.hh>
 #include <gazebo/physics/physics.hh>
 #include <gazebo/common/common.hh>
 
+#include "fcu_sim_plugins/common.h"
+#include "fcu_sim_plugins/trace.h"
+#include "fcu_sim_plugins/update_timer.h"
+
 namespace gazebo {
 
-WorldUtilities::WorldUtilities() : WorldPlugin() {}
+WorldUtilities::WorldUtilities() :
+  WorldPlugin(), nh_(NULL), timing_period_(10.0), metrics_period_(1.0), trace_ticks_(1000), tracing_(false),
+  trace_ticks_left_(0), tick_begin_(0) {}
 
 WorldUtilities::~WorldUtilities() {
+  if (updateConnection_)
+    event::Events::DisconnectWorldUpdateBegin(updateConnection_);
+  if (updateEndConnection_)
+    event::Events::DisconnectWorldUpdateEnd(updateEndConnection_);
+  std::string message;
+  finishTrace(&message);
+  if (!timing_file_.empty())
+    fcu_sim::UpdateTimer::writeReport(timing_file_);
   if (nh_) {
     nh_->shutdown();
     delete nh_;
@@ -38,8 +55,173 @@ void WorldUtilities::Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf)
   nh_ = new ros::NodeHandle("~");
   step_command_sub_ = nh_->subscribe("step", 1, &WorldUtilities::stepCommandCallback, this);
   randomize_obstacles_service_sub_ = nh_->advertiseService("randomize_obstacles", &WorldUtilities::randomizeObstaclesCommandCallback, this);
+  timing_service_ = nh_->advertiseService("timing", &WorldUtilities::timingCallback, this);
+  start_trace_service_ = nh_->advertiseService("start_trace", &WorldUtilities::startTraceCallback, this);
+  stop_trace_service_ = nh_->advertiseService("stop_trace", &WorldUtilities::stopTraceCallback, this);
 
   this->world_ = _parent;
+
+  // Write the plugin timing histograms to a file every timingPeriod seconds of sim time
+  getSdfParam<std::string>(_sdf, "timingFile", timing_file_, "");
+  getSdfParam<double>(_sdf, "timingPeriod", timing_period_, 10.0);
+  last_timing_dump_ = world_->GetSimTime();
+
+  // Simulation health on ~health and, for a local scraper, in Prometheus text format
+  std::string health_topic;
+  getSdfParam<std::string>(_sdf, "healthTopic", health_topic, "health");
+  getSdfParam<std::string>(_sdf, "metricsFile", metrics_file_, "");
+  getSdfParam<double>(_sdf, "metricsPeriod", metrics_period_, 1.0);
+  health_pub_ = nh_->advertise<fcu_sim::SimHealth>(health_topic, 1);
+
+  // Where ~stop_trace (or the end of a traceTicks capture) writes the timeline
+  getSdfParam<std::string>(_sdf, "traceFile", trace_file_, "/tmp/fcu_sim_trace.json");
+  getSdfParam<int>(_sdf, "traceTicks", trace_ticks_, 1000);
+
+  // World plugins load before the models, so the tick brackets every model plugin's update
+  updateConnection_ = event::Events::ConnectWorldUpdateBegin(boost::bind(&WorldUtilities::OnUpdate, this, _1));
+  updateEndConnection_ = event::Events::ConnectWorldUpdateEnd(boost::bind(&WorldUtilities::OnUpdateEnd, this));
+}
+
+void WorldUtilities::OnUpdate(const common::UpdateInfo & _info)
+{
+  monitor_.beginTick(_info.simTime.Double(), fcu_sim::UpdateTimer::now());
+
+  tick_begin_ = 0;
+  if (fcu_sim::Trace::enabled())
+  {
+    fcu_sim::Trace::nameThread("physics");
+    tick_begin_ = fcu_sim::UpdateTimer::now();
+  }
+
+  if (timing_file_.empty())
+    return;
+  if ((_info.simTime - last_timing_dump_).Double() < timing_period_ && _info.simTime >= last_timing_dump_)
+    return;
+  last_timing_dump_ = _info.simTime;
+  if (!fcu_sim::UpdateTimer::writeReport(timing_file_))
+    gzwarn << "[WorldUtilities] could not write timings to " << timing_file_ << "\n";
+}
+
+void WorldUtilities::OnUpdateEnd()
+{
+  uint64_t now = fcu_sim::UpdateTimer::now();
+  monitor_.endTick(now);
+  if (metrics_period_ > 0.0 && monitor_.elapsed(now) >= metrics_period_)
+    reportHealth(now);
+
+  if (tick_begin_ == 0 || !fcu_sim::Trace::enabled())
+    return;
+  fcu_sim::Trace::record("tick", tick_begin_, fcu_sim::UpdateTimer::now());
+
+  // Last tick of the capture, write it out here rather than wait for ~stop_trace
+  if (trace_ticks_left_.load() > 0 && trace_ticks_left_.fetch_sub(1) == 1)
+  {
+    std::string message;
+    finishTrace(&message);
+    gzmsg << "[WorldUtilities] " << message << "\n";
+  }
+}
+
+void WorldUtilities::reportHealth(uint64_t now)
+{
+  // real_time_update_rate can be changed while running, from the GUI or a service
+  double rate = world_->GetPhysicsEngine()->GetRealTimeUpdateRate();
+  monitor_.setTargetPeriod(rate > 0.0 ? 1.0/rate : 0.0);
+
+  common::Time sim_time = world_->GetSimTime();
+  fcu_sim::TickStats stats = monitor_.collect(sim_time.Double(), now);
+  int models = world_->GetModelCount();
+
+  fcu_sim::SimHealth msg;
+  msg.header.stamp.sec = sim_time.sec;
+  msg.header.stamp.nsec = sim_time.nsec;
+  msg.period = stats.period;
+  msg.real_time_factor = stats.real_time_factor;
+  msg.target_step = rate > 0.0 ? 1.0/rate : 0.0;
+  msg.models = models;
+  msg.steps = stats.steps;
+  msg.overruns = stats.overruns;
+  msg.steps_total = monitor_.stepsTotal();
+  msg.overruns_total = monitor_.overrunsTotal();
+  msg.mean_step = stats.mean_step;
+  msg.max_step = stats.max_step;
+  msg.worst_step_stamp.fromSec(stats.worst_sim_time);
+  for (size_t i = 0; i < stats.worst_breakdown.size(); i++)
+  {
+    msg.worst_step_updates.push_back(stats.worst_breakdown[i].first);
+    msg.worst_step_update_time.push_back(stats.worst_breakdown[i].second);
+  }
+  health_pub_.publish(msg);
+
+  if (metrics_file_.empty())
+    return;
+
+  // Through a temporary file so the scraper never reads half of it
+  std::string temporary = metrics_file_ + ".tmp";
+  bool written;
+  {
+    std::ofstream file(temporary.c_str());
+    file << monitor_.prometheus(stats, models);
+    written = file.good();
+  }
+  if (!written || std::rename(temporary.c_str(), metrics_file_.c_str()) != 0)
+    gzwarn << "[WorldUtilities] could not write metrics to " << metrics_file_ << "\n";
+}
+
+bool WorldUtilities::finishTrace(std::string* message)
+{
+  std::lock_guard<std::mutex> lock(trace_mutex_);
+  if (!tracing_)
+  {
+    *message = "no trace capture running";
+    return false;
+  }
+  tracing_ = false;
+  fcu_sim::Trace::stop();
+
+  long events = fcu_sim::Trace::writeChromeTrace(trace_file_);
+  if (events < 0)
+  {
+    *message = "could not write trace to " + trace_file_;
+    return false;
+  }
+  *message = std::to_string(events) + " events written to " + trace_file_;
+  return true;
+}
+
+bool WorldUtilities::timingCallback(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response)
+{
+  response.success = true;
+  response.message = fcu_sim::UpdateTimer::report();
+  return true;
+}
+
+bool WorldUtilities::startTraceCallback(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response)
+{
+  // ~trace_ticks overrides traceTicks for this capture, 0 records until ~stop_trace
+  int ticks = trace_ticks_;
+  nh_->param<int>("trace_ticks", ticks, trace_ticks_);
+
+  std::lock_guard<std::mutex> lock(trace_mutex_);
+  if (tracing_)
+  {
+    response.success = false;
+    response.message = "a trace capture is already running";
+    return true;
+  }
+  tracing_ = true;
+  trace_ticks_left_.store(std::max(ticks, 0));
+  fcu_sim::Trace::start();
+  response.success = true;
+  response.message = ticks > 0 ? "tracing " + std::to_string(ticks) + " ticks to " + trace_file_
+                               : "tracing until stop_trace to " + trace_file_;
+  return true;
+}
+
+bool WorldUtilities::stopTraceCallback(std_srvs::TriggerRequest& request, std_srvs::TriggerResponse& response)
+{
+  response.success = finishTrace(&response.message);
+  return true;
 }
 bool WorldUtilities::randomizeObstaclesCommandCallback(std_srvs::EmptyRequest& request, std_srvs::EmptyResponse& response)
 {
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <yaml-cpp/yaml.h>
+
+#include "fcu_sim_plugins/aircraft_trim.h"
+#include "fcu_sim_plugins/yaml_params.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+// The agent yaml the launch files load, from fcu_sim/agents
+bool loadAgent(const std::string& name, AircraftParams* aircraft, RigidBodyParams* body)
+{
+  std::string path = std::string(FCU_SIM_AGENTS_DIR) + "/" + name + "/" + name + ".yaml";
+  try
+  {
+    YamlParams agent(YAML::LoadFile(path));
+    aircraft->load(agent);
+  }
+  catch (const YAML::Exception& e)
+  {
+    ADD_FAILURE() << "could not load " << path << ": " << e.what();
+    return false;
+  }
+  body->mass = aircraft->mass;
+  body->Jx = aircraft->Jx;
+  body->Jy = aircraft->Jy;
+  body->Jz = aircraft->Jz;
+  body->Jxz = aircraft->Jxz;
+  return true;
+}
+
+// Second-order central difference of aircraftDerivatives in x[index] (or u[index])
+void centralDifference(const AircraftParams& aircraft, const RigidBodyParams& body,
+                       const double x[NUM_RIGID_BODY_STATES], const double u[NUM_AIRCRAFT_INPUTS],
+                       bool input, int index, double column[NUM_RIGID_BODY_STATES])
+{
+  double xp[NUM_RIGID_BODY_STATES], xm[NUM_RIGID_BODY_STATES];
+  double up[NUM_AIRCRAFT_INPUTS], um[NUM_AIRCRAFT_INPUTS];
+  std::copy(x, x + NUM_RIGID_BODY_STATES, xp);
+  std::copy(x, x + NUM_RIGID_BODY_STATES, xm);
+  std::copy(u, u + NUM_AIRCRAFT_INPUTS, up);
+  std::copy(u, u + NUM_AIRCRAFT_INPUTS, um);
+
+  double& plus = input ? up[index] : xp[index];
+  double& minus = input ? um[index] : xm[index];
+  double h = 1e-6*std::max(1.0, std::fabs(plus));
+  plus += h;
+  minus -= h;
+
+  double fp[NUM_RIGID_BODY_STATES], fm[NUM_RIGID_BODY_STATES];
+  aircraftDerivatives(aircraft, body, xp, up, fp);
+  aircraftDerivatives(aircraft, body, xm, um, fm);
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+    column[i] = (fp[i] - fm[i])/(2.0*h);
+}
+
+void expectTrims(const std::string& agent, const TrimCondition& condition)
+{
+  AircraftParams aircraft;
+  RigidBodyParams body;
+  if (!loadAgent(agent, &aircraft, &body))
+    return;
+
+  TrimOptions options;
+  TrimResult trim = computeTrim(aircraft, body, condition, options);
+  EXPECT_TRUE(trim.converged) << agent << " at Va " << condition.Va << ", gamma " << condition.gamma
+                              << ", R " << condition.R << " after " << trim.iterations << " iterations";
+  EXPECT_LT(trim.residual, options.tolerance);
+  EXPECT_TRUE(std::isfinite(trim.alpha));
+  for (int i = 0; i < NUM_AIRCRAFT_INPUTS; i++)
+    EXPECT_TRUE(std::isfinite(trim.u[i]));
+}
+
+}
+
+
+// The dual-number A and B against central differences at a trim point
+TEST(AircraftTrim, JacobianMatchesCentralDifferences)
+{
+  AircraftParams aircraft;
+  RigidBodyParams body;
+  ASSERT_TRUE(loadAgent("junker", &aircraft, &body));
+
+  TrimCondition condition = {25.0, 0.0873, 200.0, 0.0};
+  TrimResult trim = computeTrim(aircraft, body, condition);
+  ASSERT_TRUE(trim.converged);
+
+  double column[NUM_RIGID_BODY_STATES];
+  for (int j = 0; j < NUM_RIGID_BODY_STATES; j++)
+  {
+    centralDifference(aircraft, body, trim.x, trim.u, false, j, column);
+    for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+      EXPECT_NEAR(column[i], trim.A[i][j], 1e-6 + 1e-6*std::fabs(column[i])) << "A[" << i << "][" << j << "]";
+  }
+  for (int j = 0; j < NUM_AIRCRAFT_INPUTS; j++)
+  {
+    centralDifference(aircraft, body, trim.x, trim.u, true, j, column);
+    for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+      EXPECT_NEAR(column[i], trim.B[i][j], 1e-6 + 1e-6*std::fabs(column[i])) << "B[" << i << "][" << j << "]";
+  }
+
+  // linearizeAircraft on its own gives the same matrices
+  double A[NUM_RIGID_BODY_STATES][NUM_RIGID_BODY_STATES];
+  double B[NUM_RIGID_BODY_STATES][NUM_AIRCRAFT_INPUTS];
+  linearizeAircraft(aircraft, body, trim.x, trim.u, A, B);
+  for (int i = 0; i < NUM_RIGID_BODY_STATES; i++)
+  {
+    for (int j = 0; j < NUM_RIGID_BODY_STATES; j++)
+      EXPECT_DOUBLE_EQ(trim.A[i][j], A[i][j]);
+    for (int j = 0; j < NUM_AIRCRAFT_INPUTS; j++)
+      EXPECT_DOUBLE_EQ(trim.B[i][j], B[i][j]);
+  }
+}
+
+
+TEST(AircraftTrim, JunkerTrims)
+{
+  expectTrims("junker", TrimCondition{25.0, 0.0, INFINITY, 0.0});
+  expectTrims("junker", TrimCondition{25.0, 0.0873, 200.0, 0.0});
+  expectTrims("junker", TrimCondition{20.0, -0.0873, -400.0, 0.0});
+}
+
+
+TEST(AircraftTrim, MyTwinDreamTrims)
+{
+  expectTrims("myTwinDream", TrimCondition{16.38, 0.0, INFINITY, 0.0});
+  expectTrims("myTwinDream", TrimCondition{16.38, 0.0873, 100.0, 0.0});
+}
+
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
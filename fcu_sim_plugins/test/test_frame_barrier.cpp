@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "fcu_sim_plugins/frame_barrier.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+// Long enough that a test only hits it when the barrier is broken
+const double kNoTimeout = 10.0;
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+
+// Physics and a renderer in strict lockstep: each request returns only once
+// its frame has been rendered
+TEST(FrameBarrier, LockstepWaitsForEveryFrame)
+{
+  FrameBarrier barrier(0);
+  const int frames = 200;
+  std::atomic<int> requested(0);
+
+  std::thread renderer([&]
+  {
+    for (int frame = 1; frame <= frames; frame++)
+    {
+      while (requested.load() < frame)
+        std::this_thread::yield();
+      barrier.rendered(frame*0.01);
+    }
+  });
+
+  for (int frame = 1; frame <= frames; frame++)
+  {
+    requested.store(frame);
+    ASSERT_TRUE(barrier.request(kNoTimeout));
+    EXPECT_EQ(static_cast<uint64_t>(frame), barrier.stats().rendered);
+  }
+  renderer.join();
+
+  FrameBarrier::Stats stats = barrier.stats();
+  EXPECT_EQ(static_cast<uint64_t>(frames), stats.requested);
+  EXPECT_EQ(0u, stats.timeouts);
+  EXPECT_LE(stats.max_lag, 1);
+}
+
+
+// Both camera callbacks report every frame from their own threads, and the
+// physics thread may run up to depth frames ahead of them
+TEST(FrameBarrier, SeveralReportersCountEachFrameOnce)
+{
+  const int depth = 2;
+  const int frames = 500;
+  FrameBarrier barrier(depth);
+  std::atomic<int> requested(0);
+
+  auto reporter = [&]
+  {
+    for (int frame = 1; frame <= frames; frame++)
+    {
+      while (requested.load() < frame)
+        std::this_thread::yield();
+      barrier.rendered(frame*0.01);
+    }
+  };
+  std::thread new_frame(reporter);
+  std::thread sensor_updated(reporter);
+
+  for (int frame = 1; frame <= frames; frame++)
+  {
+    requested.store(frame);
+    ASSERT_TRUE(barrier.request(kNoTimeout));
+  }
+  new_frame.join();
+  sensor_updated.join();
+
+  FrameBarrier::Stats stats = barrier.stats();
+  EXPECT_EQ(static_cast<uint64_t>(frames), stats.rendered);
+  EXPECT_EQ(0u, stats.timeouts);
+  EXPECT_LE(stats.max_lag, depth + 1);
+}
+
+
+// A renderer that goes away with a frame in flight costs one timeout, after
+// which physics carries on at full speed
+TEST(FrameBarrier, TimeoutWritesOffAStalledRenderer)
+{
+  FrameBarrier barrier(0);
+  barrier.rendered(0.01);
+  ASSERT_TRUE(barrier.request(kNoTimeout));
+
+  // Nobody renders the second frame
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(barrier.request(0.05));
+  double waited = secondsSince(start);
+  EXPECT_GE(waited, 0.04);
+  EXPECT_LT(waited, kNoTimeout/2);
+
+  FrameBarrier::Stats stats = barrier.stats();
+  EXPECT_EQ(1u, stats.timeouts);
+  EXPECT_EQ(1u, stats.dropped);
+  EXPECT_EQ(stats.requested, stats.rendered);
+
+  // The renderer comes back, nothing is owed from before the stall
+  barrier.rendered(0.03);
+  EXPECT_TRUE(barrier.request(kNoTimeout));
+  EXPECT_EQ(1u, barrier.stats().timeouts);
+}
+
+
+// A reset (the world restarting) while physics waits on a frame lets it go at once
+TEST(FrameBarrier, ResetReleasesAWaitingRequest)
+{
+  FrameBarrier barrier(0);
+  std::atomic<bool> returned(false);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  std::thread physics([&]
+  {
+    EXPECT_TRUE(barrier.request(kNoTimeout));
+    returned.store(true);
+  });
+
+  while (barrier.stats().waits == 0)
+    std::this_thread::yield();
+  EXPECT_FALSE(returned.load());
+  barrier.reset();
+  physics.join();
+
+  EXPECT_LT(secondsSince(start), kNoTimeout/2);
+  EXPECT_EQ(0u, barrier.stats().timeouts);
+
+  // Scene time starts over after a reset
+  barrier.rendered(0.01);
+  EXPECT_TRUE(barrier.request(kNoTimeout));
+}
+
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
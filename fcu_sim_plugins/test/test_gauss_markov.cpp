@@ -0,0 +1,132 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "fcu_sim_plugins/gauss_markov.h"
+#include "fcu_sim_plugins/random_stream.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+const int kSeeds = 20000;
+
+// Mean and variance of one end value per seed
+struct Moments
+{
+  Moments() : n(0), sum(0.0), sum_sq(0.0) {}
+  void add(double x) { n++; sum += x; sum_sq += x*x; }
+  double mean() const { return sum/n; }
+  double variance() const { return (sum_sq - sum*sum/n)/(n - 1); }
+
+  int n;
+  double sum;
+  double sum_sq;
+};
+
+// Both ways of getting there agree with each other and with the exact
+// distribution, to within five standard errors
+void expectSameDistribution(const Moments& stepped, const Moments& skipped, double mean, double variance)
+{
+  double mean_error = 5.0*std::sqrt(variance/kSeeds);
+  double variance_error = 5.0*std::sqrt(2.0/(kSeeds - 1));
+  EXPECT_NEAR(mean, stepped.mean(), mean_error);
+  EXPECT_NEAR(mean, skipped.mean(), mean_error);
+  EXPECT_NEAR(stepped.mean(), skipped.mean(), std::sqrt(2.0)*mean_error);
+  EXPECT_NEAR(1.0, stepped.variance()/variance, variance_error);
+  EXPECT_NEAR(1.0, skipped.variance()/variance, variance_error);
+}
+
+}
+
+
+// An IMU bias walk: steps samples at the IMU rate against one skip() over the same time
+TEST(GaussMarkov, SkipMatchesSteppingInDistribution)
+{
+  const double tau = 100.0, sigma = 0.01, dt = 0.002, b0 = 0.05;
+  const int steps = 500;
+
+  Moments stepped, skipped;
+  for (int seed = 0; seed < kSeeds; seed++)
+  {
+    GaussMarkov process(tau, sigma);
+    RandomStream random(seed, "gauss_markov");
+    double b = b0;
+    for (int i = 0; i < steps; i++)
+      b = process.step(b, dt, random.normal());
+    stepped.add(b);
+    skipped.add(process.skip(b0, steps*dt, random.normal()));
+  }
+
+  double phi = std::exp(-steps*dt/tau);
+  expectSameDistribution(stepped, skipped, phi*b0, sigma*sigma*tau/2.0*(1.0 - phi*phi));
+}
+
+
+TEST(GaussMarkov, SkipWithoutNoiseIsTheDecay)
+{
+  GaussMarkov process(2.0, 0.3);
+  double b = 1.5;
+  for (int i = 0; i < 100; i++)
+    b = process.step(b, 0.01, 0.0);
+  EXPECT_NEAR(b, process.skip(1.5, 1.0, 0.0), 1e-12);
+  EXPECT_DOUBLE_EQ(1.5, process.skip(1.5, 0.0, 0.0));
+}
+
+
+// The GPS position error, specified per sample: steps samples against one skipSamples()
+TEST(GaussMarkov, SkipSamplesMatchesSteppingInDistribution)
+{
+  const double phi = std::exp(-1.0/1100.0), sigma = 0.21, e0 = 1.0;
+  const int steps = 300;
+
+  Moments stepped, skipped;
+  for (int seed = 0; seed < kSeeds; seed++)
+  {
+    RandomStream random(seed, "gps");
+    double e = e0;
+    for (int i = 0; i < steps; i++)
+      e = phi*e + sigma*random.normal();
+    stepped.add(e);
+    skipped.add(skipSamples(e0, phi, sigma, steps, random.normal()));
+  }
+
+  double phi_m = std::pow(phi, steps);
+  expectSameDistribution(stepped, skipped, phi_m*e0, sigma*sigma*(1.0 - phi_m*phi_m)/(1.0 - phi*phi));
+}
+
+
+TEST(GaussMarkov, SkipSamplesEdgeCases)
+{
+  // Nothing skipped leaves the error alone
+  EXPECT_DOUBLE_EQ(0.7, skipSamples(0.7, 0.9, 1.0, 0, 3.0));
+
+  // One sample is one step
+  EXPECT_DOUBLE_EQ(0.9*0.7 + 0.2*0.5, skipSamples(0.7, 0.9, 0.2, 1, 0.5));
+
+  // A random walk (phi = 1) grows with the square root of the samples
+  EXPECT_DOUBLE_EQ(0.7 + 0.2*std::sqrt(16.0)*0.5, skipSamples(0.7, 1.0, 0.2, 16, 0.5));
+}
+
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "fcu_sim_plugins/random_stream.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+struct PhiloxVector
+{
+  uint32_t ctr[4];
+  uint32_t key[2];
+  uint32_t out[4];
+};
+
+// Philox4x32-10 known answers, from the Random123 distribution (kat_vectors)
+const PhiloxVector kKnownAnswers[] = {
+  {{0x00000000, 0x00000000, 0x00000000, 0x00000000}, {0x00000000, 0x00000000},
+   {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+  {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff},
+   {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+  {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0},
+   {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+};
+
+}
+
+
+TEST(RandomStream, PhiloxKnownAnswers)
+{
+  for (const PhiloxVector& v : kKnownAnswers)
+  {
+    uint32_t ctr[4] = {v.ctr[0], v.ctr[1], v.ctr[2], v.ctr[3]};
+    RandomStream::philox4x32_10(v.key, ctr);
+    for (int i = 0; i < 4; i++)
+      EXPECT_EQ(v.out[i], ctr[i]) << "word " << i << " for key " << std::hex << v.key[0] << " " << v.key[1];
+  }
+}
+
+
+// The stream's lane-parallel blocks are the reference Philox of each counter,
+// across several buffer refills
+TEST(RandomStream, WordsArePhiloxOfTheCounter)
+{
+  const uint32_t key[2] = {0xa4093822, 0x299f31d0};
+  RandomStream stream;
+  stream.setKey(key);
+  for (uint32_t n = 0; n < 200; n++)
+  {
+    uint32_t ctr[4] = {n, 0, 0, 0};
+    RandomStream::philox4x32_10(key, ctr);
+    EXPECT_EQ((static_cast<uint64_t>(ctr[0]) << 32) | ctr[1], stream.nextWord()) << "counter " << n;
+    EXPECT_EQ((static_cast<uint64_t>(ctr[2]) << 32) | ctr[3], stream.nextWord()) << "counter " << n;
+  }
+}
+
+
+// Two streams with the same key and counter give the same blocks, which is
+// what makes a sensor's noise reproducible
+TEST(RandomStream, SameKeyAndCounterGiveTheSameBlocks)
+{
+  const uint32_t key[2] = {0x12345678, 0x9abcdef0};
+  RandomStream a, b;
+  a.setKey(key);
+  b.setKey(key);
+  for (int i = 0; i < 1000; i++)
+    ASSERT_EQ(a.nextWord(), b.nextWord()) << "word " << i;
+
+  RandomStream c(42, "uav1/imu"), d(42, "uav1/imu"), other(42, "uav1/gps");
+  bool differs = false;
+  for (int i = 0; i < 1000; i++)
+  {
+    double x = c.normal();
+    ASSERT_EQ(x, d.normal()) << "normal " << i;
+    differs = differs || x != other.normal();
+  }
+  EXPECT_TRUE(differs);
+
+  // Reseeding restarts at block 0
+  RandomStream e(42, "uav1/imu");
+  double first = e.normal();
+  e.normal();
+  e.seed(42, "uav1/imu");
+  EXPECT_EQ(first, e.normal());
+}
+
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "fcu_sim_plugins/shm_image_ring.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+const int kSlots = 4;
+const uint32_t kWidth = 64;
+const uint32_t kHeight = 48;
+
+// A segment name no other test run is using
+std::string segmentName(const char* test)
+{
+  return std::string("/fcu_sim_test_") + test + "_" + std::to_string(getpid());
+}
+
+// Every byte of frame sequence and its header derive from sequence, so a
+// frame pieced together from two writes can't pass check()
+void fill(uint64_t sequence, ShmFrameInfo* info, std::vector<uint8_t>* data)
+{
+  info->width = kWidth;
+  info->height = kHeight;
+  info->step = kWidth;
+  info->encoding = "mono8";
+  info->sec = static_cast<uint32_t>(sequence);
+  info->nsec = static_cast<uint32_t>(~sequence);
+  data->resize(kWidth*kHeight);
+  for (size_t i = 0; i < data->size(); i++)
+    (*data)[i] = static_cast<uint8_t>(sequence*31 + i);
+}
+
+::testing::AssertionResult check(uint64_t sequence, const ShmFrameInfo& info, const std::vector<uint8_t>& data)
+{
+  if (info.sec != static_cast<uint32_t>(sequence) || info.nsec != static_cast<uint32_t>(~sequence))
+    return ::testing::AssertionFailure() << "frame " << sequence << " has the header of frame " << info.sec;
+  if (info.width != kWidth || info.height != kHeight || info.step != kWidth || info.encoding != "mono8")
+    return ::testing::AssertionFailure() << "frame " << sequence << " has a bad size or encoding";
+  if (data.size() != kWidth*kHeight)
+    return ::testing::AssertionFailure() << "frame " << sequence << " has " << data.size() << " bytes";
+  for (size_t i = 0; i < data.size(); i++)
+    if (data[i] != static_cast<uint8_t>(sequence*31 + i))
+      return ::testing::AssertionFailure() << "frame " << sequence << " byte " << i << " is from another frame";
+  return ::testing::AssertionSuccess();
+}
+
+}
+
+
+TEST(ShmImageRing, KeepsTheNewestSlotsFrames)
+{
+  std::string name = segmentName("wrap");
+  ShmImageWriter writer;
+  std::string error;
+  ASSERT_TRUE(writer.open(name, kSlots, kWidth*kHeight, &error)) << error;
+  ShmImageReader reader;
+  ASSERT_TRUE(reader.open(name, &error)) << error;
+
+  ShmFrameInfo info, out;
+  std::vector<uint8_t> data, copy;
+  EXPECT_FALSE(reader.read(1, &out, &copy));
+
+  // Several times around the ring
+  const uint64_t frames = 5*kSlots + 1;
+  for (uint64_t sequence = 1; sequence <= frames; sequence++)
+  {
+    fill(sequence, &info, &data);
+    ASSERT_EQ(sequence, writer.write(info, data.data()));
+  }
+
+  for (uint64_t sequence = 1; sequence <= frames; sequence++)
+  {
+    bool kept = sequence > frames - kSlots;
+    ASSERT_EQ(kept, reader.read(sequence, &out, &copy)) << "frame " << sequence;
+    if (kept)
+    {
+      EXPECT_TRUE(check(sequence, out, copy));
+    }
+  }
+  EXPECT_FALSE(reader.read(frames + 1, &out, &copy));
+}
+
+
+TEST(ShmImageRing, RejectsFramesThatDoNotFit)
+{
+  std::string name = segmentName("fit");
+  ShmImageWriter writer;
+  std::string error;
+  ASSERT_TRUE(writer.open(name, kSlots, kWidth*kHeight - 1, &error)) << error;
+
+  ShmFrameInfo info;
+  std::vector<uint8_t> data;
+  fill(1, &info, &data);
+  EXPECT_EQ(0u, writer.write(info, data.data()));
+}
+
+
+// One writer laps a reader that keeps reading the newest frame and one it has
+// just fallen behind on.  Whatever the reader accepts must be a whole frame.
+TEST(ShmImageRing, ReaderNeverAcceptsATornFrame)
+{
+  std::string name = segmentName("torn");
+  ShmImageWriter writer;
+  std::string error;
+  ASSERT_TRUE(writer.open(name, kSlots, kWidth*kHeight, &error)) << error;
+  ShmImageReader reader;
+  ASSERT_TRUE(reader.open(name, &error)) << error;
+
+  const uint64_t frames = 20000;
+  std::atomic<uint64_t> newest(0);
+  std::thread producer([&]
+  {
+    ShmFrameInfo info;
+    std::vector<uint8_t> data;
+    for (uint64_t sequence = 1; sequence <= frames; sequence++)
+    {
+      fill(sequence, &info, &data);
+      writer.write(info, data.data());
+      newest.store(sequence, std::memory_order_release);
+    }
+  });
+
+  uint64_t accepted = 0, rejected = 0, last = 0;
+  ShmFrameInfo out;
+  std::vector<uint8_t> copy;
+  ::testing::AssertionResult torn = ::testing::AssertionSuccess();
+  while (last < frames && torn)
+  {
+    last = newest.load(std::memory_order_acquire);
+    uint64_t candidates[2] = {last, last > kSlots - 1 ? last - (kSlots - 1) : 0};
+    for (int i = 0; i < 2; i++)
+    {
+      if (candidates[i] == 0)
+        continue;
+      if (reader.read(candidates[i], &out, &copy))
+      {
+        accepted++;
+        torn = check(candidates[i], out, copy);
+        if (!torn)
+          break;
+      }
+      else
+      {
+        rejected++;
+      }
+    }
+  }
+  producer.join();
+
+  ASSERT_TRUE(torn);
+  EXPECT_GT(accepted, 0u);
+  ASSERT_TRUE(reader.read(frames, &out, &copy));
+  EXPECT_TRUE(check(frames, out, copy));
+  RecordProperty("accepted", static_cast<int>(accepted));
+  RecordProperty("rejected", static_cast<int>(rejected));
+}
+
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2017 MAGICC Lab, Brigham Young University, Provo, UT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "fcu_sim_plugins/turbulence_field.h"
+
+using namespace fcu_sim;
+
+namespace {
+
+// A file with the documented header followed by floats floats
+std::string writeFile(const char* test, const uint32_t size[3], double spacing, size_t floats)
+{
+  std::string filename = std::string("/tmp/fcu_sim_test_") + test + "_" + std::to_string(getpid()) + ".bin";
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (file == NULL)
+    return filename;
+  const char magic[8] = {'F', 'C', 'U', 'T', 'R', 'B', '0', '1'};
+  uint32_t reserved = 0;
+  fwrite(magic, 1, sizeof(magic), file);
+  fwrite(size, sizeof(uint32_t), 3, file);
+  fwrite(&reserved, sizeof(reserved), 1, file);
+  fwrite(&spacing, sizeof(spacing), 1, file);
+  std::vector<float> data(floats, 0.5f);
+  fwrite(data.data(), sizeof(float), data.size(), file);
+  fclose(file);
+  return filename;
+}
+
+TurbulenceParams smallField()
+{
+  TurbulenceParams params;
+  params.size[0] = params.size[1] = params.size[2] = 8;
+  params.spacing = 2.0;
+  return params;
+}
+
+}
+
+
+TEST(TurbulenceField, SavedFieldLoadsBack)
+{
+  TurbulenceField generated;
+  ASSERT_TRUE(generated.generate(smallField(), 7));
+  std::string filename = std::string("/tmp/fcu_sim_test_roundtrip_") + std::to_string(getpid()) + ".bin";
+  ASSERT_TRUE(generated.save(filename));
+
+  TurbulenceField loaded;
+  std::string error;
+  ASSERT_TRUE(loaded.load(filename, &error)) << error;
+  EXPECT_EQ(8, loaded.size()[0]);
+  EXPECT_EQ(2.0, loaded.spacing());
+
+  double position[3] = {3.3, -7.1, 12.9}, a[3], b[3];
+  generated.sample(position, 1.5, a);
+  loaded.sample(position, 1.5, b);
+  for (int i = 0; i < 3; i++)
+    EXPECT_EQ(a[i], b[i]);
+  unlink(filename.c_str());
+}
+
+
+TEST(TurbulenceField, RejectsBadHeaders)
+{
+  TurbulenceField field;
+  std::string error;
+
+  // 2^30 * 2^30 * 16 points wraps to 0, which the header-only length would match
+  const uint32_t wrapping[3] = {0x40000000, 0x40000000, 16};
+  std::string filename = writeFile("wrap", wrapping, 1.0, 0);
+  EXPECT_FALSE(field.load(filename, &error));
+  unlink(filename.c_str());
+
+  // Larger than an int can index
+  const uint32_t huge[3] = {0x80000000u, 1, 1};
+  filename = writeFile("huge", huge, 1.0, 0);
+  EXPECT_FALSE(field.load(filename, &error));
+  unlink(filename.c_str());
+
+  const uint32_t size[3] = {2, 2, 2};
+  filename = writeFile("spacing", size, -1.0, 3*8);
+  EXPECT_FALSE(field.load(filename, &error));
+  unlink(filename.c_str());
+
+  filename = writeFile("truncated", size, 1.0, 3*8 - 1);
+  EXPECT_FALSE(field.load(filename, &error));
+  unlink(filename.c_str());
+
+  filename = writeFile("good", size, 1.0, 3*8);
+  EXPECT_TRUE(field.load(filename, &error)) << error;
+  unlink(filename.c_str());
+  EXPECT_FALSE(field.empty());
+}
+
+
+TEST(TurbulenceField, DivergedPositionsGetTheMeanWind)
+{
+  TurbulenceField field;
+  ASSERT_TRUE(field.generate(smallField(), 7));
+  const double mean[3] = {5.0, -1.0, 0.5};
+  field.setMeanWind(mean);
+
+  double wind[3];
+  const double nan[3] = {NAN, 0.0, 0.0};
+  field.sample(nan, 0.0, wind);
+  for (int i = 0; i < 3; i++)
+    EXPECT_EQ(mean[i], wind[i]);
+
+  const double inf[3] = {0.0, INFINITY, 0.0};
+  field.sample(inf, 0.0, wind);
+  for (int i = 0; i < 3; i++)
+    EXPECT_EQ(mean[i], wind[i]);
+
+  // Past the range of a long, but still finite
+  const double far[3] = {0.0, 0.0, -1e300};
+  field.sample(far, 0.0, wind);
+  for (int i = 0; i < 3; i++)
+    EXPECT_TRUE(std::isfinite(wind[i]));
+
+  // One box length (8 cells of 2 m) away is the same place
+  const double here[3] = {3.3, -7.1, 12.9}, there[3] = {3.3 + 16.0, -7.1 - 32.0, 12.9};
+  double a[3], b[3];
+  field.sample(here, 0.0, a);
+  field.sample(there, 0.0, b);
+  for (int i = 0; i < 3; i++)
+    EXPECT_NEAR(a[i], b[i], 1e-9);
+}
+
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}